@@ -63,7 +63,24 @@ class ParameterHandler:
                  darboux_sum=True,
                  stationary=False,
                  chop_stationary_trajectories=0,
-                 accelerate_stationary_decomp=False):
+                 accelerate_stationary_decomp=False,
+                 sim_chunk_size=1000,
+                 rand_ff_out=-1,
+                 rand_ff_stats=False,
+                 sim_correlation=False,
+                 compress=False,
+                 memory_horizon=0,
+                 exp_fit_tolerance=0.0,
+                 hmatrix_tolerance=0.0,
+                 extend_kernel=False,
+                 incremental=False,
+                 resampling_blocks=0,
+                 bootstrap_replicas=0,
+                 resampling_threads=0,
+                 block_tolerance=0.0,
+                 observable_blocks=False,
+                 block_threads=0,
+                 ff_threads=0):
         self.out_folder = out_folder
         self.in_folder = in_folder
         self.in_prefix = in_prefix
@@ -86,6 +103,23 @@ class ParameterHandler:
         self.stationary = stationary
         self.chop_stationary_trajectories = chop_stationary_trajectories
         self.accelerate_stationary_decomp = accelerate_stationary_decomp
+        self.sim_chunk_size = sim_chunk_size
+        self.rand_ff_out = rand_ff_out
+        self.rand_ff_stats = rand_ff_stats
+        self.sim_correlation = sim_correlation
+        self.compress = compress
+        self.memory_horizon = memory_horizon
+        self.exp_fit_tolerance = exp_fit_tolerance
+        self.hmatrix_tolerance = hmatrix_tolerance
+        self.extend_kernel = extend_kernel
+        self.incremental = incremental
+        self.resampling_blocks = resampling_blocks
+        self.bootstrap_replicas = bootstrap_replicas
+        self.resampling_threads = resampling_threads
+        self.block_tolerance = block_tolerance
+        self.observable_blocks = observable_blocks
+        self.block_threads = block_threads
+        self.ff_threads = ff_threads
 
     def get_parameter_file(self):
         parameter_file = """\
@@ -105,7 +139,24 @@ gaussian_init_val {gaussian_init_val}
 darboux_sum {darboux_sum}
 stationary {stationary}
 chop_stationary_trajectories {chop_stationary_trajectories}
-accelerate_stationary_decomp {accelerate_stationary_decomp}""".format(
+accelerate_stationary_decomp {accelerate_stationary_decomp}
+sim_chunk_size {sim_chunk_size}
+rand_ff_out {rand_ff_out}
+rand_ff_stats {rand_ff_stats}
+sim_correlation {sim_correlation}
+compress {compress}
+memory_horizon {memory_horizon}
+exp_fit_tolerance {exp_fit_tolerance}
+hmatrix_tolerance {hmatrix_tolerance}
+extend_kernel {extend_kernel}
+incremental {incremental}
+resampling_blocks {resampling_blocks}
+bootstrap_replicas {bootstrap_replicas}
+resampling_threads {resampling_threads}
+block_tolerance {block_tolerance}
+observable_blocks {observable_blocks}
+block_threads {block_threads}
+ff_threads {ff_threads}""".format(
             out_folder=self.out_folder,
             in_folder=self.in_folder,
             in_prefix=self.in_prefix,
@@ -122,7 +173,24 @@ accelerate_stationary_decomp {accelerate_stationary_decomp}""".format(
             darboux_sum=self.darboux_sum,
             stationary=self.stationary,
             chop_stationary_trajectories=self.chop_stationary_trajectories,
-            accelerate_stationary_decomp=self.accelerate_stationary_decomp)
+            accelerate_stationary_decomp=self.accelerate_stationary_decomp,
+            sim_chunk_size=self.sim_chunk_size,
+            rand_ff_out=self.rand_ff_out,
+            rand_ff_stats=self.rand_ff_stats,
+            sim_correlation=self.sim_correlation,
+            compress=self.compress,
+            memory_horizon=self.memory_horizon,
+            exp_fit_tolerance=self.exp_fit_tolerance,
+            hmatrix_tolerance=self.hmatrix_tolerance,
+            extend_kernel=self.extend_kernel,
+            incremental=self.incremental,
+            resampling_blocks=self.resampling_blocks,
+            bootstrap_replicas=self.bootstrap_replicas,
+            resampling_threads=self.resampling_threads,
+            block_tolerance=self.block_tolerance,
+            observable_blocks=self.observable_blocks,
+            block_threads=self.block_threads,
+            ff_threads=self.ff_threads)
         return parameter_file
 
     def write_parameter_file(self, parameter_filename):
@@ -25,6 +25,31 @@ import numpy as np
 
 def readBinary(filename):
   with open(filename, "rb") as file_handler:
+    if file_handler.read(8) == b"\x93TENSOR\n":
+      # version 2: fixed-size header, the payload starts at data_offset
+      dtypes = {"f32": "f4", "f64": "f8", "uc": "u1", "sc": "i1", "us": "u2", "s": "i2",
+                "u": "u4", "int": "i4", "ul": "u8", "l": "i8", "ull": "u8", "ll": "i8"}
+      order = "<" if struct.unpack("<I", file_handler.read(8)[4:])[0] == 0x01020304 else ">"
+      dtype = file_handler.read(8).rstrip(b"\0").decode()
+      elem_size, rank, data_size, data_offset = struct.unpack(order + "4Q", file_handler.read(32))
+      file_handler.seek(72)
+      shape = struct.unpack(order + "64Q", file_handler.read(512))[:rank]
+      strides = struct.unpack(order + "64Q", file_handler.read(512))[:rank]
+      encoding, symmetric = struct.unpack(order + "2I", file_handler.read(8))
+      if encoding != 0:
+        raise ValueError("Compressed binary files are not supported: " + filename)
+      file_handler.seek(data_offset)
+      data = np.frombuffer(file_handler.read(data_size * elem_size), dtype=order + dtypes[dtype])
+      if symmetric != 0:
+        # only the upper triangle of a symmetric matrix is stored
+        dim = int(np.prod(shape[:rank // 2]))
+        matrix = np.zeros((dim, dim))
+        matrix[np.triu_indices(dim)] = data
+        matrix += np.triu(matrix, 1).T
+        return matrix.reshape(shape)
+      data = np.lib.stride_tricks.as_strided(data, shape, [s * elem_size for s in strides])
+      return data.astype(np.double)
+    file_handler.seek(0)
     header_size = struct.unpack('n', file_handler.read(8))[0]
     shape = struct.unpack(header_size * 'n', file_handler.read(header_size * 8))
     data_size = struct.unpack('n', file_handler.read(8))[0]
@@ -50,6 +50,10 @@ params.gaussian_init_val = False
 params.darboux_sum = True
 params.stationary = False
 params.accelerate_stationary_decomp = False
+params.sim_chunk_size = 1000
+params.rand_ff_out = -1
+params.rand_ff_stats = False
+params.sim_correlation = False
 
 # RUN CPP EXECUTABLES
 run(params)
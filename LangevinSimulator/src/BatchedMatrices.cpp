@@ -0,0 +1,276 @@
+/**
+LangevinSimulator Version 1.0
+
+Copyright 2020-2022 Christoph Widder and Fabian Glatzel
+
+Christoph Widder <christoph.widder[at]merkur.uni-freiburg.de>
+Fabian Glatzel <fabian.glatzel[at]physik.uni-freiburg.de>
+
+This file is part of LangevinSimulator.
+
+LangevinSimulator is free software: you can redistribute it and/or modify it under the terms of
+the GNU General Public License as published by the Free Software Foundation, either
+version 3 of the License, or (at your option) any later version.
+
+LangevinSimulator is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with LangevinSimulator.
+If not, see <https://www.gnu.org/licenses/>.
+**/
+
+#include "BatchedMatrices.hpp"
+#include "GslAdapter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <gsl/gsl_blas.h>
+#include <gsl/gsl_linalg.h>
+#include <gsl/gsl_permutation.h>
+
+using namespace std;
+using namespace TensorUtils;
+
+namespace
+{
+    // BATCH-MAJOR LAYOUT: a[(i*m+j)*num_batch+n] = mat(n,i,j)
+    vector<double> toBatchMajor(tensor<double,3> &mat)
+    {
+        size_t num_batch = mat.shape[0];
+        size_t m = mat.shape[1]*mat.shape[2];
+        vector<double> a(m*num_batch);
+        for(size_t n=0; n<num_batch; n++)
+        {
+            for(size_t k=0; k<m; k++)
+            {
+                a[k*num_batch+n] = mat[n*m+k];
+            }
+        }
+        return a;
+    }
+
+    void fromBatchMajor(vector<double> &a, tensor<double,3> &mat)
+    {
+        size_t num_batch = mat.shape[0];
+        size_t m = mat.shape[1]*mat.shape[2];
+        for(size_t n=0; n<num_batch; n++)
+        {
+            for(size_t k=0; k<m; k++)
+            {
+                mat[n*m+k] = a[k*num_batch+n];
+            }
+        }
+    }
+
+    // IN-PLACE CHOLESKY DECOMPOSITION a = L*L^T OF ALL MATRICES IN BATCH-MAJOR LAYOUT
+    // ONLY THE LOWER TRIANGLE IS USED AND OVERWRITTEN BY L
+    // failed[n] IS SET, IF THE n-TH MATRIX IS NOT POSITIVE DEFINITE
+    void choleskyDecomp(vector<double> &a, size_t m, size_t num_batch, vector<char> &failed)
+    {
+        failed.assign(num_batch,0);
+        for(size_t j=0; j<m; j++)
+        {
+            double *a_jj = &a[(j*m+j)*num_batch];
+            for(size_t k=0; k<j; k++)
+            {
+                const double *a_jk = &a[(j*m+k)*num_batch];
+                for(size_t n=0; n<num_batch; n++)
+                {
+                    a_jj[n] -= a_jk[n]*a_jk[n];
+                }
+            }
+            for(size_t n=0; n<num_batch; n++)
+            {
+                if(!(a_jj[n] > 0.0))
+                {
+                    failed[n] = 1;
+                    a_jj[n] = 1.0;
+                }
+                a_jj[n] = sqrt(a_jj[n]);
+            }
+            for(size_t i=j+1; i<m; i++)
+            {
+                double *a_ij = &a[(i*m+j)*num_batch];
+                for(size_t k=0; k<j; k++)
+                {
+                    const double *a_ik = &a[(i*m+k)*num_batch];
+                    const double *a_jk = &a[(j*m+k)*num_batch];
+                    for(size_t n=0; n<num_batch; n++)
+                    {
+                        a_ij[n] -= a_ik[n]*a_jk[n];
+                    }
+                }
+                for(size_t n=0; n<num_batch; n++)
+                {
+                    a_ij[n] /= a_jj[n];
+                }
+            }
+        }
+    }
+
+    // SOLVES x*(L*L^T) = b FOR ALL k ROWS OF b IN BATCH-MAJOR LAYOUT b[(r*m+i)*num_batch+n], x OVERWRITES b
+    void choleskySolve(vector<double> &l, vector<double> &b, size_t m, size_t k, size_t num_batch)
+    {
+        for(size_t r=0; r<k; r++)
+        {
+            // FORWARD SUBSTITUTION L*y = b^T
+            for(size_t i=0; i<m; i++)
+            {
+                double *b_i = &b[(r*m+i)*num_batch];
+                for(size_t j=0; j<i; j++)
+                {
+                    const double *l_ij = &l[(i*m+j)*num_batch];
+                    const double *b_j = &b[(r*m+j)*num_batch];
+                    for(size_t n=0; n<num_batch; n++)
+                    {
+                        b_i[n] -= l_ij[n]*b_j[n];
+                    }
+                }
+                const double *l_ii = &l[(i*m+i)*num_batch];
+                for(size_t n=0; n<num_batch; n++)
+                {
+                    b_i[n] /= l_ii[n];
+                }
+            }
+            // BACKWARD SUBSTITUTION L^T*x = y
+            for(size_t i=m; i-->0;)
+            {
+                double *b_i = &b[(r*m+i)*num_batch];
+                for(size_t j=i+1; j<m; j++)
+                {
+                    const double *l_ji = &l[(j*m+i)*num_batch];
+                    const double *b_j = &b[(r*m+j)*num_batch];
+                    for(size_t n=0; n<num_batch; n++)
+                    {
+                        b_i[n] -= l_ji[n]*b_j[n];
+                    }
+                }
+                const double *l_ii = &l[(i*m+i)*num_batch];
+                for(size_t n=0; n<num_batch; n++)
+                {
+                    b_i[n] /= l_ii[n];
+                }
+            }
+        }
+    }
+
+    // LU INVERSION OF THE n-TH MATRIX WITHOUT ELEMENT-WISE COPIES
+    void luInvert(tensor<double,3> &mat, size_t n, gsl_matrix *lu, gsl_permutation *permutation, tensor<double,3> &inverse)
+    {
+        size_t m = mat.shape[1];
+        int signum;
+        gsl_matrix_const_view src = gsl_matrix_const_view_array(&mat[n*m*m],m,m);
+        gsl_matrix_view dest = gsl_matrix_view_array(&inverse[n*m*m],m,m);
+        gsl_matrix_memcpy(lu,&src.matrix);
+        gsl_linalg_LU_decomp(lu,permutation,&signum);
+        gsl_linalg_LU_invert(lu,permutation,&dest.matrix);
+    }
+}
+
+tensor<double,3> BatchedMatrices::invert(tensor<double,3> &mat, bool spd)
+{
+    size_t num_batch = mat.shape[0];
+    size_t m = mat.shape[1];
+    if(mat.shape[2] != m)
+    {
+        throw ErrorHandler::ShapeMismatch("BatchedMatrices::invert: Shape mismatch: Matrices are not square!");
+    }
+    tensor<double,3> inverse;
+    inverse.alloc_uninitialized(mat.shape);
+    vector<char> failed(num_batch,1);
+    if(spd)
+    {
+        vector<double> l = toBatchMajor(mat);
+        choleskyDecomp(l,m,num_batch,failed);
+        vector<double> b(m*m*num_batch,0.0);
+        for(size_t i=0; i<m; i++)
+        {
+            fill(&b[(i*m+i)*num_batch],&b[(i*m+i)*num_batch]+num_batch,1.0);
+        }
+        choleskySolve(l,b,m,m,num_batch);
+        fromBatchMajor(b,inverse);
+    }
+    gsl_matrix *lu = gsl_matrix_alloc(m,m);
+    gsl_permutation *permutation = gsl_permutation_alloc(m);
+    for(size_t n=0; n<num_batch; n++)
+    {
+        if(failed[n])
+        {
+            luInvert(mat,n,lu,permutation,inverse);
+        }
+    }
+    gsl_permutation_free(permutation);
+    gsl_matrix_free(lu);
+    return inverse;
+}
+
+tensor<double,3> BatchedMatrices::solveRight(tensor<double,3> &rhs, tensor<double,3> &mat, bool spd)
+{
+    size_t num_batch = rhs.shape[0];
+    size_t k = rhs.shape[1];
+    size_t m = rhs.shape[2];
+    bool shared = (mat.shape[0] == 1);
+    if(mat.shape[1] != m || mat.shape[2] != m || (!shared && mat.shape[0] != num_batch))
+    {
+        throw ErrorHandler::ShapeMismatch("BatchedMatrices::solveRight: Shape mismatch: Matrices do not fit to the right-hand sides!");
+    }
+    tensor<double,3> solution;
+    if(shared)
+    {
+        // ALL RIGHT-HAND SIDES FORM A SINGLE (num_batch*k) x m MATRIX
+        solution = rhs;
+        gsl_matrix_view x = GslAdapter::matrix(solution,num_batch*k,m);
+        vector<char> failed(1,1);
+        vector<double> l;
+        if(spd)
+        {
+            l = toBatchMajor(mat);
+            choleskyDecomp(l,m,1,failed);
+        }
+        if(!failed[0])
+        {
+            gsl_matrix_const_view l_mat = gsl_matrix_const_view_array(l.data(),m,m);
+            gsl_blas_dtrsm(CblasRight,CblasLower,CblasTrans,CblasNonUnit,1.0,&l_mat.matrix,&x.matrix);
+            gsl_blas_dtrsm(CblasRight,CblasLower,CblasNoTrans,CblasNonUnit,1.0,&l_mat.matrix,&x.matrix);
+        }
+        else
+        {
+            tensor<double,3> inverse = invert(mat);
+            gsl_matrix_const_view inv = GslAdapter::const_matrix(inverse,m,m);
+            gsl_matrix_const_view b = GslAdapter::const_matrix(rhs,num_batch*k,m);
+            gsl_blas_dgemm(CblasNoTrans,CblasNoTrans,1.0,&b.matrix,&inv.matrix,0.0,&x.matrix);
+        }
+        return solution;
+    }
+    solution.alloc_uninitialized(rhs.shape);
+    vector<char> failed(num_batch,1);
+    if(spd)
+    {
+        vector<double> l = toBatchMajor(mat);
+        choleskyDecomp(l,m,num_batch,failed);
+        vector<double> b = toBatchMajor(rhs);
+        choleskySolve(l,b,m,k,num_batch);
+        fromBatchMajor(b,solution);
+    }
+    gsl_matrix *lu = gsl_matrix_alloc(m,m);
+    gsl_permutation *permutation = gsl_permutation_alloc(m);
+    tensor<double,3> inverse;
+    inverse.alloc_uninitialized(mat.shape);
+    for(size_t n=0; n<num_batch; n++)
+    {
+        if(failed[n])
+        {
+            luInvert(mat,n,lu,permutation,inverse);
+            gsl_matrix_const_view inv = gsl_matrix_const_view_array(&inverse[n*m*m],m,m);
+            gsl_matrix_const_view b = gsl_matrix_const_view_array(&rhs[n*k*m],k,m);
+            gsl_matrix_view x = gsl_matrix_view_array(&solution[n*k*m],k,m);
+            gsl_blas_dgemm(CblasNoTrans,CblasNoTrans,1.0,&b.matrix,&inv.matrix,0.0,&x.matrix);
+        }
+    }
+    gsl_permutation_free(permutation);
+    gsl_matrix_free(lu);
+    return solution;
+}
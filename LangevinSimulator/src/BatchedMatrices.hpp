@@ -0,0 +1,57 @@
+/**
+LangevinSimulator Version 1.0
+
+Copyright 2020-2022 Christoph Widder and Fabian Glatzel
+
+Christoph Widder <christoph.widder[at]merkur.uni-freiburg.de>
+Fabian Glatzel <fabian.glatzel[at]physik.uni-freiburg.de>
+
+This file is part of LangevinSimulator.
+
+LangevinSimulator is free software: you can redistribute it and/or modify it under the terms of
+the GNU General Public License as published by the Free Software Foundation, either
+version 3 of the License, or (at your option) any later version.
+
+LangevinSimulator is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with LangevinSimulator.
+If not, see <https://www.gnu.org/licenses/>.
+**/
+
+#ifndef BATCHEDMATRICES_HPP
+#define BATCHEDMATRICES_HPP
+
+#include "TensorUtils.hpp"
+
+/*!
+    \brief This namespace provides inversions and solves of many small square matrices at once,
+    e.g. the `num_obs x num_obs` blocks of the correlation function at equal times.
+
+    A batch of matrices is stored as a tensor `mat(n,i,j)` of shape `{num_batch,m,m}`.
+    Symmetric positive definite matrices, e.g. correlation matrices, are decomposed by Cholesky decompositions, whose loops run over the batch index innermost.
+    Hence, the arithmetic is vectorized across the batch instead of paying the overhead of one GSL call per small matrix.
+    Matrices, which turn out not to be positive definite, and general matrices are LU decomposed one at a time.
+*/
+namespace BatchedMatrices
+{
+    /*!
+        \brief Returns the inverses `return_val(n,:,:)=mat(n,:,:)^{-1}`.
+
+        If `spd` is true, the matrices are assumed to be symmetric positive definite.
+    */
+    TensorUtils::tensor<double,3> invert(TensorUtils::tensor<double,3> &mat, bool spd=false);
+
+    /*!
+        \brief Returns the solutions `return_val(n,:,:)=rhs(n,:,:)*mat(n,:,:)^{-1}` without forming the inverses.
+
+        `rhs` has the shape `{num_batch,k,m}`. `mat` has the shape `{num_batch,m,m}`, or `{1,m,m}` if a single matrix is shared by all right-hand sides.
+        In the latter case, the matrix is decomposed once and all right-hand sides are solved by triangular solves of BLAS level 3.
+        If `spd` is true, the matrices are assumed to be symmetric positive definite.
+        Throws \ref TensorUtils::ErrorHandler::ShapeMismatch, if the shapes do not fit.
+    */
+    TensorUtils::tensor<double,3> solveRight(TensorUtils::tensor<double,3> &rhs, TensorUtils::tensor<double,3> &mat, bool spd=false);
+}
+
+#endif // BATCHEDMATRICES_HPP
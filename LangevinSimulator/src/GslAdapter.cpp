@@ -0,0 +1,97 @@
+/**
+LangevinSimulator Version 1.0
+
+Copyright 2020-2022 Christoph Widder and Fabian Glatzel
+
+Christoph Widder <christoph.widder[at]merkur.uni-freiburg.de>
+Fabian Glatzel <fabian.glatzel[at]physik.uni-freiburg.de>
+
+This file is part of LangevinSimulator.
+
+LangevinSimulator is free software: you can redistribute it and/or modify it under the terms of
+the GNU General Public License as published by the Free Software Foundation, either
+version 3 of the License, or (at your option) any later version.
+
+LangevinSimulator is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with LangevinSimulator.
+If not, see <https://www.gnu.org/licenses/>.
+**/
+
+#include "GslAdapter.hpp"
+
+using namespace std;
+using namespace TensorUtils;
+
+gsl_matrix_view GslAdapter::matrix(TensorBase<double> &tensor, size_t num_rows, size_t num_cols)
+{
+    if(num_rows*num_cols != tensor.size())
+    {
+        throw ErrorHandler::ShapeMismatch("GslAdapter::matrix: Shape mismatch: Number of matrix elements differs from tensor size!");
+    }
+    return gsl_matrix_view_array(tensor.data(), num_rows, num_cols);
+}
+
+gsl_matrix_view GslAdapter::matrix(TensorBase<double> &tensor)
+{
+    size_t rank = tensor.shape.size();
+    if(rank%2 != 0)
+    {
+        throw ErrorHandler::ShapeMismatch("GslAdapter::matrix: Shape mismatch: Tensor rank is odd!");
+    }
+    size_t num_rows = 1;
+    size_t num_cols = 1;
+    for(size_t n=0; n<rank/2; n++)
+    {
+        num_rows *= tensor.shape[n];
+        num_cols *= tensor.shape[rank/2+n];
+    }
+    if(num_rows != num_cols)
+    {
+        throw ErrorHandler::ShapeMismatch("GslAdapter::matrix: Shape mismatch: Matrix is not square!");
+    }
+    return gsl_matrix_view_array(tensor.data(), num_rows, num_cols);
+}
+
+gsl_matrix_const_view GslAdapter::const_matrix(const TensorBase<double> &tensor, size_t num_rows, size_t num_cols)
+{
+    if(num_rows*num_cols != tensor.size())
+    {
+        throw ErrorHandler::ShapeMismatch("GslAdapter::const_matrix: Shape mismatch: Number of matrix elements differs from tensor size!");
+    }
+    return gsl_matrix_const_view_array(tensor.data(), num_rows, num_cols);
+}
+
+gsl_vector_view GslAdapter::vector(TensorBase<double> &tensor)
+{
+    return gsl_vector_view_array(tensor.data(), tensor.size());
+}
+
+tensor_view<double> GslAdapter::tensor(gsl_matrix *mat, const std::vector<size_t> &shape)
+{
+    size_t num_el = 1;
+    for(size_t n : shape)
+    {
+        num_el *= n;
+    }
+    if(num_el != mat->size1*mat->size2)
+    {
+        throw ErrorHandler::ShapeMismatch("GslAdapter::tensor: Shape mismatch: Number of tensor elements differs from matrix size!");
+    }
+    if(shape.size() == 2 && shape[1] == mat->size2)
+    {
+        return tensor_view<double>(mat->data, shape, {mat->tda, 1});
+    }
+    if(mat->tda != mat->size2)
+    {
+        throw ErrorHandler::ShapeMismatch("GslAdapter::tensor: Shape mismatch: Matrix rows are not contiguous!");
+    }
+    std::vector<size_t> incr(shape.size(), 1);
+    for(size_t n=shape.size(); n-->1;)
+    {
+        incr[n-1] = incr[n]*shape[n];
+    }
+    return tensor_view<double>(mat->data, shape, incr);
+}
@@ -0,0 +1,85 @@
+/**
+LangevinSimulator Version 1.0
+
+Copyright 2020-2022 Christoph Widder and Fabian Glatzel
+
+Christoph Widder <christoph.widder[at]merkur.uni-freiburg.de>
+Fabian Glatzel <fabian.glatzel[at]physik.uni-freiburg.de>
+
+This file is part of LangevinSimulator.
+
+LangevinSimulator is free software: you can redistribute it and/or modify it under the terms of
+the GNU General Public License as published by the Free Software Foundation, either
+version 3 of the License, or (at your option) any later version.
+
+LangevinSimulator is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with LangevinSimulator.
+If not, see <https://www.gnu.org/licenses/>.
+**/
+
+#ifndef GSLADAPTER_HPP
+#define GSLADAPTER_HPP
+
+#include <vector>
+
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_vector.h>
+
+#include "TensorUtils.hpp"
+
+/*!
+    \brief This namespace provides views, which share the memory of tensors with GSL matrices and vectors and vice versa.
+
+    No data is copied. Hence, GSL routines may read and write tensors directly.
+    A view is invalidated, if the viewed tensor or matrix is reallocated or freed.
+    Tensors are viewed in lexicographical order of their indices, e.g. the correlation `C(t,i,s,j)`
+    is viewed as the `(num_ts*num_obs) x (num_ts*num_obs)` matrix with rows `t*num_obs+i` and columns `s*num_obs+j`.
+    \code
+    TensorUtils::tensor<double,4> correlation({num_ts,num_obs,num_ts,num_obs});
+    gsl_matrix_view corr = GslAdapter::matrix(correlation);
+    gsl_matrix_set_identity(&corr.matrix);  // correlation(t,i,t,i) == 1.0
+    \endcode
+*/
+namespace GslAdapter
+{
+    /*!
+        \brief Returns the `num_rows x num_cols` matrix view of the components of `tensor`.
+
+        Throws \ref TensorUtils::ErrorHandler::ShapeMismatch, if `num_rows*num_cols` differs from the number of components.
+    */
+    gsl_matrix_view matrix(TensorUtils::TensorBase<double> &tensor, size_t num_rows, size_t num_cols);
+
+    /*!
+        \brief Returns the square matrix view of a tensor of even rank `2n`.
+
+        The rows are enumerated by the first `n` indices and the columns by the last `n` indices.
+        Throws \ref TensorUtils::ErrorHandler::ShapeMismatch, if the rank is odd or the matrix is not square.
+    */
+    gsl_matrix_view matrix(TensorUtils::TensorBase<double> &tensor);
+
+    /*!
+        \brief Returns the read-only `num_rows x num_cols` matrix view of the components of `tensor`.
+
+        See \ref matrix(TensorUtils::TensorBase<double> &tensor, size_t num_rows, size_t num_cols).
+    */
+    gsl_matrix_const_view const_matrix(const TensorUtils::TensorBase<double> &tensor, size_t num_rows, size_t num_cols);
+
+    /*!
+        \brief Returns the vector view of all components of `tensor`.
+    */
+    gsl_vector_view vector(TensorUtils::TensorBase<double> &tensor);
+
+    /*!
+        \brief Returns the tensor view with the given `shape` of the components of the GSL matrix `mat`.
+
+        The components are viewed in row-major order. Padded rows, i.e. `mat->tda > mat->size2`, are supported
+        for views of rank two only. Throws \ref TensorUtils::ErrorHandler::ShapeMismatch,
+        if the product of `shape` differs from `mat->size1*mat->size2`.
+    */
+    TensorUtils::tensor_view<double> tensor(gsl_matrix *mat, const std::vector<size_t> &shape);
+}
+
+#endif // GSLADAPTER_HPP
@@ -0,0 +1,427 @@
+/**
+LangevinSimulator Version 1.0
+
+Copyright 2020-2022 Christoph Widder and Fabian Glatzel
+
+Christoph Widder <christoph.widder[at]merkur.uni-freiburg.de>
+Fabian Glatzel <fabian.glatzel[at]physik.uni-freiburg.de>
+
+This file is part of LangevinSimulator.
+
+LangevinSimulator is free software: you can redistribute it and/or modify it under the terms of
+the GNU General Public License as published by the Free Software Foundation, either
+version 3 of the License, or (at your option) any later version.
+
+LangevinSimulator is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with LangevinSimulator.
+If not, see <https://www.gnu.org/licenses/>.
+**/
+
+#include "HierarchicalKernel.hpp"
+#include "GslAdapter.hpp"
+
+#include <cmath>
+
+#include <gsl/gsl_blas.h>
+#include <gsl/gsl_linalg.h>
+
+using namespace std;
+using namespace TensorUtils;
+
+HierarchicalKernel::HierarchicalKernel()
+{
+    num_time_steps = 0;
+    num_observables = 0;
+}
+
+HierarchicalKernel::HierarchicalKernel(tensor<double,4> &kernel, double tolerance, size_t leaf_size)
+{
+    if(kernel.shape[0] != kernel.shape[1] || kernel.shape[2] != kernel.shape[3])
+    {
+        throw ErrorHandler::ShapeMismatch("HierarchicalKernel: Shape mismatch: Expected kernel of shape {num_ts,num_ts,num_obs,num_obs}!");
+    }
+    num_time_steps = kernel.shape[0];
+    num_observables = kernel.shape[2];
+    compress(kernel,0,num_time_steps,tolerance,max<size_t>(leaf_size,1));
+    index();
+}
+
+HierarchicalKernel::~HierarchicalKernel()
+{
+    //dtor
+}
+
+void HierarchicalKernel::compress(tensor<double,4> &kernel, size_t begin, size_t end, double tolerance, size_t leaf_size)
+{
+    const size_t num_obs = num_observables;
+    if(end-begin <= leaf_size)
+    {
+        // DENSE DIAGONAL BLOCK
+        Block leaf {begin,end,begin,end,false,{},{}};
+        const size_t n = (end-begin)*num_obs;
+        leaf.U.alloc({n,n},0.0);
+        for(size_t t=begin; t<end; t++)
+        {
+            for(size_t s=begin; s<=t; s++)
+            {
+                for(size_t i=0; i<num_obs; i++)
+                {
+                    for(size_t j=0; j<num_obs; j++)
+                    {
+                        leaf.U((t-begin)*num_obs+i,(s-begin)*num_obs+j) = kernel(t,s,i,j);
+                    }
+                }
+            }
+        }
+        leaves.push_back(std::move(leaf));
+        return;
+    }
+    const size_t mid = begin+(end-begin)/2;
+    compress(kernel,begin,mid,tolerance,leaf_size);
+    compress(kernel,mid,end,tolerance,leaf_size);
+
+    // OFF-DIAGONAL BLOCK, NOTE THAT m>=n
+    Block block {mid,end,begin,mid,true,{},{}};
+    const size_t m = (end-mid)*num_obs;
+    const size_t n = (mid-begin)*num_obs;
+    tensor<double,2> D({m,n});
+    double norm = 0.0;
+    for(size_t t=mid; t<end; t++)
+    {
+        for(size_t i=0; i<num_obs; i++)
+        {
+            for(size_t s=begin; s<mid; s++)
+            {
+                for(size_t j=0; j<num_obs; j++)
+                {
+                    D((t-mid)*num_obs+i,(s-begin)*num_obs+j) = kernel(t,s,i,j);
+                    norm += kernel(t,s,i,j)*kernel(t,s,i,j);
+                }
+            }
+        }
+    }
+    if(norm == 0.0)
+    {
+        blocks.push_back(std::move(block)); // RANK ZERO
+        return;
+    }
+
+    // TRUNCATED SINGULAR VALUE DECOMPOSITION D = U S V^T
+    tensor<double,2> U = D;
+    gsl_matrix_view U_mat = GslAdapter::matrix(U,m,n);
+    gsl_matrix * V = gsl_matrix_alloc(n,n);
+    gsl_vector * S = gsl_vector_alloc(n);
+    gsl_vector * work = gsl_vector_alloc(n);
+    gsl_linalg_SV_decomp(&U_mat.matrix,V,S,work);
+    gsl_vector_free(work);
+    size_t rank = n;
+    double tail = 0.0;
+    while(rank>0 && tail+gsl_vector_get(S,rank-1)*gsl_vector_get(S,rank-1) <= tolerance*tolerance*norm)
+    {
+        tail += gsl_vector_get(S,rank-1)*gsl_vector_get(S,rank-1);
+        rank--;
+    }
+    if(rank*(m+n) >= m*n)
+    {
+        block.low_rank = false;
+        block.U = std::move(D);
+    }
+    else if(rank > 0)
+    {
+        block.U.alloc_uninitialized({m,rank});
+        block.V.alloc_uninitialized({n,rank});
+        for(size_t k=0; k<rank; k++)
+        {
+            for(size_t r=0; r<m; r++)
+            {
+                block.U(r,k) = U(r,k)*gsl_vector_get(S,k);
+            }
+            for(size_t c=0; c<n; c++)
+            {
+                block.V(c,k) = gsl_matrix_get(V,c,k);
+            }
+        }
+    }
+    gsl_matrix_free(V);
+    gsl_vector_free(S);
+    blocks.push_back(std::move(block));
+}
+
+void HierarchicalKernel::index()
+{
+    leaf_index.assign(num_time_steps,leaves.size());
+    for(size_t l=0; l<leaves.size(); l++)
+    {
+        for(size_t t=leaves[l].row_begin; t<leaves[l].row_end; t++)
+        {
+            leaf_index[t] = l;
+        }
+    }
+    blocks_by_col_end.assign(num_time_steps+1,{});
+    for(size_t b=0; b<blocks.size(); b++)
+    {
+        blocks_by_col_end[blocks[b].col_end].push_back(b);
+    }
+}
+
+size_t HierarchicalKernel::num_ts() const
+{
+    return num_time_steps;
+}
+
+size_t HierarchicalKernel::num_obs() const
+{
+    return num_observables;
+}
+
+size_t HierarchicalKernel::size() const
+{
+    size_t num_el = 0;
+    for(const Block &leaf : leaves)
+    {
+        num_el += leaf.U.size();
+    }
+    for(const Block &block : blocks)
+    {
+        num_el += block.U.size()+block.V.size();
+    }
+    return num_el;
+}
+
+tensor<double,4> HierarchicalKernel::dense() const
+{
+    const size_t num_obs = num_observables;
+    tensor<double,4> kernel({num_time_steps,num_time_steps,num_obs,num_obs},0.0);
+    for(const Block &leaf : leaves)
+    {
+        const size_t n = (leaf.row_end-leaf.row_begin)*num_obs;
+        for(size_t t=leaf.row_begin; t<leaf.row_end; t++)
+        {
+            for(size_t s=leaf.col_begin; s<=t; s++)
+            {
+                for(size_t i=0; i<num_obs; i++)
+                {
+                    for(size_t j=0; j<num_obs; j++)
+                    {
+                        kernel(t,s,i,j) = leaf.U[((t-leaf.row_begin)*num_obs+i)*n+(s-leaf.col_begin)*num_obs+j];
+                    }
+                }
+            }
+        }
+    }
+    for(const Block &block : blocks)
+    {
+        if(block.U.empty())
+        {
+            continue;
+        }
+        const size_t m = (block.row_end-block.row_begin)*num_obs;
+        const size_t n = (block.col_end-block.col_begin)*num_obs;
+        tensor<double,2> D;
+        if(block.low_rank)
+        {
+            D.alloc_uninitialized({m,n});
+            gsl_matrix_const_view U = GslAdapter::const_matrix(block.U,m,block.U.shape[1]);
+            gsl_matrix_const_view V = GslAdapter::const_matrix(block.V,n,block.V.shape[1]);
+            gsl_matrix_view D_mat = GslAdapter::matrix(D,m,n);
+            gsl_blas_dgemm(CblasNoTrans,CblasTrans,1.0,&U.matrix,&V.matrix,0.0,&D_mat.matrix);
+        }
+        else
+        {
+            D = block.U;
+        }
+        for(size_t t=block.row_begin; t<block.row_end; t++)
+        {
+            for(size_t s=block.col_begin; s<block.col_end; s++)
+            {
+                for(size_t i=0; i<num_obs; i++)
+                {
+                    for(size_t j=0; j<num_obs; j++)
+                    {
+                        kernel(t,s,i,j) = D((t-block.row_begin)*num_obs+i,(s-block.col_begin)*num_obs+j);
+                    }
+                }
+            }
+        }
+    }
+    return kernel;
+}
+
+void HierarchicalKernel::step(size_t t, const gsl_matrix *x, gsl_matrix *y)
+{
+    const size_t num_obs = num_observables;
+    const size_t num_traj = x->size2;
+
+    // OFF-DIAGONAL BLOCKS WITH COLUMNS s<t
+    for(size_t b : blocks_by_col_end[t])
+    {
+        const Block &block = blocks[b];
+        if(block.U.empty())
+        {
+            continue;
+        }
+        const size_t m = (block.row_end-block.row_begin)*num_obs;
+        const size_t n = (block.col_end-block.col_begin)*num_obs;
+        gsl_matrix_const_view x_s = gsl_matrix_const_submatrix(x,block.col_begin*num_obs,0,n,num_traj);
+        gsl_matrix_view y_t = gsl_matrix_submatrix(y,block.row_begin*num_obs,0,m,num_traj);
+        if(block.low_rank)
+        {
+            const size_t rank = block.U.shape[1];
+            if(buffer.size() < rank*num_traj)
+            {
+                buffer.alloc_uninitialized({rank,num_traj});
+            }
+            gsl_matrix_view VTx = gsl_matrix_view_array(buffer.data(),rank,num_traj);
+            gsl_matrix_const_view U = GslAdapter::const_matrix(block.U,m,rank);
+            gsl_matrix_const_view V = GslAdapter::const_matrix(block.V,n,rank);
+            gsl_blas_dgemm(CblasTrans,CblasNoTrans,1.0,&V.matrix,&x_s.matrix,0.0,&VTx.matrix);
+            gsl_blas_dgemm(CblasNoTrans,CblasNoTrans,1.0,&U.matrix,&VTx.matrix,1.0,&y_t.matrix);
+        }
+        else
+        {
+            gsl_matrix_const_view D = GslAdapter::const_matrix(block.U,m,n);
+            gsl_blas_dgemm(CblasNoTrans,CblasNoTrans,1.0,&D.matrix,&x_s.matrix,1.0,&y_t.matrix);
+        }
+    }
+
+    // DIAGONAL BLOCK WITH COLUMNS row_begin<=s<t
+    const Block &leaf = leaves[leaf_index[t]];
+    if(t > leaf.row_begin)
+    {
+        const size_t n = (leaf.row_end-leaf.row_begin)*num_obs;
+        const size_t r = (t-leaf.row_begin)*num_obs;
+        gsl_matrix_const_view D = GslAdapter::const_matrix(leaf.U,n,n);
+        gsl_matrix_const_view D_t = gsl_matrix_const_submatrix(&D.matrix,r,0,num_obs,r);
+        gsl_matrix_const_view x_s = gsl_matrix_const_submatrix(x,leaf.row_begin*num_obs,0,r,num_traj);
+        gsl_matrix_view y_t = gsl_matrix_submatrix(y,t*num_obs,0,num_obs,num_traj);
+        gsl_blas_dgemm(CblasNoTrans,CblasNoTrans,1.0,&D_t.matrix,&x_s.matrix,1.0,&y_t.matrix);
+    }
+}
+
+void HierarchicalKernel::multiply(const gsl_matrix *x, gsl_matrix *y)
+{
+    gsl_matrix_set_zero(y);
+    for(size_t t=0; t<num_time_steps; t++)
+    {
+        step(t,x,y);
+    }
+}
+
+void HierarchicalKernel::write(string filename, filesystem::path out_path) const
+{
+    size_t num_el = 4+2*leaves.size()+5*blocks.size()+size();
+    tensor<double,1> flat({num_el});
+    size_t pos = 0;
+    flat[pos++] = num_time_steps;
+    flat[pos++] = num_observables;
+    flat[pos++] = leaves.size();
+    flat[pos++] = blocks.size();
+    for(const Block &leaf : leaves)
+    {
+        flat[pos++] = leaf.row_begin;
+        flat[pos++] = leaf.row_end;
+        copy(leaf.U.data(),leaf.U.data()+leaf.U.size(),&flat[pos]);
+        pos += leaf.U.size();
+    }
+    for(const Block &block : blocks)
+    {
+        flat[pos++] = block.row_begin;
+        flat[pos++] = block.row_end;
+        flat[pos++] = block.col_begin;
+        flat[pos++] = block.col_end;
+        flat[pos++] = block.low_rank ? (block.U.empty() ? 0.0 : block.U.shape[1]) : -1.0; // RANK, -1 IF DENSE
+        copy(block.U.data(),block.U.data()+block.U.size(),&flat[pos]);
+        pos += block.U.size();
+        copy(block.V.data(),block.V.data()+block.V.size(),&flat[pos]);
+        pos += block.V.size();
+    }
+    flat.write(filename,out_path);
+}
+
+void HierarchicalKernel::read(filesystem::path path)
+{
+    tensor<double,1> flat;
+    flat.read(path);
+    size_t pos = 0;
+    auto next = [&flat,&pos,&path]() -> size_t
+    {
+        if(pos >= flat.size() || flat[pos] < 0.0)
+        {
+            throw ErrorHandler::CorruptFile("HierarchicalKernel::read: Invalid compressed kernel: "+path.string());
+        }
+        return flat[pos++];
+    };
+    auto fill = [&flat,&pos,&path](tensor<double,2> &mat, size_t num_rows, size_t num_cols)
+    {
+        if(pos+num_rows*num_cols > flat.size())
+        {
+            throw ErrorHandler::CorruptFile("HierarchicalKernel::read: Invalid compressed kernel: "+path.string());
+        }
+        mat.alloc_uninitialized({num_rows,num_cols});
+        copy(flat.data()+pos,flat.data()+pos+num_rows*num_cols,mat.data());
+        pos += num_rows*num_cols;
+    };
+    num_time_steps = next();
+    num_observables = next();
+    const size_t num_obs = num_observables;
+    leaves.resize(next());
+    blocks.resize(next());
+    for(Block &leaf : leaves)
+    {
+        leaf.row_begin = leaf.col_begin = next();
+        leaf.row_end = leaf.col_end = next();
+        leaf.low_rank = false;
+        if(leaf.row_begin >= leaf.row_end || leaf.row_end > num_time_steps)
+        {
+            throw ErrorHandler::CorruptFile("HierarchicalKernel::read: Invalid compressed kernel: "+path.string());
+        }
+        fill(leaf.U,(leaf.row_end-leaf.row_begin)*num_obs,(leaf.row_end-leaf.row_begin)*num_obs);
+    }
+    for(Block &block : blocks)
+    {
+        block.row_begin = next();
+        block.row_end = next();
+        block.col_begin = next();
+        block.col_end = next();
+        if(block.col_begin >= block.col_end || block.col_end > block.row_begin || block.row_begin >= block.row_end || block.row_end > num_time_steps)
+        {
+            throw ErrorHandler::CorruptFile("HierarchicalKernel::read: Invalid compressed kernel: "+path.string());
+        }
+        const size_t m = (block.row_end-block.row_begin)*num_obs;
+        const size_t n = (block.col_end-block.col_begin)*num_obs;
+        if(pos >= flat.size())
+        {
+            throw ErrorHandler::CorruptFile("HierarchicalKernel::read: Invalid compressed kernel: "+path.string());
+        }
+        block.low_rank = flat[pos] >= 0.0;
+        if(block.low_rank)
+        {
+            size_t rank = next();
+            if(rank > 0)
+            {
+                fill(block.U,m,rank);
+                fill(block.V,n,rank);
+            }
+        }
+        else
+        {
+            pos++;
+            fill(block.U,m,n);
+        }
+    }
+    if(pos != flat.size())
+    {
+        throw ErrorHandler::CorruptFile("HierarchicalKernel::read: Invalid compressed kernel: "+path.string());
+    }
+    index();
+    for(size_t l : leaf_index)
+    {
+        if(l == leaves.size())
+        {
+            throw ErrorHandler::CorruptFile("HierarchicalKernel::read: Invalid compressed kernel: "+path.string());
+        }
+    }
+}
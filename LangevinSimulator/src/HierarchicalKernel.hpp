@@ -0,0 +1,146 @@
+/**
+LangevinSimulator Version 1.0
+
+Copyright 2020-2022 Christoph Widder and Fabian Glatzel
+
+Christoph Widder <christoph.widder[at]merkur.uni-freiburg.de>
+Fabian Glatzel <fabian.glatzel[at]physik.uni-freiburg.de>
+
+This file is part of LangevinSimulator.
+
+LangevinSimulator is free software: you can redistribute it and/or modify it under the terms of
+the GNU General Public License as published by the Free Software Foundation, either
+version 3 of the License, or (at your option) any later version.
+
+LangevinSimulator is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with LangevinSimulator.
+If not, see <https://www.gnu.org/licenses/>.
+**/
+
+#ifndef HIERARCHICALKERNEL_HPP
+#define HIERARCHICALKERNEL_HPP
+
+#include <vector>
+#include <string>
+#include <filesystem>
+
+#include <gsl/gsl_matrix.h>
+
+#include "TensorUtils.hpp"
+
+/*!
+    \brief This class stores the non-stationary memory kernel as a hierarchical low-rank matrix.
+
+    The kernel `K(t,s,i,j)` is viewed as the block lower triangular matrix with rows `t*num_obs+i` and columns `s*num_obs+j`.
+    The time interval is bisected recursively. The off-diagonal block, which couples the second half of an interval to its first half,
+    is stored as the truncated singular value decomposition `U V^T` and the diagonal blocks of at most `leaf_size` time-steps are stored densely.
+    If the off-diagonal blocks are numerically low rank, the memory requirements and the cost of the product with a history of trajectories
+    are `O(num_ts*log(num_ts))` instead of `O(num_ts^2)`.
+    \code
+    TensorUtils::tensor<double,4> kernel;
+    kernel.read(out_path/"kernel.f64");
+    HierarchicalKernel hkernel(kernel,1e-6);
+    hkernel.write("kernel_hmatrix.f64",out_path);
+    \endcode
+*/
+class HierarchicalKernel
+{
+    public:
+        //! \brief Returns an empty instantiation.
+        HierarchicalKernel();
+
+        /*!
+            \brief Compresses the memory kernel `kernel(t,s,i,j)` in the layout of `kernel.f64`.
+
+            Only the lower triangle `s<=t` is stored. The rank of each off-diagonal block is the smallest rank, for which the discarded
+            singular values have a norm below `tolerance` times the norm of the block. A block is stored densely,
+            if its low-rank representation would be larger.
+        */
+        HierarchicalKernel(TensorUtils::tensor<double,4> &kernel, double tolerance, size_t leaf_size=LEAF_SIZE);
+        virtual ~HierarchicalKernel();
+
+        /*!
+            \brief Writes the compressed kernel to `out_path/filename` as a one-dimensional binary tensor.
+
+            The tensor contains `num_ts`, `num_obs`, the number of diagonal and off-diagonal blocks,
+            followed by the time-intervals and the components of each block.
+        */
+        void write(std::string filename, std::filesystem::path out_path) const;
+
+        /*!
+            \brief Reads a compressed kernel, which was written by \ref write.
+
+            Throws \ref TensorUtils::ErrorHandler::CorruptFile, if the content is inconsistent.
+        */
+        void read(std::filesystem::path path);
+
+        //! \brief Returns the number of time-steps.
+        size_t num_ts() const;
+
+        //! \brief Returns the number of observables.
+        size_t num_obs() const;
+
+        //! \brief Returns the number of stored components. The dense kernel has `num_ts^2*num_obs^2` components.
+        size_t size() const;
+
+        //! \brief Returns the dense kernel `K(t,s,i,j)` in the layout of `kernel.f64`, where `K(t,s,i,j)=0` for `s>t`.
+        TensorUtils::tensor<double,4> dense() const;
+
+        /*!
+            \brief Advances the memory integrals `y(t) = sum_{s<t} K(t,s) x(s)` by one time-step.
+
+            `x` and `y` are `(num_ts*num_obs) x num_traj` matrices with rows `t*num_obs+i`.
+            Only the rows `s<t` of `x` are read. All off-diagonal blocks, whose columns end at `t`, are added to `y`,
+            which must be initialized with zeros before the first call. On exit, row `t` of `y` is complete.
+            Hence, calling `step` for `t=0,1,2,...` allows to compute `x(t+1)` from `y(t)` on the fly.
+        */
+        void step(size_t t, const gsl_matrix *x, gsl_matrix *y);
+
+        /*!
+            \brief Returns the memory integrals `y(t) = sum_{s<t} K(t,s) x(s)` for all `t`. See \ref step.
+        */
+        void multiply(const gsl_matrix *x, gsl_matrix *y);
+
+        //! \brief Default maximum number of time-steps of the dense diagonal blocks.
+        static const size_t LEAF_SIZE = 32;
+
+    protected:
+        //! \brief Block with rows `row_begin<=t<row_end` and columns `col_begin<=s<col_end`.
+        struct Block
+        {
+            size_t row_begin;
+            size_t row_end;
+            size_t col_begin;
+            size_t col_end;
+            //! \brief True, if the block is given by `U V^T`. Else, the block is stored densely in `U`.
+            bool low_rank;
+            TensorUtils::tensor<double,2> U;
+            TensorUtils::tensor<double,2> V;
+        };
+
+        //! \brief Recursively compresses the time-interval `begin<=t<end`.
+        void compress(TensorUtils::tensor<double,4> &kernel, size_t begin, size_t end, double tolerance, size_t leaf_size);
+
+        //! \brief Sets up the look-up tables \ref leaf_index and \ref blocks_by_col_end.
+        void index();
+
+        //! \private
+        size_t num_time_steps;
+        //! \private
+        size_t num_observables;
+        //! \private
+        std::vector<Block> leaves;
+        //! \private
+        std::vector<Block> blocks;
+        //! \private
+        std::vector<size_t> leaf_index;
+        //! \private
+        std::vector<std::vector<size_t>> blocks_by_col_end;
+        //! \private
+        TensorUtils::tensor<double,2> buffer;
+};
+
+#endif // HIERARCHICALKERNEL_HPP
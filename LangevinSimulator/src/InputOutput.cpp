@@ -229,30 +229,20 @@ tensor<double,3> InputOutput::readTrajectories(
 tensor<double,1> InputOutput::popTimes(tensor<double,3> &trajectories)
 {
     tensor<double,1> times({trajectories.shape[1]});
-    for(size_t i=0; i<times.size(); i++)
-    {
-        times(i) = trajectories(0,i,0);
-    }
+    tensor_view<double>(trajectories).slice({0}).range(1,0,1).copy_to(&times[0]);
 
-    tensor<double,3> buffer({trajectories.shape[0], trajectories.shape[1],trajectories.shape[2]-1});
-    for(size_t i=0; i<buffer.shape[0]; i++)
-    {
-        for(size_t j=0; j<buffer.shape[1]; j++)
-        {
-            for(size_t k=0; k<buffer.shape[2]; k++)
-            {
-                buffer(i,j,k) = trajectories(i,j,k+1);
-            }
-        }
-    }
-    trajectories = buffer;
+    // compact the observables in place
+    tensor_view<double> observables = tensor_view<double>(trajectories).range(2,1,trajectories.shape[2]);
+    observables.copy_to(&trajectories[0]);
+    trajectories.resize(observables.size());
+    trajectories.reshape(observables.shape);
 
     return times;
 };
 
 void InputOutput::write(
     tensor<double,1> &times,
-    tensor<double,2> &traj,
+    tensor_view<double> traj,
     filesystem::path out_path)
 {
     ofstream out;
@@ -277,16 +267,18 @@ void InputOutput::write(tensor<double,1> &times, tensor<double,4> &corr, filesys
     out.open(out_path);
     size_t num_ts = corr.shape[0];
     size_t num_obs = corr.shape[1];
-    tensor<double,3> buffer;
-    buffer = corr.transpose({0,2,1,3}).reshape({num_ts,num_ts,num_obs*num_obs});
+    tensor_view<double> buffer = tensor_view<double>(corr).transpose({0,2,1,3});
     for(size_t t1=0; t1<num_ts; t1++)
     {
         for(size_t t2=0; t2<num_ts; t2++)
         {
             out << times[t1] << '\t' << times[t2];
-            for(size_t k=0; k<num_obs*num_obs; k++)
+            for(size_t i=0; i<num_obs; i++)
             {
-                out << '\t' << buffer(t1,t2,k);
+                for(size_t j=0; j<num_obs; j++)
+                {
+                    out << '\t' << buffer(t1,t2,i,j);
+                }
             }
             out << '\n';
         }
@@ -302,14 +294,16 @@ void InputOutput::write(tensor<double,1> &times, tensor<double,3> &corr, filesys
     out.open(out_path);
     size_t num_ts = corr.shape[0];
     size_t num_obs = corr.shape[1];
-    tensor<double,2> buffer;
-    buffer = corr.transpose({0,2,1}).reshape({num_ts,num_obs*num_obs});
+    tensor_view<double> buffer = tensor_view<double>(corr).transpose({0,2,1});
     for(size_t t1=0; t1<num_ts; t1++)
     {
         out << times[t1];
-        for(size_t k=0; k<num_obs*num_obs; k++)
+        for(size_t i=0; i<num_obs; i++)
         {
-            out << '\t' << buffer(t1,k);
+            for(size_t j=0; j<num_obs; j++)
+            {
+                out << '\t' << buffer(t1,i,j);
+            }
         }
         out << '\n';
     }
@@ -64,6 +64,7 @@ namespace InputOutput
 
     /*!
         \brief Erase the times from the trajectories and return them as a one dimensional tensor instead.
+        The remaining observables are moved within the storage of `trajectories`, i.e. no second copy of the trajectories is allocated.
         \param trajectories Contains the trajectories obtained from
         \ref readTrajectories(std::vector<std::string> &data_files,double t_min,double t_max,size_t increment,size_t num_obs).
         \return Times for corresponding trajectories.
@@ -72,10 +73,11 @@ namespace InputOutput
 
     /*!
         \brief Write a trajectory to a text file. Directory must exist.
+        Accepts any two dimensional view, e.g. a single trajectory of an ensemble `tensor_view<double>(traj).slice({n})`.
 
         The first column stores the times, the following columns contain the observables.
     */
-    void write(TensorUtils::tensor<double,1> &times, TensorUtils::tensor<double,2> &traj, std::filesystem::path out_path);
+    void write(TensorUtils::tensor<double,1> &times, TensorUtils::tensor_view<double> traj, std::filesystem::path out_path);
 
     /*!
         \brief Write square matrices as a function of two times to a text file. Directory must exist.
@@ -21,18 +21,28 @@ If not, see <https://www.gnu.org/licenses/>.
 **/
 
 #include "KernelMethods.hpp"
+#include "GslAdapter.hpp"
+#include "BatchedMatrices.hpp"
 #include "InputOutput.hpp"
 #include "FourierTransforms.hpp"
 #include "RK4.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <iostream>
 #include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <thread>
 
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_blas.h>
 #include <gsl/gsl_permutation.h>
 #include <gsl/gsl_linalg.h>
+#include <gsl/gsl_rng.h>
 
 using namespace std;
 using namespace TensorUtils;
@@ -116,8 +126,7 @@ void KernelMethods::mollifyTrajectories(tensor<double,1> &times, tensor<double,3
     traj_pad.clear();
     tensor<double> new_times({num_ts-2*mollifier_width});
     new_times << times[mollifier_width];
-    times = new_times;
-    new_times.clear();
+    times = std::move(new_times);
 }
 
 tensor<double,4> KernelMethods::getCorrelationFunction(tensor<double,3> &traj, bool unbiased)
@@ -125,7 +134,6 @@ tensor<double,4> KernelMethods::getCorrelationFunction(tensor<double,3> &traj, b
     size_t num_traj = traj.shape[0];
     size_t num_ts = traj.shape[1];
     size_t num_obs = traj.shape[2];
-    gsl_matrix * in_buffer = gsl_matrix_alloc(num_traj,num_ts*num_obs);
     if(unbiased)
     {
          traj *= 1.0/sqrt(num_traj-1);
@@ -134,16 +142,95 @@ tensor<double,4> KernelMethods::getCorrelationFunction(tensor<double,3> &traj, b
     {
         traj *= 1.0/sqrt(num_traj);
     }
-    traj >> *in_buffer->data;
-    gsl_matrix * out_buffer = gsl_matrix_alloc(num_ts*num_obs,num_ts*num_obs);
-    gsl_blas_dgemm(CblasTrans, CblasNoTrans, 1.0, in_buffer, in_buffer, 0.0, out_buffer);
-    gsl_matrix_free(in_buffer);
-    tensor<double,4> correlation({num_ts,num_obs,num_ts,num_obs});
-    correlation << *out_buffer->data;
-    gsl_matrix_free(out_buffer);
+    gsl_matrix_const_view in_buffer = GslAdapter::const_matrix(traj,num_traj,num_ts*num_obs);
+    tensor<double,4> correlation;
+    correlation.alloc_uninitialized({num_ts,num_obs,num_ts,num_obs});
+    gsl_matrix_view out_buffer = GslAdapter::matrix(correlation);
+    // the correlation is symmetric: compute the upper triangle only and mirror it tile by tile
+    gsl_blas_dsyrk(CblasUpper, CblasTrans, 1.0, &in_buffer.matrix, 0.0, &out_buffer.matrix);
+    size_t num_tot = num_ts*num_obs;
+    size_t tile = 64;
+    double *data = out_buffer.matrix.data;
+    for(size_t a0=0; a0<num_tot; a0+=tile)
+    {
+        for(size_t b0=a0; b0<num_tot; b0+=tile)
+        {
+            for(size_t b=b0; b<min(b0+tile,num_tot); b++)
+            {
+                for(size_t a=a0; a<min(a0+tile,b); a++)
+                {
+                    data[b*num_tot+a] = data[a*num_tot+b];
+                }
+            }
+        }
+    }
+    return correlation;
+}
+
+tensor<double,4> KernelMethods::getBandedCorrelationFunction(tensor<double,3> &traj, size_t width, bool unbiased)
+{
+    size_t num_traj = traj.shape[0];
+    size_t num_ts = traj.shape[1];
+    size_t num_obs = traj.shape[2];
+    tensor<double,3> rows;
+    rows = traj.transpose({1,2,0});
+    rows *= 1.0/sqrt(unbiased ? num_traj-1 : num_traj);
+    tensor<double,4> correlation({num_ts,width+1,num_obs,num_obs},0.0);
+    gsl_matrix * out = gsl_matrix_alloc(num_obs,(width+1)*num_obs);
+    for(size_t t=0; t<num_ts; t++)
+    {
+        // ROW t OF THE BAND IS THE PRODUCT OF THE TIME STEP t WITH THE TIME STEPS t0,...,t
+        size_t t0 = t>width ? t-width : 0;
+        gsl_matrix_const_view lhs = gsl_matrix_const_view_array(&rows(t),num_obs,num_traj);
+        gsl_matrix_const_view rhs = gsl_matrix_const_view_array(&rows(t0),(t-t0+1)*num_obs,num_traj);
+        gsl_matrix_view out_t = gsl_matrix_submatrix(out,0,0,num_obs,(t-t0+1)*num_obs);
+        gsl_blas_dgemm(CblasNoTrans,CblasTrans,1.0,&lhs.matrix,&rhs.matrix,0.0,&out_t.matrix);
+        for(size_t s=t0; s<=t; s++)
+        {
+            for(size_t i=0; i<num_obs; i++)
+            {
+                for(size_t j=0; j<num_obs; j++)
+                {
+                    correlation(t,width+s-t,i,j) = gsl_matrix_get(out,i,(s-t0)*num_obs+j);
+                }
+            }
+        }
+    }
+    gsl_matrix_free(out);
     return correlation;
 }
 
+tensor<double,4> KernelMethods::getCorrelationBand(tensor<double,4> &correlation, size_t width)
+{
+    size_t num_ts = correlation.shape[0];
+    size_t num_obs = correlation.shape[1];
+    tensor<double,4> band({num_ts,width+1,num_obs,num_obs},0.0);
+    for(size_t t=0; t<num_ts; t++)
+    {
+        for(size_t s=(t>width ? t-width : 0); s<=t; s++)
+        {
+            for(size_t i=0; i<num_obs; i++)
+            {
+                for(size_t j=0; j<num_obs; j++)
+                {
+                    band(t,width+s-t,i,j) = correlation(t,i,s,j);
+                }
+            }
+        }
+    }
+    return band;
+}
+
+double KernelMethods::getBandedCorrelation(tensor<double,4> &correlation, size_t t, size_t i, size_t s, size_t j)
+{
+    size_t width = correlation.shape[1]-1;
+    if(s<=t)
+    {
+        return correlation(t,width+s-t,i,j);
+    }
+    return correlation(s,width+t-s,j,i);
+}
+
 tensor<double,3> KernelMethods::getStationaryCorrelation(tensor<double,3> &traj, bool unbiased)
 {
     size_t num_traj = traj.shape[0];
@@ -200,15 +287,17 @@ tensor<double,3> KernelMethods::getStationaryCorrelation(tensor<double,3> &traj,
         }
     }
     delete[] lookup_table;
-    tensor<double,3> corr_out({2*num_ts-1,num_obs,num_obs});
+    tensor<double,3> corr_out;
+    corr_out.alloc_uninitialized({2*num_ts-1,num_obs,num_obs});
+    double norm = 2.0/num_pad; // normalization of the inverse FFT, applied together with the average
     double dummy;
     if(unbiased)
     {
-        dummy = 1.0/(num_traj*num_ts-1);
+        dummy = norm/(num_traj*num_ts-1);
     }
     else
     {
-        dummy = 1.0/(num_traj*num_ts);
+        dummy = norm/(num_traj*num_ts);
     }
     for(size_t k=0;k<num_obs;k++)
     {
@@ -221,11 +310,11 @@ tensor<double,3> KernelMethods::getStationaryCorrelation(tensor<double,3> &traj,
     {
         if(unbiased)
         {
-            dummy = 1.0/(num_traj*(num_ts-tau)-1);
+            dummy = norm/(num_traj*(num_ts-tau)-1);
         }
         else
         {
-            dummy = 1.0/(num_traj*(num_ts-tau));
+            dummy = norm/(num_traj*(num_ts-tau));
         }
         for(size_t k=0;k<num_obs;k++)
         {
@@ -236,7 +325,6 @@ tensor<double,3> KernelMethods::getStationaryCorrelation(tensor<double,3> &traj,
             }
         }
     }
-    corr_out *= 2.0/num_pad;
     /** TEST
     tensor<double, 3> corr_test(corr_out.shape, 0.0);
     for(size_t n=0; n<traj.shape[0]; n++)
@@ -310,11 +398,12 @@ tensor<double,2> KernelMethods::subAverage(tensor<double,3> &traj)
     return average;
 }
 
-tensor<double,4> KernelMethods::calcLowerBlockTriangularInverse(tensor<double,4> &src)
+tensor<double,4> KernelMethods::calcLowerBlockTriangularInverse(tensor<double,4> &src, tensor<double,4> const* leading, size_t num_leading)
 {
     size_t num_ts = src.shape[0];
     size_t num_obs = src.shape[1];
-    tensor<double,3> diag_inverse({num_ts,num_obs,num_obs});
+    tensor<double,3> diag_inverse;
+    diag_inverse.alloc_uninitialized({num_ts,num_obs,num_obs});
     for(size_t t=0;t<num_ts;t++)
     {
         for(size_t i=0;i<num_obs;i++)
@@ -337,12 +426,31 @@ tensor<double,4> KernelMethods::calcLowerBlockTriangularInverse(tensor<double,4>
             }
         }
     }
+    // REUSE THE INVERSE OF THE LEADING PRINCIPAL BLOCK
+    if(leading == nullptr)
+    {
+        num_leading = 0;
+    }
+    size_t const lead_ts = num_leading > 0 ? leading->shape[0] : 0;
+    for(size_t s=0;s<num_leading;s++)
+    {
+        for(size_t t=s+1;t<num_leading;t++)
+        {
+            for(size_t i=0;i<num_obs;i++)
+            {
+                for(size_t j=0;j<num_obs;j++)
+                {
+                    inverse(s,t,i,j) = (*leading)[((t*num_obs+i)*lead_ts+s)*num_obs+j];
+                }
+            }
+        }
+    }
     double dummy;
     gsl_matrix * out = gsl_matrix_alloc(num_obs,num_obs);
     src = src.transpose({0,2,3,1});
     for(size_t s=0;s<num_ts;s++)
     {
-        for(size_t t=s+1;t<num_ts;t++)
+        for(size_t t=max(s+1,num_leading);t<num_ts;t++)
         {
             gsl_matrix_const_view lhs = gsl_matrix_const_view_array(&src(t,s),(t-s)*num_obs,num_obs);
             gsl_matrix_const_view rhs = gsl_matrix_const_view_array(&inverse(s,s),(t-s)*num_obs,num_obs);
@@ -367,24 +475,61 @@ tensor<double,4> KernelMethods::calcLowerBlockTriangularInverse(tensor<double,4>
     return inverse;
 }
 
+tensor<double,4> KernelMethods::calcBandedLowerBlockTriangularInverse(tensor<double,4> &band, size_t width)
+{
+    size_t num_ts = band.shape[0];
+    size_t band_width = band.shape[1]-1;
+    size_t num_obs = band.shape[2];
+    tensor<double,3> diag_inverse;
+    diag_inverse.alloc_uninitialized({num_ts,num_obs,num_obs});
+    for(size_t t=0;t<num_ts;t++)
+    {
+        memcpy(&diag_inverse(t),&band(t,band_width),num_obs*num_obs*sizeof(double));
+    }
+    diag_inverse = matInverse(diag_inverse);
+    tensor<double,4> inverse({num_ts,width+1,num_obs,num_obs},0.0);
+    gsl_matrix * sum = gsl_matrix_alloc(num_obs,num_obs);
+    for(size_t t=0;t<num_ts;t++)
+    {
+        memcpy(&inverse(t,width),&diag_inverse(t),num_obs*num_obs*sizeof(double));
+        gsl_matrix_const_view diag_t = gsl_matrix_const_view_array(&diag_inverse(t),num_obs,num_obs);
+        // inverse(t,s) = -diag_inverse(t) * SUM_u L(t,u)*inverse(u,s), WHERE L(t,u) VANISHES FOR t-u>band_width
+        for(size_t s=(t>width ? t-width : 0); s<t; s++)
+        {
+            gsl_matrix_set_zero(sum);
+            for(size_t u=(t>band_width ? max(s,t-band_width) : s); u<t; u++)
+            {
+                gsl_matrix_const_view lhs = gsl_matrix_const_view_array(&band(t,band_width+u-t),num_obs,num_obs);
+                gsl_matrix_const_view rhs = gsl_matrix_const_view_array(&inverse(u,width+s-u),num_obs,num_obs);
+                gsl_blas_dgemm(CblasNoTrans,CblasNoTrans,1.0,&lhs.matrix,&rhs.matrix,1.0,sum);
+            }
+            gsl_matrix_view out = gsl_matrix_view_array(&inverse(t,width+s-t),num_obs,num_obs);
+            gsl_blas_dgemm(CblasNoTrans,CblasNoTrans,-1.0,&diag_t.matrix,sum,0.0,&out.matrix);
+        }
+    }
+    gsl_matrix_free(sum);
+    return inverse;
+}
+
 void KernelMethods::calcDiagInverts(
 	gsl_matrix const* corr,
 	gsl_matrix **diag_inverts)
 {
 	size_t const num_obs {diag_inverts[0]->size1};
 	size_t const num_ts {corr->size1 / num_obs};
-	gsl_permutation *permutation = gsl_permutation_alloc(num_obs);
-	gsl_matrix *temp = gsl_matrix_alloc(num_obs, num_obs);
-	int signum;
-
+	tensor<double,3> blocks;
+	blocks.alloc_uninitialized({num_ts,num_obs,num_obs});
 	for(size_t i=0; i!=num_ts; ++i){
 		gsl_matrix_const_view view = gsl_matrix_const_submatrix(corr, i*num_obs, i*num_obs, num_obs, num_obs);
-		gsl_matrix_memcpy(temp, &(view.matrix));
-		gsl_linalg_LU_decomp(temp, permutation, &signum);
-		gsl_linalg_LU_invert(temp, permutation, diag_inverts[i]);
+		gsl_matrix_view block = gsl_matrix_view_array(&blocks[i*num_obs*num_obs], num_obs, num_obs);
+		gsl_matrix_memcpy(&block.matrix, &(view.matrix));
+	}
+	// THE DIAGONAL BLOCKS ARE EQUAL-TIME CORRELATION MATRICES
+	blocks = BatchedMatrices::invert(blocks, true);
+	for(size_t i=0; i!=num_ts; ++i){
+		gsl_matrix_const_view block = gsl_matrix_const_view_array(&blocks[i*num_obs*num_obs], num_obs, num_obs);
+		gsl_matrix_memcpy(diag_inverts[i], &block.matrix);
 	}
-	gsl_matrix_free(temp);
-	gsl_permutation_free(permutation);
 	return;
 };
 
@@ -635,9 +780,35 @@ void KernelMethods::calcJ(
 	gsl_matrix* J,
 	int const num_ts,
 	int const num_obs,
-	double const dt)
+	double const dt,
+	tensor<double,5> *factors)
 {
 	int i;
+	size_t const num_tot = num_ts*num_obs;
+	// NUMBER OF LEADING TIME STEPS, WHOSE FACTORS ARE REUSED
+	// THE LAST OLD TIME STEP IS RECOMPUTED, SINCE ITS DERIVATIVE WAS ONE-SIDED
+	size_t num_leading = 0;
+	tensor<double,4> leading[3];
+	if(factors != nullptr)
+	{
+		size_t const old_ts = factors->shape[1];
+		if(factors->shape[0] == 3 && old_ts > 1 && old_ts <= size_t(num_ts)
+			&& factors->shape[2] == size_t(num_obs) && factors->shape[3] == old_ts && factors->shape[4] == size_t(num_obs))
+		{
+			num_leading = old_ts-1;
+			gsl_matrix_view old_mat = GslAdapter::matrix(*factors, 3*old_ts*num_obs, old_ts*num_obs);
+			for(size_t n=0; n<3; n++)
+			{
+				leading[n].alloc_uninitialized({num_leading,size_t(num_obs),num_leading,size_t(num_obs)});
+				gsl_matrix_view lead_mat = GslAdapter::matrix(leading[n]);
+				gsl_matrix_const_view view = gsl_matrix_const_submatrix(&old_mat.matrix, n*old_ts*num_obs, 0, num_leading*num_obs, num_leading*num_obs);
+				gsl_matrix_memcpy(&lead_mat.matrix, &view.matrix);
+			}
+		}
+		factors->alloc_uninitialized({3,size_t(num_ts),size_t(num_obs),size_t(num_ts),size_t(num_obs)});
+	}
+	size_t const num_lead_tot = num_leading*num_obs;
+
 	gsl_matrix_scale(S0, dt);
 	KernelMethods::splitIntoTriangular(S0, num_ts, num_obs, temp1, temp2, true);
 	// Add one to diagonal elements
@@ -646,14 +817,30 @@ void KernelMethods::calcJ(
 		gsl_matrix_set(temp2, i, i, gsl_matrix_get(temp2, i, i) + 1.0);
 	}
 
-	if(num_obs>1)
-    {
-        tensor<double,4> buffer({size_t(num_ts),size_t(num_obs),size_t(num_ts),size_t(num_obs)});
-        buffer << *temp1->data;
-        calcLowerBlockTriangularInverse(buffer) >> *J->data;   // J is now S_lower!!!
-        buffer << *temp2->data;
-        buffer = buffer.transpose({2,3,0,1});
-        calcLowerBlockTriangularInverse(buffer).transpose({2,3,0,1}) >> *temp1->data;   // temp1 is now S_upper!!!
+	if(factors != nullptr)
+    {
+        vector<size_t> shape = {size_t(num_ts),size_t(num_obs),size_t(num_ts),size_t(num_obs)};
+        gsl_matrix_view new_mat = GslAdapter::matrix(*factors, 3*num_tot, num_tot);
+        gsl_matrix_view fac_lower = gsl_matrix_submatrix(&new_mat.matrix, 0, 0, num_tot, num_tot);
+        gsl_matrix_view fac_upper = gsl_matrix_submatrix(&new_mat.matrix, num_tot, 0, num_tot, num_tot);
+        tensor<double,4> buffer;
+        buffer = GslAdapter::tensor(temp1,shape).copy();
+        GslAdapter::tensor(J,shape).copy_from(calcLowerBlockTriangularInverse(buffer,&leading[0],num_leading).data());   // J is now S_lower!!!
+        gsl_matrix_memcpy(&fac_lower.matrix, J);
+        GslAdapter::tensor(temp2,shape).transpose({2,3,0,1}).copy_to(buffer.data());
+        buffer = calcLowerBlockTriangularInverse(buffer,&leading[1],num_leading);
+        gsl_matrix_const_view upper_t = GslAdapter::const_matrix(buffer, num_tot, num_tot);
+        gsl_matrix_memcpy(&fac_upper.matrix, &upper_t.matrix);
+        gsl_matrix_transpose_memcpy(temp1, &upper_t.matrix);   // temp1 is now S_upper!!!
+    }
+	else if(num_obs>1)
+    {
+        vector<size_t> shape = {size_t(num_ts),size_t(num_obs),size_t(num_ts),size_t(num_obs)};
+        tensor<double,4> buffer;
+        buffer = GslAdapter::tensor(temp1,shape).copy();
+        GslAdapter::tensor(J,shape).copy_from(calcLowerBlockTriangularInverse(buffer).data());   // J is now S_lower!!!
+        GslAdapter::tensor(temp2,shape).transpose({2,3,0,1}).copy_to(buffer.data());
+        GslAdapter::tensor(temp1,shape).transpose({2,3,0,1}).copy_from(calcLowerBlockTriangularInverse(buffer).data());   // temp1 is now S_upper!!!
     }
     else
     {
@@ -665,6 +852,38 @@ void KernelMethods::calcJ(
 
 	KernelMethods::splitIntoTriangular(j, num_ts, num_obs, S0, temp2, false);  // S0 is now j_lower, temp2 is now j_upper!!!
 
+	if(num_leading > 0)
+	{
+		// J(t,s) FOR t,s<num_leading IS REUSED. THE NEW ROWS ARE J_lower+J_upper.
+		// THE NEW COLUMNS OF THE OLD ROWS ARE J_upper ONLY, SINCE j_lower(t,r) IS ZERO FOR r>t AND S_lower^-1(r,s) IS ZERO FOR r<s.
+		size_t const num_new = num_tot-num_lead_tot;
+		gsl_matrix_view j_lower = gsl_matrix_submatrix(S0, num_lead_tot, 0, num_new, num_tot);
+		gsl_matrix_view j_upper = gsl_matrix_submatrix(temp2, num_lead_tot, 0, num_new, num_tot);
+		gsl_matrix_view J_rows = gsl_matrix_submatrix(j, num_lead_tot, 0, num_new, num_tot);
+		gsl_blas_dgemm(
+			CblasNoTrans, CblasNoTrans, 1.0,
+			&j_lower.matrix, J, 0.0, &J_rows.matrix);  // j is now J_lower in the new rows!!!
+		J_rows = gsl_matrix_submatrix(J, num_lead_tot, 0, num_new, num_tot);
+		gsl_blas_dgemm(
+			CblasNoTrans, CblasNoTrans, 1.0,
+			&j_upper.matrix, temp1, 0.0, &J_rows.matrix);
+		gsl_matrix_view j_rows = gsl_matrix_submatrix(j, num_lead_tot, 0, num_new, num_tot);
+		gsl_matrix_add(&J_rows.matrix, &j_rows.matrix);
+		j_upper = gsl_matrix_submatrix(temp2, 0, 0, num_lead_tot, num_tot);
+		gsl_matrix_view upper_cols = gsl_matrix_submatrix(temp1, 0, num_lead_tot, num_tot, num_new);
+		gsl_matrix_view J_cols = gsl_matrix_submatrix(J, 0, num_lead_tot, num_lead_tot, num_new);
+		gsl_blas_dgemm(
+			CblasNoTrans, CblasNoTrans, 1.0,
+			&j_upper.matrix, &upper_cols.matrix, 0.0, &J_cols.matrix);
+		gsl_matrix_view J_lead = gsl_matrix_submatrix(J, 0, 0, num_lead_tot, num_lead_tot);
+		gsl_matrix_view old_J = GslAdapter::matrix(leading[2]);
+		gsl_matrix_memcpy(&J_lead.matrix, &old_J.matrix);  // J is now J!!!
+		gsl_matrix_view fac_mat = GslAdapter::matrix(*factors, 3*num_tot, num_tot);
+		gsl_matrix_view fac_J = gsl_matrix_submatrix(&fac_mat.matrix, 2*num_tot, 0, num_tot, num_tot);
+		gsl_matrix_memcpy(&fac_J.matrix, J);
+		return;
+	}
+
 	gsl_blas_dgemm(
 		CblasNoTrans, CblasNoTrans, 1.0,
 		S0, J, 0.0, j);  // j is now J_lower!!!
@@ -674,15 +893,100 @@ void KernelMethods::calcJ(
 
 	gsl_matrix_add(J, j);  // J is now J!!!
 
+	if(factors != nullptr)
+	{
+		gsl_matrix_view fac_mat = GslAdapter::matrix(*factors, 3*num_tot, num_tot);
+		gsl_matrix_view fac_J = gsl_matrix_submatrix(&fac_mat.matrix, 2*num_tot, 0, num_tot, num_tot);
+		gsl_matrix_memcpy(&fac_J.matrix, J);
+	}
 };
 
 
+tensor<double,4> KernelMethods::calcBandedJ(
+    tensor<double,4> &S0,
+    tensor<double,4> &j,
+    double dt)
+{
+    // S0 AND j HOLD THE COMPONENTS (t,s) WITH t-width<=s<=t+1 AT (t,width+s-t)
+    size_t num_ts = S0.shape[0];
+    size_t width = S0.shape[1]-2;
+    size_t num_obs = S0.shape[2];
+
+    // LOWER FACTOR 1-dt*S0_lower AND TRANSPOSED UPPER FACTOR (1+dt*S0_upper)^T, THE DIAGONAL OF S0 IS SPLIT IN HALVES
+    tensor<double,4> lower({num_ts,width+1,num_obs,num_obs},0.0);
+    tensor<double,4> upper_t({num_ts,2,num_obs,num_obs},0.0);
+    for(size_t t=0; t<num_ts; t++)
+    {
+        for(size_t i=0; i<num_obs; i++)
+        {
+            for(size_t k=0; k<num_obs; k++)
+            {
+                for(size_t d=0; d<width; d++)
+                {
+                    lower(t,d,i,k) = -dt*S0(t,d,i,k);
+                }
+                lower(t,width,i,k) = (i==k ? 1.0 : 0.0)-0.5*dt*S0(t,width,i,k);
+                upper_t(t,1,i,k) = (i==k ? 1.0 : 0.0)+0.5*dt*S0(t,width,k,i);
+                if(t>0)
+                {
+                    upper_t(t,0,i,k) = dt*S0(t-1,width+1,k,i);
+                }
+            }
+        }
+    }
+    // THE UPPER INVERSE IS ONLY NEEDED ON AND NEXT TO THE DIAGONAL, SINCE j_upper(t,r) IS MULTIPLIED WITH r=t,t+1 ONLY
+    tensor<double,4> lower_inverse = calcBandedLowerBlockTriangularInverse(lower,width);
+    tensor<double,4> upper_t_inverse = calcBandedLowerBlockTriangularInverse(upper_t,1);
+    lower.clear();
+    upper_t.clear();
+
+    // J = j_lower*S_lower^-1 + j_upper*S_upper^-1, THE DIAGONAL OF j IS SPLIT IN HALVES
+    tensor<double,4> J({num_ts,width+2,num_obs,num_obs},0.0);
+    gsl_matrix * j_diag = gsl_matrix_alloc(num_obs,num_obs);
+    for(size_t t=0; t<num_ts; t++)
+    {
+        gsl_matrix_const_view j_tt = gsl_matrix_const_view_array(&j(t,width),num_obs,num_obs);
+        gsl_matrix_memcpy(j_diag,&j_tt.matrix);
+        gsl_matrix_scale(j_diag,0.5);
+        for(size_t s=(t>width ? t-width : 0); s<=t+1 && s<num_ts; s++)
+        {
+            gsl_matrix_view out = gsl_matrix_view_array(&J(t,width+s-t),num_obs,num_obs);
+            if(s<=t)
+            {
+                for(size_t r=s; r<=t; r++)
+                {
+                    gsl_matrix_const_view j_tr = gsl_matrix_const_view_array(&j(t,width+r-t),num_obs,num_obs);
+                    gsl_matrix_const_view inverse_rs = gsl_matrix_const_view_array(&lower_inverse(r,width+s-r),num_obs,num_obs);
+                    gsl_blas_dgemm(CblasNoTrans,CblasNoTrans,1.0,r<t ? &j_tr.matrix : j_diag,&inverse_rs.matrix,1.0,&out.matrix);
+                }
+            }
+            if(s==t)
+            {
+                gsl_matrix_const_view inverse_tt = gsl_matrix_const_view_array(&upper_t_inverse(t,1),num_obs,num_obs);
+                gsl_blas_dgemm(CblasNoTrans,CblasTrans,1.0,j_diag,&inverse_tt.matrix,1.0,&out.matrix);
+            }
+            else if(s==t+1)
+            {
+                gsl_matrix_const_view j_ts = gsl_matrix_const_view_array(&j(t,width+1),num_obs,num_obs);
+                gsl_matrix_const_view inverse_ts = gsl_matrix_const_view_array(&upper_t_inverse(s,0),num_obs,num_obs);
+                gsl_matrix_const_view inverse_ss = gsl_matrix_const_view_array(&upper_t_inverse(s,1),num_obs,num_obs);
+                gsl_blas_dgemm(CblasNoTrans,CblasTrans,1.0,j_diag,&inverse_ts.matrix,1.0,&out.matrix);
+                gsl_blas_dgemm(CblasNoTrans,CblasTrans,1.0,&j_ts.matrix,&inverse_ss.matrix,1.0,&out.matrix);
+            }
+        }
+    }
+    gsl_matrix_free(j_diag);
+    return J;
+}
+
+
 void KernelMethods::getMemoryKernel(
     gsl_matrix* K,
     gsl_matrix* corr,
     size_t const num_ts,
     size_t const num_obs,
-    double const dt)
+    double const dt,
+    tensor<double,5> *factors)
 {
     size_t num_tot = num_ts * num_obs;
     gsl_matrix* S0 = gsl_matrix_alloc(num_tot, num_tot);
@@ -697,7 +1001,7 @@ void KernelMethods::getMemoryKernel(
     KernelMethods::calcS0(corr, K, diag_inverts, dt, S0);
     KernelMethods::calcj(corr, K, diag_inverts, dt, j);
     // K and corr are used as auxilliary matrices and anything but J is destroyed
-    KernelMethods::calcJ(S0, j, K, corr, J, num_ts, num_obs, dt);
+    KernelMethods::calcJ(S0, j, K, corr, J, num_ts, num_obs, dt, factors);
     KernelMethods::calcDerivative(J, num_ts, num_obs, K, dt, true);
 
     gsl_matrix_free(S0);
@@ -709,47 +1013,72 @@ void KernelMethods::getMemoryKernel(
     delete[] diag_inverts;
 }
 
-tensor<double,3> KernelMethods::getMemoryKernel(tensor<double,3> &correlation, double dt)
+uint64_t KernelMethods::getCorrelationChecksum(tensor<double,4> &correlation, size_t num_leading)
 {
-    size_t shape0 = correlation.shape[0];
-    size_t num_ts = (shape0+1)/2;
     size_t num_obs = correlation.shape[1];
-
-    tensor<double,2> inverse({num_obs,num_obs});
-    gsl_matrix *lu = gsl_matrix_alloc(num_obs, num_obs);
-    gsl_permutation *permutation = gsl_permutation_alloc(num_obs);
-    int signum;
-    gsl_matrix *inv = gsl_matrix_alloc(num_obs, num_obs);
-    for(size_t i=0; i<num_obs; i++)
-    {
-        for(size_t j=0; j<num_obs; j++)
-        {
-            gsl_matrix_set(lu,i,j,correlation(num_ts-1,i,j));
-        }
-    }
-    gsl_linalg_LU_decomp(lu, permutation, &signum);
-    gsl_linalg_LU_invert(lu, permutation, inv);
-    inverse << *inv->data;
-    gsl_permutation_free(permutation);
-    gsl_matrix_free(lu);
-    gsl_matrix_free(inv);
-
-    tensor<double,3> diff;
-    diff=diffFront(correlation,dt);
-    tensor<double, 3> j0({shape0,num_obs,num_obs},0.0);
-    for(size_t t=0; t<shape0;t++)
+    uint64_t hash = 14695981039346656037ull;
+    for(size_t t=0; t<num_leading; t++)
     {
         for(size_t i=0; i<num_obs; i++)
         {
-            for(size_t j=0; j<num_obs; j++)
+            const unsigned char *bytes = (const unsigned char*)&correlation(t,i);
+            for(size_t b=0; b<num_leading*num_obs*sizeof(double); b++)
             {
-                for(size_t k=0; k<num_obs; k++)
-                {
-                    j0(t,i,j) += diff(t,i,k)*inverse(k,j);
-                }
+                hash = (hash^bytes[b])*1099511628211ull;
             }
         }
     }
+    return hash;
+}
+
+void KernelMethods::readKernelFactors(
+    tensor<double,5> &factors,
+    tensor<double,4> &correlation,
+    double dt,
+    filesystem::path out_path)
+{
+    factors.read(out_path/"kernel_factors.f64");
+    size_t old_ts = factors.shape[1];
+    ifstream in(out_path/"kernel_factors.txt");
+    double old_dt;
+    uint64_t checksum;
+    if(!(in >> old_dt >> checksum))
+    {
+        factors.clear();
+        throw ErrorHandler::CorruptFile("KernelMethods::readKernelFactors: Unable to read: "+(out_path/"kernel_factors.txt").string());
+    }
+    if(old_dt != dt || old_ts < 2 || old_ts > correlation.shape[0] || factors.shape[2] != correlation.shape[1]
+       || checksum != getCorrelationChecksum(correlation,old_ts))
+    {
+        factors.clear();
+        throw ErrorHandler::CorruptFile("KernelMethods::readKernelFactors: Kernel factors stem from a different time step or correlation function!");
+    }
+}
+
+void KernelMethods::writeKernelFactors(
+    tensor<double,5> &factors,
+    uint64_t checksum,
+    double dt,
+    filesystem::path out_path)
+{
+    factors.write("kernel_factors.f64",out_path);
+    ofstream out(out_path/"kernel_factors.txt");
+    out << setprecision(17) << dt << endl;
+    out << checksum << endl;
+    out.close();
+}
+
+tensor<double,3> KernelMethods::getMemoryKernel(tensor<double,3> &correlation, double dt)
+{
+    size_t shape0 = correlation.shape[0];
+    size_t num_ts = (shape0+1)/2;
+    size_t num_obs = correlation.shape[1];
+
+    tensor<double,3> diff;
+    diff=diffFront(correlation,dt);
+    tensor<double,3> corr_0({1,num_obs,num_obs});
+    corr_0 << correlation(num_ts-1);
+    tensor<double, 3> j0 = BatchedMatrices::solveRight(diff,corr_0,true);  // j0(t) = diff(t)*C(0)^-1
     diff.clear();
 
     tensor<double,3> S_lower({num_ts,num_obs,num_obs});
@@ -772,37 +1101,14 @@ tensor<double,3> KernelMethods::getMemoryKernel(tensor<double,3> &correlation, d
         S_upper(num_ts-1,i,i) += 1.0; // add identity
     } // S = 1-\pm*dt*S_0
 
-    lu = gsl_matrix_alloc(num_obs, num_obs);
-    permutation = gsl_permutation_alloc(num_obs);
-    inv = gsl_matrix_alloc(num_obs, num_obs);
-
+    tensor<double,3> S_diag({2,num_obs,num_obs});
+    copy(&S_lower(0),&S_lower(0)+num_obs*num_obs,&S_diag(0));
+    copy(&S_upper(num_ts-1),&S_upper(num_ts-1)+num_obs*num_obs,&S_diag(1));
+    S_diag = BatchedMatrices::invert(S_diag);
     tensor<double,2> inverse_lower({num_obs,num_obs});
-    for(size_t i=0; i<num_obs; i++)
-    {
-        for(size_t j=0; j<num_obs; j++)
-        {
-            gsl_matrix_set(lu,i,j,S_lower(0,i,j));
-        }
-    }
-    gsl_linalg_LU_decomp(lu, permutation, &signum);
-    gsl_linalg_LU_invert(lu, permutation, inv);
-    inverse_lower << *inv->data;
-
     tensor<double,2> inverse_upper({num_obs,num_obs});
-    for(size_t i=0; i<num_obs; i++)
-    {
-        for(size_t j=0; j<num_obs; j++)
-        {
-            gsl_matrix_set(lu,i,j,S_upper(num_ts-1,i,j));
-        }
-    }
-    gsl_linalg_LU_decomp(lu, permutation, &signum);
-    gsl_linalg_LU_invert(lu, permutation, inv);
-    inverse_upper << *inv->data;
-
-    gsl_permutation_free(permutation);
-    gsl_matrix_free(lu);
-    gsl_matrix_free(inv);
+    inverse_lower << S_diag(0);
+    inverse_upper << S_diag(1);
 
     tensor<double, 3> J({shape0,num_obs,num_obs},0.0);
     tensor<double,2> buffer({num_obs,num_obs});
@@ -872,6 +1178,124 @@ tensor<double,3> KernelMethods::getMemoryKernel(tensor<double,3> &correlation, d
     return K;
 }
 
+void KernelMethods::applyMemoryHorizon(tensor<double,4> &kernel, size_t memory_horizon)
+{
+    if(memory_horizon==0)
+    {
+        return;
+    }
+    size_t num_ts = kernel.shape[0];
+    size_t num_obs = kernel.shape[1];
+    for(size_t t=memory_horizon+1; t<num_ts; t++)
+    {
+        for(size_t i=0; i<num_obs; i++)
+        {
+            memset(&kernel(t,i),0,(t-memory_horizon)*num_obs*sizeof(double)); // s < t-memory_horizon
+        }
+    }
+}
+
+void KernelMethods::applyMemoryHorizon(tensor<double,3> &kernel, size_t memory_horizon)
+{
+    if(memory_horizon==0)
+    {
+        return;
+    }
+    size_t t_not = (kernel.shape[0]+1)/2-1;
+    size_t num_obs = kernel.shape[1];
+    for(size_t tau=memory_horizon+1; tau<=t_not; tau++)
+    {
+        memset(&kernel(t_not+tau),0,num_obs*num_obs*sizeof(double));
+        memset(&kernel(t_not-tau),0,num_obs*num_obs*sizeof(double));
+    }
+}
+
+tensor<double,4> KernelMethods::getBandedMemoryKernel(tensor<double,4> &correlation, double dt, size_t memory_horizon)
+{
+    size_t num_ts = correlation.shape[0];
+    size_t num_obs = correlation.shape[2];
+    if(memory_horizon == 0 || correlation.shape[1] < memory_horizon+3 || num_ts < 2)
+    {
+        throw ErrorHandler::ShapeMismatch("KernelMethods::getBandedMemoryKernel: The band of the correlation function must have a width of at least memory_horizon+2!");
+    }
+    if(memory_horizon+1 >= num_ts)
+    {
+        throw ErrorHandler::ShapeMismatch("KernelMethods::getBandedMemoryKernel: The memory horizon must be smaller than num_ts-1, use getMemoryKernel instead!");
+    }
+    // J(t+-1,s) IS REQUIRED FOR t-memory_horizon<=s<=t AND THE DERIVATIVES OF S0 AND j REQUIRE ONE MORE LAG OF THE CORRELATION FUNCTION
+    size_t width = memory_horizon+1;
+
+    tensor<double,3> diag_inverse;
+    diag_inverse.alloc_uninitialized({num_ts,num_obs,num_obs});
+    for(size_t t=0; t<num_ts; t++)
+    {
+        for(size_t i=0; i<num_obs; i++)
+        {
+            for(size_t k=0; k<num_obs; k++)
+            {
+                diag_inverse(t,i,k) = getBandedCorrelation(correlation,t,i,t,k);
+            }
+        }
+    }
+    // THE DIAGONAL BLOCKS ARE EQUAL-TIME CORRELATION MATRICES
+    diag_inverse = matInverse(diag_inverse,true);
+
+    // S0(t,s) = d/ds C(t,s) * C(s,s)^-1 AND j(t,s) = d/ds [C(s,s)-C(t,s)] * C(s,s)^-1 FOR t-width<=s<=t+1
+    tensor<double,4> S0({num_ts,width+2,num_obs,num_obs},0.0);
+    tensor<double,4> j({num_ts,width+2,num_obs,num_obs},0.0);
+    tensor<double,2> diff_S0({num_obs,num_obs});
+    tensor<double,2> diff_j({num_obs,num_obs});
+    gsl_matrix_view diff_S0_mat = GslAdapter::matrix(diff_S0);
+    gsl_matrix_view diff_j_mat = GslAdapter::matrix(diff_j);
+    for(size_t t=0; t<num_ts; t++)
+    {
+        for(size_t s=(t>width ? t-width : 0); s<=t+1 && s<num_ts; s++)
+        {
+            // ONE-SIDED DIFFERENCE QUOTIENT FOR THE FIRST AND LAST TIME STEP
+            size_t s_lo = s>0 ? s-1 : s;
+            size_t s_hi = s+1<num_ts ? s+1 : s;
+            double inv_dt = 1.0/((s_hi-s_lo)*dt);
+            for(size_t i=0; i<num_obs; i++)
+            {
+                for(size_t k=0; k<num_obs; k++)
+                {
+                    diff_S0(i,k) = (getBandedCorrelation(correlation,t,i,s_hi,k)-getBandedCorrelation(correlation,t,i,s_lo,k))*inv_dt;
+                    diff_j(i,k) = (getBandedCorrelation(correlation,s_hi,i,s_hi,k)-getBandedCorrelation(correlation,s_lo,i,s_lo,k))*inv_dt-diff_S0(i,k);
+                }
+            }
+            gsl_matrix_const_view diag_s = gsl_matrix_const_view_array(&diag_inverse(s),num_obs,num_obs);
+            gsl_matrix_view S0_ts = gsl_matrix_view_array(&S0(t,width+s-t),num_obs,num_obs);
+            gsl_matrix_view j_ts = gsl_matrix_view_array(&j(t,width+s-t),num_obs,num_obs);
+            gsl_blas_dgemm(CblasNoTrans,CblasNoTrans,1.0,&diff_S0_mat.matrix,&diag_s.matrix,0.0,&S0_ts.matrix);
+            gsl_blas_dgemm(CblasNoTrans,CblasNoTrans,1.0,&diff_j_mat.matrix,&diag_s.matrix,0.0,&j_ts.matrix);
+        }
+    }
+    diag_inverse.clear();
+    tensor<double,4> J = calcBandedJ(S0,j,dt);
+    S0.clear();
+    j.clear();
+
+    // K(t,s) = d/dt J(t,s) FOR t-memory_horizon<=s<=t
+    tensor<double,4> kernel({num_ts,memory_horizon+1,num_obs,num_obs},0.0);
+    for(size_t t=0; t<num_ts; t++)
+    {
+        size_t t_lo = t>0 ? t-1 : t;
+        size_t t_hi = t+1<num_ts ? t+1 : t;
+        double inv_dt = 1.0/((t_hi-t_lo)*dt);
+        for(size_t s=(t>memory_horizon ? t-memory_horizon : 0); s<=t; s++)
+        {
+            for(size_t i=0; i<num_obs; i++)
+            {
+                for(size_t k=0; k<num_obs; k++)
+                {
+                    kernel(t,memory_horizon+s-t,i,k) = (J(t_hi,width+s-t_hi,i,k)-J(t_lo,width+s-t_lo,i,k))*inv_dt;
+                }
+            }
+        }
+    }
+    return kernel;
+}
+
 tensor<double,3> KernelMethods::diffTrajectories(tensor<double,3> &trajectories, double dt, bool darboux_sum)
 {
     size_t num_traj = trajectories.shape[0];
@@ -927,7 +1351,8 @@ tensor<double,3> KernelMethods::diffFront(tensor<double,3> &corr_diag, double dt
 {
     size_t num_ts = corr_diag.shape[0];
     size_t num_obs   = corr_diag.shape[1];
-    tensor<double,3> diff(corr_diag.shape);
+    tensor<double,3> diff;
+    diff.alloc_uninitialized(corr_diag.shape);
     double dummy = 0.5/dt;
     for(size_t k=0; k<num_obs; k++)
     {
@@ -956,44 +1381,9 @@ tensor<double,3> KernelMethods::diffFront(tensor<double,3> &corr_diag, double dt
     return diff;
 };
 
-tensor<double,3> KernelMethods::matInverse(tensor<double,3> &mat)
+tensor<double,3> KernelMethods::matInverse(tensor<double,3> &mat, bool symmetric)
 {
-    size_t num_obs = mat.shape[1];
-    tensor<double,3> result(mat.shape);
-
-    gsl_matrix *lu = gsl_matrix_alloc(num_obs, num_obs);
-    gsl_permutation *permutation = gsl_permutation_alloc(num_obs);
-    int signum;
-    gsl_matrix *inv = gsl_matrix_alloc(num_obs, num_obs);
-    for(size_t n=0; n<result.shape[0]; n++)
-    {
-        // get LU decomposition
-        for(size_t i=0; i<num_obs; i++)
-        {
-            for(size_t j=0; j<num_obs; j++)
-            {
-                gsl_matrix_set(lu,i,j,mat(n,i,j));
-            }
-        }
-        gsl_linalg_LU_decomp(lu, permutation, &signum);
-
-        // get inverse
-        gsl_linalg_LU_invert(lu, permutation, inv);
-
-        for(size_t i=0; i<num_obs; i++)
-        {
-            for(size_t j=0; j<num_obs; j++)
-            {
-                result(n,i,j) = gsl_matrix_get(inv,i,j);
-            }
-        }
-    }
-
-    gsl_permutation_free(permutation);
-    gsl_matrix_free(lu);
-    gsl_matrix_free(inv);
-
-    return result;
+    return BatchedMatrices::invert(mat,symmetric);
 }
 
 tensor<double,2> KernelMethods::getDrift(tensor<double,3> &correlation, double dt)
@@ -1011,46 +1401,24 @@ tensor<double,2> KernelMethods::getDrift(tensor<double,3> &correlation, double d
         }
     }
 
-    // invert
-    tensor<double,2> inverse({num_obs,num_obs});
-    gsl_matrix *lu = gsl_matrix_alloc(num_obs, num_obs);
-    gsl_permutation *permutation = gsl_permutation_alloc(num_obs);
-    int signum;
-    gsl_matrix *inv = gsl_matrix_alloc(num_obs, num_obs);
-    for(size_t i=0; i<num_obs; i++)
-    {
-        for(size_t j=0; j<num_obs; j++)
-        {
-            gsl_matrix_set(lu,i,j,correlation(num_ts-1,i,j));
-        }
-    }
-    gsl_linalg_LU_decomp(lu, permutation, &signum);
-    gsl_linalg_LU_invert(lu, permutation, inv);
-    inverse << *inv->data;
-    gsl_permutation_free(permutation);
-    gsl_matrix_free(lu);
-    gsl_matrix_free(inv);
-
-    tensor<double,2> drift({num_obs,num_obs},0.0);
-    for(size_t i=0; i<num_obs; i++)
-    {
-        for(size_t j=0; j<num_obs; j++)
-        {
-            for(size_t k=0; k< num_obs; k++)
-            {
-                drift(i,j) += diff(i,k)*inverse(k,j);
-            }
-        }
-    }
-    return drift;
-}
+    // solve drift*C(0) = diff
+    tensor<double,3> rhs({1,num_obs,num_obs});
+    rhs << diff(0);
+    tensor<double,3> corr_0({1,num_obs,num_obs});
+    corr_0 << correlation(num_ts-1);
+    rhs = BatchedMatrices::solveRight(rhs,corr_0,true);
+    tensor<double,2> drift({num_obs,num_obs});
+    drift << rhs(0);
+    return drift;
+}
 
 tensor<double,3> KernelMethods::getDrift(tensor<double,4> &correlation, double dt)
 {
     size_t num_ts = correlation.shape[0];
     size_t num_obs = correlation.shape[1];
 
-    tensor<double,3> diff_diag({num_ts,num_obs,num_obs});
+    tensor<double,3> diff_diag;
+    diff_diag.alloc_uninitialized({num_ts,num_obs,num_obs});
     for(size_t k=0;k<num_obs;k++)
     {
         for(size_t l=0;l<num_obs;l++)
@@ -1076,37 +1444,47 @@ tensor<double,3> KernelMethods::getDrift(tensor<double,4> &correlation, double d
         }
     }
 
-    tensor<double,3> diag_inverse({num_ts,num_obs,num_obs});
+    tensor<double,3> diag;
+    diag.alloc_uninitialized({num_ts,num_obs,num_obs});
     for(size_t t=0;t<num_ts;t++)
     {
         for(size_t k=0;k<num_obs;k++)
         {
             for(size_t l=0;l<num_obs;l++)
             {
-                diag_inverse(t,k,l)=correlation(t,k,t,l);
+                diag(t,k,l)=correlation(t,k,t,l);
             }
         }
     }
-    diag_inverse=matInverse(diag_inverse);
+    // solve drift(t)*C(t,t) = diff_diag(t)
+    return BatchedMatrices::solveRight(diff_diag,diag,true);
+}
 
-    tensor<double,3> drift(diff_diag.shape);
-    double dummy;
-    for(size_t t=0; t<num_ts; t++)
+tensor<double,3> KernelMethods::getBandedDrift(tensor<double,4> &correlation, double dt)
+{
+    size_t num_ts = correlation.shape[0];
+    size_t num_obs = correlation.shape[2];
+
+    tensor<double,3> diff_diag;
+    diff_diag.alloc_uninitialized({num_ts,num_obs,num_obs});
+    tensor<double,3> diag;
+    diag.alloc_uninitialized({num_ts,num_obs,num_obs});
+    for(size_t t=0;t<num_ts;t++)
     {
-        for(size_t i=0; i<num_obs; i++)
+        // ONE-SIDED DIFFERENCE QUOTIENT FOR THE FIRST AND LAST TIME STEP
+        size_t t_lo = t>0 ? t-1 : t;
+        size_t t_hi = t+1<num_ts ? t+1 : t;
+        for(size_t k=0;k<num_obs;k++)
         {
-            for(size_t j=0; j<num_obs; j++)
+            for(size_t l=0;l<num_obs;l++)
             {
-                dummy = 0.0;
-                for(size_t k=0; k< num_obs; k++)
-                {
-                    dummy += diff_diag(t,i,k)*diag_inverse(t,k,j);
-                }
-                drift(t,i,j) = dummy;
+                diff_diag(t,k,l)=(getBandedCorrelation(correlation,t_hi,k,t,l)-getBandedCorrelation(correlation,t_lo,k,t,l))/((t_hi-t_lo)*dt);
+                diag(t,k,l)=getBandedCorrelation(correlation,t,k,t,l);
             }
         }
     }
-    return drift;
+    // solve drift(t)*C(t,t) = diff_diag(t)
+    return BatchedMatrices::solveRight(diff_diag,diag,true);
 }
 
 tensor<double,3> KernelMethods::getFluctuatingForce(
@@ -1114,7 +1492,11 @@ tensor<double,3> KernelMethods::getFluctuatingForce(
     tensor<double,3> &drift,
     tensor<double,3> &trajectories,
     tensor<double,1> &times,
-    bool darboux_sum)
+    bool darboux_sum,
+    size_t memory_horizon,
+    HierarchicalKernel *hkernel,
+    size_t num_threads,
+    bool banded)
 {
     double dt = times[1]-times[0];
 
@@ -1146,67 +1528,87 @@ tensor<double,3> KernelMethods::getFluctuatingForce(
 
     // subtract memory part
     tensor<double,3> buffer;
-    if(darboux_sum)
+    trajectories=trajectories.transpose({1,2,0});
+    buffer.alloc({num_ts,num_obs,num_traj},0.0);
+    if(darboux_sum && hkernel != nullptr)
     {
-        trajectories=trajectories.transpose({1,2,0});
-        kernel=kernel.transpose({0,1,3,2});
-        buffer.alloc({num_ts,num_obs,num_traj},0.0);
-        gsl_matrix * out = gsl_matrix_alloc(num_obs,num_traj);
-        for(size_t t=1;t<num_ts;t++)
-        {
-            gsl_matrix_const_view kernel_t = gsl_matrix_const_view_array(&kernel(t),t*num_obs,num_obs);
-            gsl_matrix_const_view traj = gsl_matrix_const_view_array(&trajectories[0],t*num_obs,num_traj);
-            gsl_blas_dgemm(CblasTrans,CblasNoTrans,1.0,&kernel_t.matrix,&traj.matrix,0.0,out);
-            memcpy(&buffer(t),out->data,num_obs*num_traj*sizeof(double));
-        }
-        gsl_matrix_free(out);
-        buffer=buffer.transpose({2,0,1});
-        buffer *=dt;
-        trajectories = trajectories.transpose({2,0,1});
-        diff_traj -= buffer; // = dA/dt-drift*A-SUM_t2 K(.,t2)*A(t2)
+        gsl_matrix_const_view traj = GslAdapter::const_matrix(trajectories,num_ts*num_obs,num_traj);
+        gsl_matrix_view out = GslAdapter::matrix(buffer,num_ts*num_obs,num_traj);
+        hkernel->multiply(&traj.matrix,&out.matrix);
     }
     else
     {
-        buffer.alloc({num_traj,num_ts,num_obs});
-        const size_t k_incr_0 = kernel.incr[0];
-        const size_t k_incr_1 = kernel.incr[1];
-        const size_t k_incr_2 = kernel.incr[2];
-        const size_t traj_incr_0 = trajectories.incr[0];
-        const size_t traj_incr_1 = trajectories.incr[1];
-
-        for(size_t n=0; n<num_traj; n++)
+        if(hkernel != nullptr)
         {
-            for(size_t t1=0; t1<num_ts; t1++)
+            kernel = hkernel->dense();
+        }
+        kernel=kernel.transpose({0,1,3,2});
+        // A BANDED KERNEL HOLDS K(t,s) AT (t,memory_horizon+s-t)
+        if(banded)
+        {
+            memory_horizon = kernel.shape[1]-1;
+        }
+        auto column = [&](size_t t, size_t s){ return banded ? memory_horizon+s-t : s; };
+        if(num_threads == 0)
+        {
+            num_threads = max<size_t>(thread::hardware_concurrency(),1);
+        }
+        num_threads = max<size_t>(min(num_threads,num_ts),1);
+        // THE ROWS t ARE DISTRIBUTED OVER THE THREADS, STARTING WITH THE LONGEST MEMORY INTEGRALS
+        atomic<size_t> next_row(0);
+        auto worker = [&]()
+        {
+            gsl_matrix * out = gsl_matrix_alloc(num_obs,num_traj);
+            for(size_t r=next_row++; r+1<num_ts; r=next_row++)
             {
-                for(size_t i=0; i<num_obs;i++)
+                size_t t = num_ts-1-r;
+                size_t t0 = memory_horizon>0 && t>memory_horizon ? t-memory_horizon : 0;
+                size_t t_end = t;
+                if(!darboux_sum)
                 {
-                    dummy = 0.0;
-                    size_t t2=0;
-                    while(t2+1<t1)
+                    // SIMPSON WEIGHTS 1,4,2,4,...,4,1 ARE MULTIPLIED INTO THE KERNEL ROW IN PLACE
+                    // FOR AN ODD NUMBER OF INTERVALS, THE TRAPEZOIDAL RULE IS USED FOR THE LAST ONE
+                    vector<double> weights(t-t0+1,0.0);
+                    size_t t2 = t0;
+                    while(t2+1<t)
                     {
-                        for(size_t k=0; k<num_obs; k++)
-                        {
-                            dummy += kernel[k_incr_0*t1+k_incr_1*t2+k_incr_2*i+k]*trajectories[traj_incr_0*n+traj_incr_1*t2+k];
-                            dummy += 4.0*kernel[k_incr_0*t1+k_incr_1*(t2+1)+k_incr_2*i+k]*trajectories[traj_incr_0*n+traj_incr_1*(t2+1)+k];
-                            dummy += kernel[k_incr_0*t1+k_incr_1*(t2+2)+k_incr_2*i+k]*trajectories[traj_incr_0*n+traj_incr_1*(t2+2)+k];
-                        }
+                        weights[t2-t0] += 1.0;
+                        weights[t2+1-t0] += 4.0;
+                        weights[t2+2-t0] += 1.0;
                         t2+=2;
                     }
-                    if(t2+1 == t1) // Trapezoidal rule for last time-interval
+                    if(t2+1 == t)
                     {
-                        for(size_t k=0; k<num_obs; k++)
-                        {
-                            dummy += 1.5*kernel[k_incr_0*t1+k_incr_1*t2+k_incr_2*i+k]*trajectories[traj_incr_0*n+traj_incr_1*t2+k];
-                            dummy += 1.5*kernel[k_incr_0*t1+k_incr_1*(t2+1)+k_incr_2*i+k]*trajectories[traj_incr_0*n+traj_incr_1*(t2+1)+k];
-                        }
+                        weights[t2-t0] += 1.5;
+                        weights[t-t0] += 1.5;
                     }
-                    buffer(n,t1,i) = dummy;
+                    for(size_t s=t0; s<=t; s++)
+                    {
+                        gsl_matrix_view kernel_ts = gsl_matrix_view_array(&kernel(t,column(t,s)),num_obs,num_obs);
+                        gsl_matrix_scale(&kernel_ts.matrix,weights[s-t0]);
+                    }
+                    t_end = t+1;
                 }
+                gsl_matrix_const_view kernel_t = gsl_matrix_const_view_array(&kernel(t,column(t,t0)),(t_end-t0)*num_obs,num_obs);
+                gsl_matrix_const_view traj = gsl_matrix_const_view_array(&trajectories(t0),(t_end-t0)*num_obs,num_traj);
+                gsl_blas_dgemm(CblasTrans,CblasNoTrans,1.0,&kernel_t.matrix,&traj.matrix,0.0,out);
+                memcpy(&buffer(t),out->data,num_obs*num_traj*sizeof(double));
             }
+            gsl_matrix_free(out);
+        };
+        vector<thread> workers;
+        for(size_t n=0; n<num_threads; n++)
+        {
+            workers.emplace_back(worker);
+        }
+        for(thread &w : workers)
+        {
+            w.join();
         }
-        buffer *= dt/3.0;
-        diff_traj -= buffer; // = dA/dt-drift*A-SUM_t2 K(.,t2)*A(t2)
     }
+    buffer=buffer.transpose({2,0,1});
+    trajectories = trajectories.transpose({2,0,1});
+    diff_traj -= buffer*(darboux_sum ? dt : dt/3.0); // = dA/dt-drift*A-SUM_t2 K(.,t2)*A(t2)
 
     return diff_traj;
 }
@@ -1216,7 +1618,8 @@ tensor<double,3> KernelMethods::getFluctuatingForce(
     tensor<double,2> &drift,
     tensor<double,3> &trajectories,
     tensor<double,1> &times,
-    bool darboux_sum)
+    bool darboux_sum,
+    size_t memory_horizon)
 {
     double dt = times[1]-times[0];
     size_t num_traj = trajectories.shape[0];
@@ -1249,7 +1652,8 @@ tensor<double,3> KernelMethods::getFluctuatingForce(
     tensor<double,3> buffer;
     if(darboux_sum)
     {
-        tensor<double,3> kernel_buffer(kernel.shape);
+        tensor<double,3> kernel_buffer;
+        kernel_buffer.alloc_uninitialized(kernel.shape);
         for(size_t t=0; t<kernel.shape[0]; t++)
         {
             for(size_t i=0;i<kernel.shape[1];i++)
@@ -1260,28 +1664,27 @@ tensor<double,3> KernelMethods::getFluctuatingForce(
                 }
             }
         }
-        kernel = kernel_buffer;
-        kernel_buffer.clear();
+        kernel = std::move(kernel_buffer);
         trajectories=trajectories.transpose({1,2,0});
         kernel=kernel.transpose({0,2,1});
         buffer.alloc({num_ts,num_obs,num_traj},0.0);
         gsl_matrix * out = gsl_matrix_alloc(num_obs,num_traj);
         for(size_t t=1;t<num_ts;t++)
         {
-            gsl_matrix_const_view kernel_t = gsl_matrix_const_view_array(&kernel( (kernel.shape[0]+1)/2-1 -t ),t*num_obs,num_obs);
-            gsl_matrix_const_view traj = gsl_matrix_const_view_array(&trajectories[0],t*num_obs,num_traj);
+            size_t t0 = memory_horizon>0 && t>memory_horizon ? t-memory_horizon : 0;
+            gsl_matrix_const_view kernel_t = gsl_matrix_const_view_array(&kernel( (kernel.shape[0]+1)/2-1 -t+t0 ),(t-t0)*num_obs,num_obs);
+            gsl_matrix_const_view traj = gsl_matrix_const_view_array(&trajectories(t0),(t-t0)*num_obs,num_traj);
             gsl_blas_dgemm(CblasTrans,CblasNoTrans,1.0,&kernel_t.matrix,&traj.matrix,0.0,out);
             memcpy(&buffer(t),out->data,num_obs*num_traj*sizeof(double));
         }
         gsl_matrix_free(out);
         buffer=buffer.transpose({2,0,1});
-        buffer *=dt;
         trajectories = trajectories.transpose({2,0,1});
-        diff_traj -= buffer; // = dA/dt-drift*A-SUM_t2 K(.,t2)*A(t2)
+        diff_traj -= buffer*dt; // = dA/dt-drift*A-SUM_t2 K(.,t2)*A(t2)
     }
     else
     {
-        buffer.alloc({num_traj,num_ts,num_obs});
+        buffer.alloc_uninitialized({num_traj,num_ts,num_obs});
         const size_t k_incr_0 = kernel.incr[0];
         const size_t k_incr_1 = kernel.incr[1];
         const size_t traj_incr_0 = trajectories.incr[0];
@@ -1294,7 +1697,7 @@ tensor<double,3> KernelMethods::getFluctuatingForce(
                 for(size_t i=0; i<num_obs;i++)
                 {
                     dummy = 0.0;
-                    size_t t2=0;
+                    size_t t2 = memory_horizon>0 && t1>memory_horizon ? t1-memory_horizon : 0;
                     while(t2+1<t1)
                     {
                         for(size_t k=0; k<num_obs; k++)
@@ -1317,13 +1720,12 @@ tensor<double,3> KernelMethods::getFluctuatingForce(
                 }
             }
         }
-        buffer *= dt/3.0;
-        diff_traj -= buffer; // = dA/dt-drift*A-SUM_t2 K(.,t2)*A(t2)
+        diff_traj -= buffer*(dt/3.0); // = dA/dt-drift*A-SUM_t2 K(.,t2)*A(t2)
     }
     return diff_traj;
 }
 
-void KernelMethods::writeCovarianceMatrix(tensor<double,3> &ff, filesystem::path out_path, bool stationary)
+void KernelMethods::writeCovarianceMatrix(tensor<double,3> &ff, filesystem::path out_path, bool stationary, TensorUtils::Encoding encoding)
 {
     tensor<double,2> ff_average = subAverage(ff);
     cout << "Write mean values of fluctuating forces: " << out_path/"ff_average.f64" << endl;
@@ -1332,7 +1734,7 @@ void KernelMethods::writeCovarianceMatrix(tensor<double,3> &ff, filesystem::path
     {
         tensor<double,4> ff_cov = getCorrelationFunction(ff,true);
         cout << "Write covariance matrix of fluctuating forces: " << out_path/"ff_cov.f64" << endl;
-        ff_cov.write("ff_cov.f64", out_path);
+        ff_cov.write("ff_cov.f64", out_path, encoding);
     }
     else
     {
@@ -1342,24 +1744,16 @@ void KernelMethods::writeCovarianceMatrix(tensor<double,3> &ff, filesystem::path
     }
 }
 
-void KernelMethods::writeExtendedCovarianceMatrix(tensor<double,3> &traj, tensor<double,3> &ff, filesystem::path out_path, bool stationary)
+void KernelMethods::writeExtendedCovarianceMatrix(tensor<double,3> &traj, tensor<double,3> &ff, filesystem::path out_path, bool stationary, TensorUtils::Encoding encoding)
 {
     if(!stationary)
     {
         size_t num_traj = ff.shape[0];
         size_t num_ts = ff.shape[1];
         size_t num_obs = ff.shape[2];
-        tensor<double,3> ff_buffer({num_traj,num_ts+1,num_obs});
-        for(size_t n=0; n<num_traj; n++)
-        {
-            for(size_t t=0; t<num_ts; t++)
-            {
-                for(size_t o=0; o<num_obs; o++)
-                {
-                    ff_buffer(n,t+1,o) = ff(n,t,o);
-                }
-            }
-        }
+        tensor<double,3> ff_buffer;
+        ff_buffer.alloc_uninitialized({num_traj,num_ts+1,num_obs});
+        tensor_view<double>(ff_buffer).range(1,1,num_ts+1).copy_from(&ff[0]);
         for(size_t n=0; n<num_traj; n++)
         {
             for(size_t o=0; o<num_obs; o++)
@@ -1372,7 +1766,7 @@ void KernelMethods::writeExtendedCovarianceMatrix(tensor<double,3> &traj, tensor
         ff_average.write("ff_average.f64",out_path);
         tensor<double,4> ff_cov = getCorrelationFunction(ff_buffer,true);
         cout << "Write covariance matrix of initial values and fluctuating forces: " << out_path/"ff_cov.f64" << endl;
-        ff_cov.write("ff_cov.f64", out_path);
+        ff_cov.write("ff_cov.f64", out_path, encoding);
     }
     else
     {
@@ -1443,320 +1837,1209 @@ void KernelMethods::writeExtendedCovarianceMatrix(tensor<double,3> &traj, tensor
     }
 }
 
-tensor<double,3> KernelMethods::simulateTrajectories(
-    tensor<double,3> &traj,
-    tensor<double,3> &drift,
-    tensor<double,4> &kernel,
-    tensor<double,1> &mean_initial_value,
-    RandomForceGenerator &rfg,
-    double dt,
-    bool shift,
-    bool gaussian_init_val,
-    bool darboux_sum,
-    size_t num_sim,
-    filesystem::path out_path)
+void KernelMethods::writeBandedCovarianceMatrix(tensor<double,3> &ff, size_t width, filesystem::path out_path, tensor<double,3> *traj)
 {
-    size_t num_traj = traj.shape[0];
-    size_t num_ts = traj.shape[1];
-    size_t num_obs = traj.shape[2];
+    if(traj != nullptr)
+    {
+        size_t num_traj = ff.shape[0];
+        size_t num_ts = ff.shape[1];
+        size_t num_obs = ff.shape[2];
+        tensor<double,3> ff_buffer;
+        ff_buffer.alloc_uninitialized({num_traj,num_ts+1,num_obs});
+        tensor_view<double>(ff_buffer).range(1,1,num_ts+1).copy_from(&ff[0]);
+        for(size_t n=0; n<num_traj; n++)
+        {
+            for(size_t o=0; o<num_obs; o++)
+            {
+                ff_buffer(n,0,o) = (*traj)(n,0,o);
+            }
+        }
+        writeBandedCovarianceMatrix(ff_buffer,width,out_path);
+        return;
+    }
+    tensor<double,2> ff_average = subAverage(ff);
+    cout << "Write mean values of fluctuating forces: " << out_path/"ff_average.f64" << endl;
+    ff_average.write("ff_average.f64",out_path);
+    tensor<double,4> ff_cov = getBandedCorrelationFunction(ff,width,true);
+    cout << "Write band of the covariance matrix of fluctuating forces: " << out_path/"ff_cov_banded.f64" << endl;
+    ff_cov.write("ff_cov_banded.f64",out_path);
+}
 
-    if(gaussian_init_val)
+void KernelMethods::accumulateMoments(
+    tensor<double,3> &samples,
+    tensor<double,2> &sum,
+    tensor<double,4> &sum_outer,
+    double alpha)
+{
+    size_t num_samples = samples.shape[0];
+    size_t num_ts = samples.shape[1];
+    size_t num_obs = samples.shape[2];
+    size_t dim = num_ts*num_obs;
+    if(sum.size()!=dim)
     {
-        traj.clear();
+        sum.alloc({num_ts,num_obs},0.0);
+    }
+    if(sum_outer.size()!=dim*dim)
+    {
+        sum_outer.alloc({num_ts,num_obs,num_ts,num_obs},0.0);
     }
+    for(size_t n=0; n<num_samples; n++)
+    {
+        for(size_t k=0; k<dim; k++)
+        {
+            sum[k] += alpha*samples[n*dim+k];
+        }
+    }
+    gsl_matrix_const_view x = gsl_matrix_const_view_array(&samples[0],num_samples,dim);
+    gsl_matrix_view x2 = gsl_matrix_view_array(&sum_outer[0],dim,dim);
+    gsl_blas_dsyrk(CblasLower,CblasTrans,alpha,&x.matrix,1.0,&x2.matrix);
+}
 
-    tensor<double,3> sim;
-    tensor<double,3> rand_ff({num_sim,num_ts,num_obs});
-    if(darboux_sum)
+tensor<double,4> KernelMethods::getCorrelationFromMoments(
+    tensor<double,2> &sum,
+    tensor<double,4> &sum_outer,
+    size_t num_samples,
+    tensor<double,2> &offset,
+    bool unbiased)
+{
+    size_t dim = sum.size();
+    double norm = unbiased ? 1.0/(num_samples-1) : 1.0/num_samples;
+    tensor<double,4> correlation;
+    correlation.alloc_uninitialized(sum_outer.shape);
+    for(size_t a=0; a<dim; a++)
     {
-        kernel=kernel.transpose({0,1,3,2});
-        tensor<double,2> rand_ff_buffer;
-        sim.alloc({num_ts,num_obs,num_sim});
-        for(size_t n=0;n<num_sim; n++)
+        for(size_t b=0; b<=a; b++)
         {
-            rand_ff_buffer = rfg.pull_multivariate_gaussian();
-            if(!gaussian_init_val)
-            {
-                for(size_t i=0; i<num_obs; i++)
-                {
-                    sim(0,i,n) = traj(n%num_traj,0,i); // set initial value
-                }
-                memcpy(&rand_ff(n),&rand_ff_buffer[0],num_ts*num_obs*sizeof(double));
-            }
-            else
+            double val = sum_outer[a*dim+b]-offset[a]*sum[b]-sum[a]*offset[b]+num_samples*offset[a]*offset[b];
+            correlation[a*dim+b] = correlation[b*dim+a] = norm*val;
+        }
+    }
+    return correlation;
+}
+
+tensor<double,3> KernelMethods::averageStationaryCorrelation(tensor<double,4> &correlation)
+{
+    size_t num_ts = correlation.shape[0];
+    size_t num_obs = correlation.shape[1];
+    tensor<double,3> corr_out({2*num_ts-1,num_obs,num_obs},0.0);
+    for(size_t t=0; t<num_ts; t++)
+    {
+        for(size_t s=0; s<num_ts; s++)
+        {
+            for(size_t i=0; i<num_obs; i++)
             {
-                for(size_t i=0; i<num_obs; i++)
+                for(size_t j=0; j<num_obs; j++)
                 {
-                    sim(0,i,n) = rand_ff_buffer(0,i); // set initial value
+                    corr_out(num_ts-1+t-s,i,j) += correlation(t,i,s,j);
                 }
-                memcpy(&rand_ff(n),&rand_ff_buffer(1),num_ts*num_obs*sizeof(double));
             }
         }
-        gsl_matrix * out = gsl_matrix_alloc(num_obs,num_sim);
-        tensor<double,2> buff({num_obs,num_sim},0.0);
-        for(size_t t=0;t+1<num_ts;t++)
+    }
+    for(size_t tau=0; tau<2*num_ts-1; tau++)
+    {
+        double norm = 1.0/(num_ts-(tau<num_ts ? num_ts-1-tau : tau-num_ts+1));
+        for(size_t i=0; i<num_obs; i++)
         {
-            if(t>0)
-            {
-                gsl_matrix_const_view kernel_t1 = gsl_matrix_const_view_array(&kernel(t),t*num_obs,num_obs);
-                gsl_matrix_const_view trajectory = gsl_matrix_const_view_array(&sim[0],t*num_obs,num_sim);
-                gsl_blas_dgemm(CblasTrans,CblasNoTrans,1.0,&kernel_t1.matrix,&trajectory.matrix,0.0,out);
-                buff << *out->data;
-            }
-            buff*=dt;
-            for(size_t n=0;n<num_sim;n++)
+            for(size_t j=0; j<num_obs; j++)
             {
-                for(size_t i = 0; i<num_obs; i++)
-                {
-                    for(size_t k = 0; k<num_obs; k++)
-                    {
-                        buff(i,n) += drift(t,i,k)*sim(t,k,n);
-                    }
-                    buff(i,n) += rand_ff(n,t,i);
-                }
-                for(size_t i=0;i<num_obs;i++)
-                {
-                    sim(t+1,i,n) = sim(t,i,n)+dt*buff(i,n);
-                }
+                corr_out(tau,i,j) *= norm;
             }
         }
-        gsl_matrix_free(out);
-        if(shift)
+    }
+    return corr_out;
+}
+
+void KernelMethods::writeEnsembleCorrelation(
+    tensor<double,2> &sum,
+    tensor<double,4> &sum_outer,
+    size_t num_samples,
+    tensor<double,1> &times,
+    filesystem::path out_path,
+    bool shift,
+    bool txt_out,
+    bool stationary)
+{
+    size_t num_ts = sum.shape[0];
+    size_t num_obs = sum.shape[1];
+    tensor<double,2> offset({num_ts,num_obs},0.0);
+    if(shift)
+    {
+        tensor<double,1> mean_initial_value({num_obs});
+        for(size_t o=0; o<num_obs; o++)
         {
-            for(size_t n=0;n<num_sim; n++)
+            mean_initial_value[o] = sum(0,o)/num_samples;
+            for(size_t t=0; t<num_ts; t++)
             {
-                for(size_t t=0; t<num_ts; t++)
-                {
-                    for(size_t o=0; o<num_obs; o++)
-                    {
-                        sim(t,o,n) += mean_initial_value[o];
-                    }
-                }
+                offset(t,o) = mean_initial_value[o];
             }
         }
-        sim=sim.transpose({2,0,1});
+        cout << "Write mean initial values: " << out_path/"mean_initial_value.f64" << endl;
+        mean_initial_value.write("mean_initial_value.f64",out_path);
+        if(txt_out)
+        {
+            mean_initial_value.write("mean_initial_value.txt",out_path);
+        }
+    }
+    tensor<double,4> correlation = getCorrelationFromMoments(sum,sum_outer,num_samples,offset);
+    if(!stationary)
+    {
+        cout << "Write correlation function: " << out_path/"correlation.f64" << endl;
+        correlation.write("correlation.f64",out_path);
+        if(txt_out)
+        {
+            InputOutput::write(times,correlation,out_path/"correlation.txt");
+        }
     }
     else
     {
-        tensor<double,2> rand_ff_buffer;
-        tensor<double,2> rand_ff_n({num_ts,num_obs});
-        tensor<double,2> simulated_trajectory({num_ts,num_obs});
-        RK4 rk4;
-        sim.alloc({num_sim,num_ts,num_obs});
-        for(size_t n=0;n<num_sim; n++)
+        tensor<double,3> correlation_stationary = averageStationaryCorrelation(correlation);
+        cout << "Write correlation function: " << out_path/"correlation_stationary.f64" << endl;
+        correlation_stationary.write("correlation_stationary.f64",out_path);
+        if(txt_out)
         {
-
-            rand_ff_buffer = rfg.pull_multivariate_gaussian();
-
-            if(!gaussian_init_val)
-            {
-                for(size_t i=0; i<num_obs; i++)
-                {
-                    simulated_trajectory(0,i) = traj(n%num_traj,0,i); // set initial value
-                }
-                rand_ff_n = rand_ff_buffer;
-            }
-            else
-            {
-                for(size_t i=0; i<num_obs; i++)
-                {
-                    simulated_trajectory(0,i) = rand_ff_buffer(0,i); // set initial value
-                }
-                rand_ff_n << rand_ff_buffer(1);
-            }
-
-            rk4.integrate(dt,drift,kernel,simulated_trajectory,rand_ff_n);
-
-            if(shift)
+            double dt = times[1]-times[0];
+            tensor<double,1> lag_times({2*num_ts-1});
+            for(size_t t=0;t<num_ts;t++)
             {
-                for(size_t t=0; t<num_ts; t++)
-                {
-                    for(size_t o=0; o<num_obs; o++)
-                    {
-                        simulated_trajectory(t,o) += mean_initial_value[o];
-                    }
-                }
+                lag_times[num_ts-1+t] = +dt*t;
+                lag_times[num_ts-1-t] = -dt*t;
             }
-            simulated_trajectory >> sim(n);
-            rand_ff_n >> rand_ff(n);
+            InputOutput::write(lag_times,correlation_stationary,out_path/"correlation_stationary.txt");
         }
     }
-    cout << "Write random fluctuating forces: " << (out_path/"SIM")/"rand_ff.f64" << endl;
-    filesystem::create_directories(out_path/"SIM");
-    rand_ff.write("rand_ff.f64",out_path/"SIM");
-    return sim;
 }
 
-tensor<double,3> KernelMethods::simulateTrajectories(
+void KernelMethods::writeResamplingErrors(
     tensor<double,3> &traj,
-    tensor<double,2> &drift,
-    tensor<double,3> &kernel,
-    tensor<double,1> &mean_initial_value,
-    RandomForceGenerator &rfg,
-    double dt,
-    bool shift,
-    bool gaussian_init_val,
-    bool darboux_sum,
-    size_t num_sim,
-    filesystem::path out_path,
-    bool accelerate_stationary_decomp)
+    tensor<double,1> &times,
+    size_t num_blocks,
+    size_t num_replicas,
+    size_t num_threads,
+    size_t memory_horizon,
+    filesystem::path out_path,
+    bool txt_out,
+    bool banded)
 {
     size_t num_traj = traj.shape[0];
     size_t num_ts = traj.shape[1];
     size_t num_obs = traj.shape[2];
+    size_t dim = num_ts*num_obs;
+    double dt = times[1]-times[0];
+    if(num_traj < 2)
+    {
+        throw ErrorHandler::ShapeMismatch("KernelMethods::writeResamplingErrors: Resampling requires at least two trajectories!");
+    }
+    // THE BAND OF THE CORRELATION FUNCTION REQUIRED BY getBandedMemoryKernel
+    size_t width = memory_horizon+2;
+    num_blocks = min(max<size_t>(num_blocks,2),num_traj);
+    bool jackknife = (num_replicas == 0);
+    num_replicas = jackknife ? num_blocks : max<size_t>(num_replicas,2);
+    if(num_threads == 0)
+    {
+        num_threads = max<size_t>(thread::hardware_concurrency(),1);
+    }
+    num_threads = min(num_threads,num_replicas);
 
-    if(gaussian_init_val)
+    // MOMENTS OF THE BLOCKS
+    vector<tensor<double,2>> block_sum(num_blocks);
+    vector<tensor<double,4>> block_sum_outer(num_blocks);
+    vector<size_t> block_size(num_blocks);
+    for(size_t b=0; b<num_blocks; b++)
     {
-        traj.clear();
+        size_t begin = b*num_traj/num_blocks;
+        size_t end = (b+1)*num_traj/num_blocks;
+        block_size[b] = end-begin;
+        tensor<double,3> samples;
+        samples.alloc_uninitialized({end-begin,num_ts,num_obs});
+        copy(&traj[begin*dim],&traj[begin*dim]+(end-begin)*dim,&samples[0]);
+        if(banded)
+        {
+            block_sum_outer[b] = getBandedCorrelationFunction(samples,width);
+            block_sum_outer[b] *= double(end-begin);
+        }
+        else
+        {
+            accumulateMoments(samples,block_sum[b],block_sum_outer[b]);
+        }
     }
 
-    tensor<double,3> sim;
-    tensor<double,3> rand_ff({num_sim,num_ts,num_obs});
-    if(darboux_sum)
+    // CORRELATION, DRIFT AND KERNEL FOR THE GIVEN MULTIPLICITIES OF THE BLOCKS
+    auto estimate = [&](vector<size_t> &weights, tensor<double,4> &correlation, tensor<double,3> &drift, tensor<double,4> &kernel)
     {
-        tensor<double,3> kernel_buffer(kernel.shape);
-        for(size_t t=0; t<kernel.shape[0]; t++)
+        if(banded)
         {
-            for(size_t i=0;i<kernel.shape[1];i++)
+            correlation.alloc({num_ts,width+1,num_obs,num_obs},0.0);
+            size_t num_samples = 0;
+            for(size_t b=0; b<num_blocks; b++)
             {
-                for(size_t j=0;j<kernel.shape[2];j++)
-                {
-                    kernel_buffer(kernel.shape[0]-1-t,i,j) = kernel(t,i,j);
-                }
-            }
-        }
-        kernel = kernel_buffer;
-        kernel_buffer.clear();
-        kernel=kernel.transpose({0,2,1}); //kernel=kernel.transpose({0,1,3,2});
-        tensor<double,2> rand_ff_buffer;
-        filesystem::create_directories(out_path/"SIM");
-        sim.alloc({num_ts,num_obs,num_sim});
-        for(size_t n=0;n<num_sim; n++)
-        {
-            if(!gaussian_init_val)
-            {
-                if(accelerate_stationary_decomp)
-                {
-                    rand_ff_buffer = rfg.pull_stationary_multivariate_gaussian();
-                }
-                else
-                {
-                    rand_ff_buffer = rfg.pull_multivariate_gaussian();
-                }
-                for(size_t i=0; i<num_obs; i++)
-                {
-                    sim(0,i,n) = traj(n%num_traj,0,i); // set initial value
-                }
-                memcpy(&rand_ff(n),&rand_ff_buffer[0],num_ts*num_obs*sizeof(double));
-            }
-            else
-            {
-                rand_ff_buffer = rfg.pull_multivariate_gaussian();
-                for(size_t i=0; i<num_obs; i++)
+                num_samples += weights[b]*block_size[b];
+                for(size_t k=0; weights[b]>0 && k<correlation.size(); k++)
                 {
-                    sim(0,i,n) = rand_ff_buffer(0,i); // set initial value
+                    correlation[k] += weights[b]*block_sum_outer[b][k];
                 }
-                memcpy(&rand_ff(n),&rand_ff_buffer(1),num_ts*num_obs*sizeof(double));
             }
+            correlation *= 1.0/num_samples;
+            drift = getBandedDrift(correlation,dt);
+            kernel = getBandedMemoryKernel(correlation,dt,memory_horizon);
+            return;
         }
-        gsl_matrix * out = gsl_matrix_alloc(num_obs,num_sim);
-        tensor<double,2> buff({num_obs,num_sim},0.0);
-        for(size_t t=0;t+1<num_ts;t++)
+        tensor<double,2> sum({num_ts,num_obs},0.0);
+        tensor<double,4> sum_outer({num_ts,num_obs,num_ts,num_obs},0.0);
+        size_t num_samples = 0;
+        for(size_t b=0; b<num_blocks; b++)
         {
-            if(t>0)
+            if(weights[b] == 0)
             {
-                gsl_matrix_const_view kernel_t1 = gsl_matrix_const_view_array(&kernel( (kernel.shape[0]+1)/2-1 -t ),t*num_obs,num_obs);
-                gsl_matrix_const_view trajectory = gsl_matrix_const_view_array(&sim[0],t*num_obs,num_sim);
-                gsl_blas_dgemm(CblasTrans,CblasNoTrans,1.0,&kernel_t1.matrix,&trajectory.matrix,0.0,out);
-                buff << *out->data;
+                continue;
             }
-            buff*=dt;
-            for(size_t n=0;n<num_sim;n++)
+            num_samples += weights[b]*block_size[b];
+            for(size_t a=0; a<dim; a++)
             {
-                for(size_t i = 0; i<num_obs; i++)
-                {
-                    for(size_t k = 0; k<num_obs; k++)
-                    {
-                        buff(i,n) += drift(i,k)*sim(t,k,n);
-                    }
-                    buff(i,n) += rand_ff(n,t,i);
-                }
-                for(size_t i=0;i<num_obs;i++)
+                sum[a] += weights[b]*block_sum[b][a];
+                for(size_t c=0; c<=a; c++)
                 {
-                    sim(t+1,i,n) = sim(t,i,n)+dt*buff(i,n);
+                    sum_outer[a*dim+c] += weights[b]*block_sum_outer[b][a*dim+c];
                 }
             }
         }
-        gsl_matrix_free(out);
-        if(shift)
-        {
-            for(size_t n=0;n<num_sim; n++)
+        tensor<double,2> offset({num_ts,num_obs},0.0);
+        correlation = getCorrelationFromMoments(sum,sum_outer,num_samples,offset);
+        drift = getDrift(correlation,dt);
+        sum_outer = correlation;
+        kernel.alloc_uninitialized({num_ts,num_obs,num_ts,num_obs});
+        gsl_matrix_view kernel_mat = GslAdapter::matrix(kernel);
+        gsl_matrix_view corr_mat = GslAdapter::matrix(sum_outer);  // sum_outer is destroyed
+        getMemoryKernel(&kernel_mat.matrix,&corr_mat.matrix,num_ts,num_obs,dt);
+        applyMemoryHorizon(kernel,memory_horizon);
+    };
+
+    // DEVIATIONS OF THE REPLICAS FROM THE ESTIMATE OF ALL TRAJECTORIES
+    // THE REPLICAS ARE CLOSE TO EACH OTHER, HENCE THEIR RAW MOMENTS WOULD CANCEL
+    tensor<double,4> correlation;
+    tensor<double,3> drift;
+    tensor<double,4> kernel;
+    vector<size_t> all_blocks(num_blocks,1);
+    estimate(all_blocks,correlation,drift,kernel);
+    tensor<double,4> corr_dev(correlation.shape,0.0);
+    tensor<double,4> corr_dev2(correlation.shape,0.0);
+    tensor<double,3> drift_dev(drift.shape,0.0);
+    tensor<double,3> drift_dev2(drift.shape,0.0);
+    tensor<double,4> kernel_dev(kernel.shape,0.0);
+    tensor<double,4> kernel_dev2(kernel.shape,0.0);
+    auto accumulate = [](TensorBase<double> &replica, TensorBase<double> &full, TensorBase<double> &dev, TensorBase<double> &dev2)
+    {
+        for(size_t k=0; k<full.size(); k++)
+        {
+            double d = replica[k]-full[k];
+            dev[k] += d;
+            dev2[k] += d*d;
+        }
+    };
+
+    atomic<size_t> next_replica(0);
+    mutex accumulate_mutex;
+    auto worker = [&]()
+    {
+        gsl_rng *rng = gsl_rng_alloc(gsl_rng_mt19937);
+        vector<size_t> weights(num_blocks);
+        tensor<double,4> rep_correlation;
+        tensor<double,3> rep_drift;
+        tensor<double,4> rep_kernel;
+        for(size_t r=next_replica++; r<num_replicas; r=next_replica++)
+        {
+            if(jackknife)
+            {
+                fill(weights.begin(),weights.end(),1);
+                weights[r] = 0;
+            }
+            else
             {
-                for(size_t t=0; t<num_ts; t++)
+                // THE SEED DEPENDS ON THE REPLICA ONLY, NOT ON THE THREAD
+                fill(weights.begin(),weights.end(),0);
+                gsl_rng_set(rng,r+1);
+                for(size_t b=0; b<num_blocks; b++)
                 {
-                    for(size_t o=0; o<num_obs; o++)
-                    {
-                        sim(t,o,n) += mean_initial_value[o];
-                    }
+                    weights[gsl_rng_uniform_int(rng,num_blocks)]++;
                 }
             }
+            estimate(weights,rep_correlation,rep_drift,rep_kernel);
+            lock_guard<mutex> lock(accumulate_mutex);
+            accumulate(rep_correlation,correlation,corr_dev,corr_dev2);
+            accumulate(rep_drift,drift,drift_dev,drift_dev2);
+            accumulate(rep_kernel,kernel,kernel_dev,kernel_dev2);
         }
-        sim=sim.transpose({2,0,1});
+        gsl_rng_free(rng);
+    };
+    cout << "Resample " << num_replicas << (jackknife ? " jackknife" : " bootstrap") << " replicas of " << num_blocks << " blocks on " << num_threads << " threads." << endl;
+    vector<thread> workers;
+    for(size_t n=0; n<num_threads; n++)
+    {
+        workers.emplace_back(worker);
     }
-    else
+    for(thread &w : workers)
     {
-        tensor<double,2> rand_ff_buffer;
-        tensor<double,2> rand_ff_n({num_ts,num_obs});
-        tensor<double,2> simulated_trajectory({num_ts,num_obs});
-        RK4 rk4;
-        filesystem::create_directories(out_path/"SIM");
-        sim.alloc({num_sim,num_ts,num_obs});
-        for(size_t n=0;n<num_sim; n++)
-        {
-            if(!gaussian_init_val)
-            {
-                if(accelerate_stationary_decomp)
-                {
-                    rand_ff_buffer = rfg.pull_stationary_multivariate_gaussian();
-                }
-                else
-                {
-                    rand_ff_buffer = rfg.pull_multivariate_gaussian();
-                }
-                for(size_t i=0; i<num_obs; i++)
-                {
-                    simulated_trajectory(0,i) = traj(n%num_traj,0,i); // set initial value
-                }
-                rand_ff_n = rand_ff_buffer;
-            }
-            else
-            {
-                rand_ff_buffer = rfg.pull_multivariate_gaussian();
-                for(size_t i=0; i<num_obs; i++)
-                {
-                    simulated_trajectory(0,i) = rand_ff_buffer(0,i); // set initial value
-                }
-                rand_ff_n << rand_ff_buffer(1);
-            }
+        w.join();
+    }
 
-            rk4.integrate(dt,drift,kernel,simulated_trajectory,rand_ff_n);
+    // dev IS REPLACED BY THE MEAN AND dev2 BY THE ERROR OF THE REPLICAS
+    auto finalize = [&](TensorBase<double> &full, TensorBase<double> &dev, TensorBase<double> &dev2)
+    {
+        double norm = jackknife ? (num_replicas-1.0)/num_replicas : 1.0/(num_replicas-1.0);
+        for(size_t k=0; k<full.size(); k++)
+        {
+            double mean_dev = dev[k]/num_replicas;
+            dev[k] = full[k]+mean_dev;
+            dev2[k] = sqrt(max(norm*(dev2[k]-num_replicas*mean_dev*mean_dev),0.0));
+        }
+    };
+    finalize(correlation,corr_dev,corr_dev2);
+    finalize(drift,drift_dev,drift_dev2);
+    finalize(kernel,kernel_dev,kernel_dev2);
 
-            if(shift)
+    if(banded)
+    {
+        cout << "Write resampling errors: " << out_path/"correlation_banded_resampling_error.f64" << endl;
+        corr_dev.write("correlation_banded_resampling_mean.f64",out_path);
+        corr_dev2.write("correlation_banded_resampling_error.f64",out_path);
+        drift_dev.write("drift_resampling_mean.f64",out_path);
+        drift_dev2.write("drift_resampling_error.f64",out_path);
+        kernel_dev.write("kernel_banded_resampling_mean.f64",out_path);
+        kernel_dev2.write("kernel_banded_resampling_error.f64",out_path);
+        if(txt_out)
+        {
+            InputOutput::write(times,drift_dev,out_path/"drift_resampling_mean.txt");
+            InputOutput::write(times,drift_dev2,out_path/"drift_resampling_error.txt");
+        }
+        return;
+    }
+    cout << "Write resampling errors: " << out_path/"correlation_resampling_error.f64" << endl;
+    corr_dev.write("correlation_resampling_mean.f64",out_path);
+    corr_dev2.write("correlation_resampling_error.f64",out_path);
+    drift_dev.write("drift_resampling_mean.f64",out_path);
+    drift_dev2.write("drift_resampling_error.f64",out_path);
+    kernel_dev.transpose({0,2,1,3}).write("kernel_resampling_mean.f64",out_path);
+    kernel_dev2.transpose({0,2,1,3}).write("kernel_resampling_error.f64",out_path);
+    if(txt_out)
+    {
+        InputOutput::write(times,corr_dev,out_path/"correlation_resampling_mean.txt");
+        InputOutput::write(times,corr_dev2,out_path/"correlation_resampling_error.txt");
+        InputOutput::write(times,drift_dev,out_path/"drift_resampling_mean.txt");
+        InputOutput::write(times,drift_dev2,out_path/"drift_resampling_error.txt");
+        InputOutput::write(times,kernel_dev,out_path/"kernel_resampling_mean.txt");
+        InputOutput::write(times,kernel_dev2,out_path/"kernel_resampling_error.txt");
+    }
+}
+
+vector<vector<size_t>> KernelMethods::getObservableBlocks(tensor<double,4> &correlation, double tolerance)
+{
+    size_t num_ts = correlation.shape[0];
+    size_t num_obs = correlation.shape[1];
+
+    // UNION-FIND OF THE COUPLED OBSERVABLES
+    vector<size_t> root(num_obs);
+    for(size_t i=0; i<num_obs; i++)
+    {
+        root[i] = i;
+    }
+    auto find_root = [&](size_t i)
+    {
+        while(root[i] != i)
+        {
+            root[i] = root[root[i]];
+            i = root[i];
+        }
+        return i;
+    };
+    for(size_t i=0; i<num_obs; i++)
+    {
+        for(size_t j=i+1; j<num_obs; j++)
+        {
+            if(find_root(i) == find_root(j))
+            {
+                continue;
+            }
+            bool coupled = false;
+            for(size_t t=0; t<num_ts && !coupled; t++)
             {
-                for(size_t t=0; t<num_ts; t++)
+                for(size_t s=0; s<num_ts && !coupled; s++)
                 {
-                    for(size_t o=0; o<num_obs; o++)
+                    double norm = sqrt(fabs(correlation(t,i,t,i)*correlation(s,j,s,j)));
+                    coupled = fabs(correlation(t,i,s,j)) > tolerance*norm;
+                }
+            }
+            if(coupled)
+            {
+                root[find_root(j)] = find_root(i);
+            }
+        }
+    }
+
+    vector<vector<size_t>> blocks;
+    vector<size_t> label(num_obs,num_obs);
+    for(size_t i=0; i<num_obs; i++)
+    {
+        size_t r = find_root(i);
+        if(label[r] == num_obs)
+        {
+            label[r] = blocks.size();
+            blocks.emplace_back();
+        }
+        blocks[label[r]].push_back(i);
+    }
+    return blocks;
+}
+
+void KernelMethods::writeObservableBlocks(vector<vector<size_t>> &blocks, size_t num_obs, filesystem::path out_path)
+{
+    vector<size_t> label(num_obs);
+    for(size_t b=0; b<blocks.size(); b++)
+    {
+        for(size_t i : blocks[b])
+        {
+            label[i] = b;
+        }
+    }
+    cout << "Write observable blocks: " << out_path/"observable_blocks.txt" << endl;
+    filesystem::create_directories(out_path);
+    ofstream out(out_path/"observable_blocks.txt");
+    for(size_t i=0; i<num_obs; i++)
+    {
+        out << label[i] << (i+1<num_obs ? ' ' : '\n');
+    }
+    out.close();
+}
+
+vector<vector<size_t>> KernelMethods::readObservableBlocks(filesystem::path out_path, size_t num_obs)
+{
+    ifstream in(out_path/"observable_blocks.txt");
+    vector<size_t> label;
+    size_t l;
+    while(in >> l)
+    {
+        label.push_back(l);
+    }
+    if(!in.eof() || label.size() != num_obs)
+    {
+        throw ErrorHandler::CorruptFile("KernelMethods::readObservableBlocks: Expected one block label per observable in: "+(out_path/"observable_blocks.txt").string());
+    }
+    // BLOCKS ARE ORDERED BY THEIR FIRST OBSERVABLE, WHATEVER THE LABELS ARE
+    vector<vector<size_t>> blocks;
+    vector<size_t> first_label;
+    for(size_t i=0; i<num_obs; i++)
+    {
+        size_t b = find(first_label.begin(),first_label.end(),label[i])-first_label.begin();
+        if(b == first_label.size())
+        {
+            first_label.push_back(label[i]);
+            blocks.emplace_back();
+        }
+        blocks[b].push_back(i);
+    }
+    return blocks;
+}
+
+namespace
+{
+    // CALLS func(b) FOR ALL BLOCKS b, DISTRIBUTED OVER num_threads THREADS
+    void forEachBlock(size_t num_blocks, size_t num_threads, const function<void(size_t)> &func)
+    {
+        if(num_threads == 0)
+        {
+            num_threads = max<size_t>(thread::hardware_concurrency(),1);
+        }
+        num_threads = min(num_threads,num_blocks);
+        atomic<size_t> next_block(0);
+        auto worker = [&]()
+        {
+            for(size_t b=next_block++; b<num_blocks; b=next_block++)
+            {
+                func(b);
+            }
+        };
+        vector<thread> workers;
+        for(size_t n=0; n<num_threads; n++)
+        {
+            workers.emplace_back(worker);
+        }
+        for(thread &w : workers)
+        {
+            w.join();
+        }
+    }
+
+    tensor<double,4> getCorrelationBlock(tensor<double,4> &correlation, vector<size_t> &obs)
+    {
+        size_t num_ts = correlation.shape[0];
+        size_t m = obs.size();
+        tensor<double,4> block;
+        block.alloc_uninitialized({num_ts,m,num_ts,m});
+        for(size_t t=0; t<num_ts; t++)
+        {
+            for(size_t k=0; k<m; k++)
+            {
+                for(size_t s=0; s<num_ts; s++)
+                {
+                    for(size_t l=0; l<m; l++)
+                    {
+                        block(t,k,s,l) = correlation(t,obs[k],s,obs[l]);
+                    }
+                }
+            }
+        }
+        return block;
+    }
+
+    tensor<double,4> getCorrelationBandBlock(tensor<double,4> &correlation, vector<size_t> &obs)
+    {
+        size_t num_ts = correlation.shape[0];
+        size_t width = correlation.shape[1]-1;
+        size_t m = obs.size();
+        tensor<double,4> block;
+        block.alloc_uninitialized({num_ts,width+1,m,m});
+        for(size_t t=0; t<num_ts; t++)
+        {
+            for(size_t d=0; d<=width; d++)
+            {
+                for(size_t k=0; k<m; k++)
+                {
+                    for(size_t l=0; l<m; l++)
                     {
-                        simulated_trajectory(t,o) += mean_initial_value[o];
+                        block(t,d,k,l) = correlation(t,d,obs[k],obs[l]);
                     }
                 }
             }
-            simulated_trajectory >> sim(n);
-            rand_ff_n >> rand_ff(n);
         }
+        return block;
     }
-    cout << "Write random fluctuating forces: "<<  (out_path/"SIM")/"rand_ff.f64" << endl;
-    rand_ff.write("rand_ff.f64",out_path/"SIM");
-    return sim;
 }
 
+tensor<double,3> KernelMethods::getDecoupledDrift(
+    tensor<double,4> &correlation,
+    double dt,
+    vector<vector<size_t>> &blocks,
+    size_t num_threads)
+{
+    size_t num_ts = correlation.shape[0];
+    size_t num_obs = correlation.shape[1];
+    tensor<double,3> drift({num_ts,num_obs,num_obs},0.0);
+    // THE BLOCKS WRITE DISJOINT COMPONENTS
+    forEachBlock(blocks.size(),num_threads,[&](size_t b)
+    {
+        vector<size_t> &obs = blocks[b];
+        tensor<double,4> corr_block = getCorrelationBlock(correlation,obs);
+        tensor<double,3> drift_block = getDrift(corr_block,dt);
+        for(size_t t=0; t<num_ts; t++)
+        {
+            for(size_t k=0; k<obs.size(); k++)
+            {
+                for(size_t l=0; l<obs.size(); l++)
+                {
+                    drift(t,obs[k],obs[l]) = drift_block(t,k,l);
+                }
+            }
+        }
+    });
+    return drift;
+}
+
+tensor<double,4> KernelMethods::getDecoupledMemoryKernel(
+    tensor<double,4> &correlation,
+    double dt,
+    vector<vector<size_t>> &blocks,
+    size_t num_threads)
+{
+    size_t num_ts = correlation.shape[0];
+    size_t num_obs = correlation.shape[1];
+    tensor<double,4> kernel({num_ts,num_obs,num_ts,num_obs},0.0);
+    forEachBlock(blocks.size(),num_threads,[&](size_t b)
+    {
+        vector<size_t> &obs = blocks[b];
+        size_t m = obs.size();
+        tensor<double,4> corr_block = getCorrelationBlock(correlation,obs);
+        tensor<double,4> kernel_block;
+        kernel_block.alloc_uninitialized({num_ts,m,num_ts,m});
+        gsl_matrix_view kernel_mat = GslAdapter::matrix(kernel_block);
+        gsl_matrix_view corr_mat = GslAdapter::matrix(corr_block);  // corr_block is destroyed
+        getMemoryKernel(&kernel_mat.matrix,&corr_mat.matrix,num_ts,m,dt);
+        for(size_t t=0; t<num_ts; t++)
+        {
+            for(size_t k=0; k<m; k++)
+            {
+                for(size_t s=0; s<num_ts; s++)
+                {
+                    for(size_t l=0; l<m; l++)
+                    {
+                        kernel(t,obs[k],s,obs[l]) = kernel_block(t,k,s,l);
+                    }
+                }
+            }
+        }
+    });
+    return kernel;
+}
+
+tensor<double,3> KernelMethods::getDecoupledBandedDrift(
+    tensor<double,4> &correlation,
+    double dt,
+    vector<vector<size_t>> &blocks,
+    size_t num_threads)
+{
+    size_t num_ts = correlation.shape[0];
+    size_t num_obs = correlation.shape[2];
+    tensor<double,3> drift({num_ts,num_obs,num_obs},0.0);
+    forEachBlock(blocks.size(),num_threads,[&](size_t b)
+    {
+        vector<size_t> &obs = blocks[b];
+        tensor<double,4> corr_block = getCorrelationBandBlock(correlation,obs);
+        tensor<double,3> drift_block = getBandedDrift(corr_block,dt);
+        for(size_t t=0; t<num_ts; t++)
+        {
+            for(size_t k=0; k<obs.size(); k++)
+            {
+                for(size_t l=0; l<obs.size(); l++)
+                {
+                    drift(t,obs[k],obs[l]) = drift_block(t,k,l);
+                }
+            }
+        }
+    });
+    return drift;
+}
+
+tensor<double,4> KernelMethods::getDecoupledBandedMemoryKernel(
+    tensor<double,4> &correlation,
+    double dt,
+    size_t memory_horizon,
+    vector<vector<size_t>> &blocks,
+    size_t num_threads)
+{
+    size_t num_ts = correlation.shape[0];
+    size_t num_obs = correlation.shape[2];
+    tensor<double,4> kernel({num_ts,memory_horizon+1,num_obs,num_obs},0.0);
+    forEachBlock(blocks.size(),num_threads,[&](size_t b)
+    {
+        vector<size_t> &obs = blocks[b];
+        tensor<double,4> corr_block = getCorrelationBandBlock(correlation,obs);
+        tensor<double,4> kernel_block = getBandedMemoryKernel(corr_block,dt,memory_horizon);
+        for(size_t t=0; t<num_ts; t++)
+        {
+            for(size_t d=0; d<=memory_horizon; d++)
+            {
+                for(size_t k=0; k<obs.size(); k++)
+                {
+                    for(size_t l=0; l<obs.size(); l++)
+                    {
+                        kernel(t,d,obs[k],obs[l]) = kernel_block(t,d,k,l);
+                    }
+                }
+            }
+        }
+    });
+    return kernel;
+}
+
+void KernelMethods::writeSimulationChunk(
+    tensor<double,3> &sim,
+    tensor<double,3> &rand_ff,
+    tensor<double,1> &times,
+    size_t first,
+    filesystem::path out_path,
+    bool txt_out,
+    size_t num_rand_ff)
+{
+    sim.append("traj.f64",out_path/"SIM");
+    if(num_rand_ff>=rand_ff.shape[0])
+    {
+        rand_ff.append("rand_ff.f64",out_path/"SIM");
+    }
+    else if(num_rand_ff>0)
+    {
+        tensor<double,3> rand_ff_subset;
+        rand_ff_subset = tensor_view<double>(rand_ff).range(0,0,num_rand_ff).copy();
+        rand_ff_subset.append("rand_ff.f64",out_path/"SIM");
+    }
+    if(txt_out)
+    {
+        for(size_t n=0;n<sim.shape[0];n++)
+        {
+            InputOutput::write(times,tensor_view<double>(sim).slice({n}),(out_path/"SIM")/("sim_"+to_string(first+n)+".txt"));
+        }
+    }
+}
+
+void KernelMethods::simulateTrajectories(
+    tensor<double,3> &traj,
+    tensor<double,3> &drift,
+    tensor<double,4> &kernel,
+    tensor<double,1> &mean_initial_value,
+    RandomForceGenerator &rfg,
+    tensor<double,1> &times,
+    bool shift,
+    bool gaussian_init_val,
+    bool darboux_sum,
+    size_t num_sim,
+    filesystem::path out_path,
+    bool txt_out,
+    size_t chunk_size,
+    int rand_ff_out,
+    bool rand_ff_stats,
+    bool sim_correlation,
+    size_t memory_horizon,
+    HierarchicalKernel *hkernel,
+    bool banded)
+{
+    size_t num_traj = traj.shape[0];
+    size_t num_ts = times.shape[0];
+    size_t num_obs = traj.shape[2];
+    double dt = times[1]-times[0];
+
+    if(gaussian_init_val)
+    {
+        traj.clear();
+    }
+    if(chunk_size==0 || chunk_size>num_sim)
+    {
+        chunk_size = num_sim;
+    }
+
+    filesystem::create_directories(out_path/"SIM");
+    filesystem::remove((out_path/"SIM")/"traj.f64");
+    filesystem::remove((out_path/"SIM")/"rand_ff.f64");
+    cout << "Write simulated trajectories: " << (out_path/"SIM")/"traj.f64" << endl;
+    if(rand_ff_out!=0)
+    {
+        cout << "Write random fluctuating forces: " << (out_path/"SIM")/"rand_ff.f64" << endl;
+    }
+    tensor<double,2> ff_sum;
+    tensor<double,4> ff_sum_outer;
+    tensor<double,2> sim_sum;
+    tensor<double,4> sim_sum_outer;
+
+    if(darboux_sum && hkernel == nullptr)
+    {
+        kernel=kernel.transpose({0,1,3,2});
+    }
+    if(!darboux_sum && hkernel != nullptr)
+    {
+        kernel = hkernel->dense();
+    }
+    // A BANDED KERNEL HOLDS K(t,s) AT (t,memory_horizon+s-t)
+    banded = banded && hkernel == nullptr;
+    if(banded)
+    {
+        memory_horizon = kernel.shape[1]-1;
+    }
+    for(size_t first=0; first<num_sim; first+=chunk_size)
+    {
+        size_t num_chunk = min(chunk_size,num_sim-first);
+        tensor<double,3> sim;
+        tensor<double,3> rand_ff({num_chunk,num_ts,num_obs});
+        if(darboux_sum)
+        {
+            tensor<double,2> rand_ff_buffer;
+            sim.alloc({num_ts,num_obs,num_chunk});
+            for(size_t n=0;n<num_chunk; n++)
+            {
+                rand_ff_buffer = rfg.pull_multivariate_gaussian();
+                if(!gaussian_init_val)
+                {
+                    for(size_t i=0; i<num_obs; i++)
+                    {
+                        sim(0,i,n) = traj((first+n)%num_traj,0,i); // set initial value
+                    }
+                    memcpy(&rand_ff(n),&rand_ff_buffer[0],num_ts*num_obs*sizeof(double));
+                }
+                else
+                {
+                    for(size_t i=0; i<num_obs; i++)
+                    {
+                        sim(0,i,n) = rand_ff_buffer(0,i); // set initial value
+                    }
+                    memcpy(&rand_ff(n),&rand_ff_buffer(1),num_ts*num_obs*sizeof(double));
+                }
+            }
+            gsl_matrix * out = gsl_matrix_alloc(num_obs,num_chunk);
+            tensor<double,2> buff({num_obs,num_chunk},0.0);
+            tensor<double,3> history;
+            if(hkernel != nullptr)
+            {
+                history.alloc({num_ts,num_obs,num_chunk},0.0);
+            }
+            for(size_t t=0;t+1<num_ts;t++)
+            {
+                if(t>0)
+                {
+                    if(hkernel != nullptr)
+                    {
+                        gsl_matrix_const_view trajectory = GslAdapter::const_matrix(sim,num_ts*num_obs,num_chunk);
+                        gsl_matrix_view history_mat = GslAdapter::matrix(history,num_ts*num_obs,num_chunk);
+                        hkernel->step(t,&trajectory.matrix,&history_mat.matrix);
+                        buff << history(t);
+                    }
+                    else
+                    {
+                        size_t t0 = memory_horizon>0 && t>memory_horizon ? t-memory_horizon : 0;
+                        gsl_matrix_const_view kernel_t1 = gsl_matrix_const_view_array(&kernel(t,banded ? memory_horizon+t0-t : t0),(t-t0)*num_obs,num_obs);
+                        gsl_matrix_const_view trajectory = gsl_matrix_const_view_array(&sim(t0),(t-t0)*num_obs,num_chunk);
+                        gsl_blas_dgemm(CblasTrans,CblasNoTrans,1.0,&kernel_t1.matrix,&trajectory.matrix,0.0,out);
+                        buff << *out->data;
+                    }
+                }
+                buff*=dt;
+                for(size_t n=0;n<num_chunk;n++)
+                {
+                    for(size_t i = 0; i<num_obs; i++)
+                    {
+                        for(size_t k = 0; k<num_obs; k++)
+                        {
+                            buff(i,n) += drift(t,i,k)*sim(t,k,n);
+                        }
+                        buff(i,n) += rand_ff(n,t,i);
+                    }
+                    for(size_t i=0;i<num_obs;i++)
+                    {
+                        sim(t+1,i,n) = sim(t,i,n)+dt*buff(i,n);
+                    }
+                }
+            }
+            gsl_matrix_free(out);
+            if(shift)
+            {
+                for(size_t n=0;n<num_chunk; n++)
+                {
+                    for(size_t t=0; t<num_ts; t++)
+                    {
+                        for(size_t o=0; o<num_obs; o++)
+                        {
+                            sim(t,o,n) += mean_initial_value[o];
+                        }
+                    }
+                }
+            }
+            sim=sim.transpose({2,0,1});
+        }
+        else
+        {
+            tensor<double,2> rand_ff_buffer;
+            tensor<double,2> rand_ff_n({num_ts,num_obs});
+            tensor<double,2> simulated_trajectory({num_ts,num_obs});
+            RK4 rk4(memory_horizon,nullptr,banded);
+            sim.alloc({num_chunk,num_ts,num_obs});
+            for(size_t n=0;n<num_chunk; n++)
+            {
+
+                rand_ff_buffer = rfg.pull_multivariate_gaussian();
+
+                if(!gaussian_init_val)
+                {
+                    for(size_t i=0; i<num_obs; i++)
+                    {
+                        simulated_trajectory(0,i) = traj((first+n)%num_traj,0,i); // set initial value
+                    }
+                    rand_ff_n = std::move(rand_ff_buffer);
+                }
+                else
+                {
+                    for(size_t i=0; i<num_obs; i++)
+                    {
+                        simulated_trajectory(0,i) = rand_ff_buffer(0,i); // set initial value
+                    }
+                    rand_ff_n << rand_ff_buffer(1);
+                }
+
+                rk4.integrate(dt,drift,kernel,simulated_trajectory,rand_ff_n);
+
+                if(shift)
+                {
+                    for(size_t t=0; t<num_ts; t++)
+                    {
+                        for(size_t o=0; o<num_obs; o++)
+                        {
+                            simulated_trajectory(t,o) += mean_initial_value[o];
+                        }
+                    }
+                }
+                simulated_trajectory >> sim(n);
+                rand_ff_n >> rand_ff(n);
+            }
+        }
+        if(rand_ff_stats)
+        {
+            accumulateMoments(rand_ff,ff_sum,ff_sum_outer);
+        }
+        if(sim_correlation)
+        {
+            accumulateMoments(sim,sim_sum,sim_sum_outer);
+        }
+        size_t num_rand_ff = num_chunk;
+        if(rand_ff_out>=0)
+        {
+            num_rand_ff = first<(size_t)rand_ff_out ? min(num_chunk,rand_ff_out-first) : 0;
+        }
+        writeSimulationChunk(sim,rand_ff,times,first,out_path,txt_out,num_rand_ff);
+        cout << "Simulated trajectories: " << first+num_chunk << "/" << num_sim << endl;
+    }
+    if(rand_ff_stats && num_sim>1)
+    {
+        tensor<double,2> ff_average = ff_sum;
+        ff_average *= 1.0/num_sim;
+        cout << "Write mean values of drawn fluctuating forces: " << (out_path/"SIM")/"ff_average.f64" << endl;
+        ff_average.write("ff_average.f64",out_path/"SIM");
+        tensor<double,4> ff_cov = getCorrelationFromMoments(ff_sum,ff_sum_outer,num_sim,ff_average,true);
+        cout << "Write covariance matrix of drawn fluctuating forces: " << (out_path/"SIM")/"ff_cov.f64" << endl;
+        ff_cov.write("ff_cov.f64",out_path/"SIM");
+    }
+    if(sim_correlation && num_sim>0)
+    {
+        writeEnsembleCorrelation(sim_sum,sim_sum_outer,num_sim,times,out_path/"SIM",shift,txt_out,false);
+    }
+}
+
+void KernelMethods::simulateTrajectories(
+    tensor<double,3> &traj,
+    tensor<double,2> &drift,
+    tensor<double,3> &kernel,
+    tensor<double,1> &mean_initial_value,
+    RandomForceGenerator &rfg,
+    tensor<double,1> &times,
+    bool shift,
+    bool gaussian_init_val,
+    bool darboux_sum,
+    size_t num_sim,
+    filesystem::path out_path,
+    bool accelerate_stationary_decomp,
+    bool txt_out,
+    size_t chunk_size,
+    int rand_ff_out,
+    bool rand_ff_stats,
+    bool sim_correlation,
+    size_t memory_horizon,
+    MarkovianEmbedding *embedding)
+{
+    size_t num_traj = traj.shape[0];
+    size_t num_ts = times.shape[0];
+    size_t num_obs = traj.shape[2];
+    double dt = times[1]-times[0];
+
+    if(gaussian_init_val)
+    {
+        traj.clear();
+    }
+    if(chunk_size==0 || chunk_size>num_sim)
+    {
+        chunk_size = num_sim;
+    }
+
+    filesystem::create_directories(out_path/"SIM");
+    filesystem::remove((out_path/"SIM")/"traj.f64");
+    filesystem::remove((out_path/"SIM")/"rand_ff.f64");
+    cout << "Write simulated trajectories: " << (out_path/"SIM")/"traj.f64" << endl;
+    if(rand_ff_out!=0)
+    {
+        cout << "Write random fluctuating forces: " << (out_path/"SIM")/"rand_ff.f64" << endl;
+    }
+    tensor<double,2> ff_sum;
+    tensor<double,4> ff_sum_outer;
+    tensor<double,2> sim_sum;
+    tensor<double,4> sim_sum_outer;
+
+    if(darboux_sum && embedding == nullptr)
+    {
+        tensor<double,3> kernel_buffer;
+        kernel_buffer.alloc_uninitialized(kernel.shape);
+        for(size_t t=0; t<kernel.shape[0]; t++)
+        {
+            for(size_t i=0;i<kernel.shape[1];i++)
+            {
+                for(size_t j=0;j<kernel.shape[2];j++)
+                {
+                    kernel_buffer(kernel.shape[0]-1-t,i,j) = kernel(t,i,j);
+                }
+            }
+        }
+        kernel = std::move(kernel_buffer);
+        kernel=kernel.transpose({0,2,1}); //kernel=kernel.transpose({0,1,3,2});
+    }
+    for(size_t first=0; first<num_sim; first+=chunk_size)
+    {
+        size_t num_chunk = min(chunk_size,num_sim-first);
+        tensor<double,3> sim;
+        tensor<double,3> rand_ff({num_chunk,num_ts,num_obs});
+        if(darboux_sum)
+        {
+            tensor<double,2> rand_ff_buffer;
+            sim.alloc({num_ts,num_obs,num_chunk});
+            for(size_t n=0;n<num_chunk; n++)
+            {
+                if(!gaussian_init_val)
+                {
+                    if(accelerate_stationary_decomp)
+                    {
+                        rand_ff_buffer = rfg.pull_stationary_multivariate_gaussian();
+                    }
+                    else
+                    {
+                        rand_ff_buffer = rfg.pull_multivariate_gaussian();
+                    }
+                    for(size_t i=0; i<num_obs; i++)
+                    {
+                        sim(0,i,n) = traj((first+n)%num_traj,0,i); // set initial value
+                    }
+                    memcpy(&rand_ff(n),&rand_ff_buffer[0],num_ts*num_obs*sizeof(double));
+                }
+                else
+                {
+                    rand_ff_buffer = rfg.pull_multivariate_gaussian();
+                    for(size_t i=0; i<num_obs; i++)
+                    {
+                        sim(0,i,n) = rand_ff_buffer(0,i); // set initial value
+                    }
+                    memcpy(&rand_ff(n),&rand_ff_buffer(1),num_ts*num_obs*sizeof(double));
+                }
+            }
+            gsl_matrix * out = gsl_matrix_alloc(num_obs,num_chunk);
+            tensor<double,2> buff({num_obs,num_chunk},0.0);
+            tensor<double,2> aux;
+            if(embedding != nullptr)
+            {
+                aux.alloc({embedding->order(),num_chunk},0.0);
+            }
+            for(size_t t=0;t+1<num_ts;t++)
+            {
+                if(t>0)
+                {
+                    if(embedding != nullptr)
+                    {
+                        gsl_matrix_view z = GslAdapter::matrix(aux,embedding->order(),num_chunk);
+                        embedding->memory(&z.matrix,out);
+                    }
+                    else
+                    {
+                        size_t t0 = memory_horizon>0 && t>memory_horizon ? t-memory_horizon : 0;
+                        gsl_matrix_const_view kernel_t1 = gsl_matrix_const_view_array(&kernel( (kernel.shape[0]+1)/2-1 -t+t0 ),(t-t0)*num_obs,num_obs);
+                        gsl_matrix_const_view trajectory = gsl_matrix_const_view_array(&sim(t0),(t-t0)*num_obs,num_chunk);
+                        gsl_blas_dgemm(CblasTrans,CblasNoTrans,1.0,&kernel_t1.matrix,&trajectory.matrix,0.0,out);
+                    }
+                    buff << *out->data;
+                }
+                if(embedding != nullptr)
+                {
+                    gsl_matrix_view z = GslAdapter::matrix(aux,embedding->order(),num_chunk);
+                    gsl_matrix_const_view x_t = gsl_matrix_const_view_array(&sim(t),num_obs,num_chunk);
+                    embedding->propagate(&z.matrix,&x_t.matrix);
+                }
+                buff*=dt;
+                for(size_t n=0;n<num_chunk;n++)
+                {
+                    for(size_t i = 0; i<num_obs; i++)
+                    {
+                        for(size_t k = 0; k<num_obs; k++)
+                        {
+                            buff(i,n) += drift(i,k)*sim(t,k,n);
+                        }
+                        buff(i,n) += rand_ff(n,t,i);
+                    }
+                    for(size_t i=0;i<num_obs;i++)
+                    {
+                        sim(t+1,i,n) = sim(t,i,n)+dt*buff(i,n);
+                    }
+                }
+            }
+            gsl_matrix_free(out);
+            if(shift)
+            {
+                for(size_t n=0;n<num_chunk; n++)
+                {
+                    for(size_t t=0; t<num_ts; t++)
+                    {
+                        for(size_t o=0; o<num_obs; o++)
+                        {
+                            sim(t,o,n) += mean_initial_value[o];
+                        }
+                    }
+                }
+            }
+            sim=sim.transpose({2,0,1});
+        }
+        else
+        {
+            tensor<double,2> rand_ff_buffer;
+            tensor<double,2> rand_ff_n({num_ts,num_obs});
+            tensor<double,2> simulated_trajectory({num_ts,num_obs});
+            RK4 rk4(memory_horizon,embedding);
+            sim.alloc({num_chunk,num_ts,num_obs});
+            for(size_t n=0;n<num_chunk; n++)
+            {
+                if(!gaussian_init_val)
+                {
+                    if(accelerate_stationary_decomp)
+                    {
+                        rand_ff_buffer = rfg.pull_stationary_multivariate_gaussian();
+                    }
+                    else
+                    {
+                        rand_ff_buffer = rfg.pull_multivariate_gaussian();
+                    }
+                    for(size_t i=0; i<num_obs; i++)
+                    {
+                        simulated_trajectory(0,i) = traj((first+n)%num_traj,0,i); // set initial value
+                    }
+                    rand_ff_n = std::move(rand_ff_buffer);
+                }
+                else
+                {
+                    rand_ff_buffer = rfg.pull_multivariate_gaussian();
+                    for(size_t i=0; i<num_obs; i++)
+                    {
+                        simulated_trajectory(0,i) = rand_ff_buffer(0,i); // set initial value
+                    }
+                    rand_ff_n << rand_ff_buffer(1);
+                }
+
+                rk4.integrate(dt,drift,kernel,simulated_trajectory,rand_ff_n);
+
+                if(shift)
+                {
+                    for(size_t t=0; t<num_ts; t++)
+                    {
+                        for(size_t o=0; o<num_obs; o++)
+                        {
+                            simulated_trajectory(t,o) += mean_initial_value[o];
+                        }
+                    }
+                }
+                simulated_trajectory >> sim(n);
+                rand_ff_n >> rand_ff(n);
+            }
+        }
+        if(rand_ff_stats)
+        {
+            accumulateMoments(rand_ff,ff_sum,ff_sum_outer);
+        }
+        if(sim_correlation)
+        {
+            accumulateMoments(sim,sim_sum,sim_sum_outer);
+        }
+        size_t num_rand_ff = num_chunk;
+        if(rand_ff_out>=0)
+        {
+            num_rand_ff = first<(size_t)rand_ff_out ? min(num_chunk,rand_ff_out-first) : 0;
+        }
+        writeSimulationChunk(sim,rand_ff,times,first,out_path,txt_out,num_rand_ff);
+        cout << "Simulated trajectories: " << first+num_chunk << "/" << num_sim << endl;
+    }
+    if(rand_ff_stats && num_sim>1)
+    {
+        tensor<double,2> ff_average = ff_sum;
+        ff_average *= 1.0/num_sim;
+        cout << "Write mean values of drawn fluctuating forces: " << (out_path/"SIM")/"ff_average.f64" << endl;
+        ff_average.write("ff_average.f64",out_path/"SIM");
+        tensor<double,4> ff_cov = getCorrelationFromMoments(ff_sum,ff_sum_outer,num_sim,ff_average,true);
+        cout << "Write covariance matrix of drawn fluctuating forces: " << (out_path/"SIM")/"ff_cov.f64" << endl;
+        ff_cov.write("ff_cov.f64",out_path/"SIM");
+    }
+    if(sim_correlation && num_sim>0)
+    {
+        writeEnsembleCorrelation(sim_sum,sim_sum_outer,num_sim,times,out_path/"SIM",shift,txt_out,true);
+    }
+}
@@ -25,6 +25,8 @@ If not, see <https://www.gnu.org/licenses/>.
 
 #include "TensorUtils.hpp"
 #include "RandomForceGenerator.hpp"
+#include "MarkovianEmbedding.hpp"
+#include "HierarchicalKernel.hpp"
 
 #include <gsl/gsl_matrix.h>
 #include <vector>
@@ -48,9 +50,33 @@ namespace KernelMethods {
 
     /*!
         \brief Returns the cross-correlation matrix of the observable `C(t,i,s,j)=E[traj(n,t,i)*traj(n,s,j)]` for all times `t` and `s`.
+
+        Only the upper triangle is computed, the result is exactly symmetric. Hence, it is stored as upper triangle
+        when written with TensorUtils::Encoding::packed.
     */
     TensorUtils::tensor<double,4> getCorrelationFunction(TensorUtils::tensor<double,3> &traj, bool unbiased=false);
 
+    /*!
+        \brief Returns the band `correlation(t,d,i,j)=C(t,i,t-width+d,j)` with `d=0,...,width` of the cross-correlation matrix,
+        see \ref getCorrelationFunction. Components with `t-width+d<0` are zero.
+
+        The components above the diagonal follow from `C(t,i,s,j)=C(s,j,t,i)`, see \ref getBandedCorrelation.
+        The costs and the memory scale with `num_ts*width` instead of `num_ts*num_ts`. `traj` is not modified.
+    */
+    TensorUtils::tensor<double,4> getBandedCorrelationFunction(TensorUtils::tensor<double,3> &traj, size_t width, bool unbiased=false);
+
+    /*!
+        \brief Returns the band of width `width` of a cross-correlation matrix `correlation(t,i,s,j)`
+        in the layout of \ref getBandedCorrelationFunction.
+    */
+    TensorUtils::tensor<double,4> getCorrelationBand(TensorUtils::tensor<double,4> &correlation, size_t width);
+
+    /*!
+        \brief Returns the component `C(t,i,s,j)` of a banded cross-correlation matrix, see \ref getBandedCorrelationFunction.
+        The lag `|t-s|` must not exceed the width of the band.
+    */
+    double getBandedCorrelation(TensorUtils::tensor<double,4> &correlation, size_t t, size_t i, size_t s, size_t j);
+
     /*!
         \brief Returns the cross-correlation matrix of a stationary process
         `C(num_ts-1+t-s,i,j)=E[traj(n,t,i)*traj(n,s,j)]` for all time differences `t-s=-(N-1),...,+(N-1)`.
@@ -64,8 +90,23 @@ namespace KernelMethods {
 
     /*!
         \brief Returns the inverse of a lower block triangular matrix.
+
+        If `leading` is given, it has to hold the inverse of a leading principal block of `src` with at least `num_leading` time steps.
+        Its components `(t,i,s,j)` with `t,s<num_leading` are reused and only the remaining time rows are computed.
+    */
+    TensorUtils::tensor<double,4> calcLowerBlockTriangularInverse(
+        TensorUtils::tensor<double,4> &src,
+        TensorUtils::tensor<double,4> const* leading=nullptr,
+        size_t num_leading=0);
+
+    /*!
+        \brief Returns the band `inverse(t,d,i,j)=L^{-1}(t,i,t-width+d,j)` of the inverse of a lower block triangular matrix `L`,
+        which is given by its band `band(t,d,i,j)=L(t,i,t-band.shape[1]+1+d,j)`.
+
+        Each row of the band is computed by forward substitution within the band.
+        Hence, the costs scale with `num_ts*width*band.shape[1]` instead of `num_ts^3`.
     */
-    TensorUtils::tensor<double,4> calcLowerBlockTriangularInverse(TensorUtils::tensor<double,4> &src);
+    TensorUtils::tensor<double,4> calcBandedLowerBlockTriangularInverse(TensorUtils::tensor<double,4> &band, size_t width);
 
     //! \private
 	void calcDiagInverts(
@@ -115,22 +156,99 @@ namespace KernelMethods {
 		gsl_matrix* J,
 		int const num_ts,
 		int const num_obs,
-		double const dt);
+		double const dt,
+		TensorUtils::tensor<double,5> *factors=nullptr);
+
+    //! \private
+    TensorUtils::tensor<double,4> calcBandedJ(
+        TensorUtils::tensor<double,4> &S0,
+        TensorUtils::tensor<double,4> &j,
+        double dt);
 
     /*!
         \brief Computes the non-stationary memory kernel for a given correlation function.
+
+        `corr` is used as an auxiliary matrix and is destroyed on exit.
+        See \ref GslAdapter to pass tensors without copying.
+
+        If `factors` is given, it stores the inverses of the lower and upper block triangular factors
+        and the integrated kernel `J(t,i,s,j)` with shape `(3,num_ts,num_obs,num_ts,num_obs)` on exit.
+        If it already holds these factors for a shorter time window with the same time step, e.g. read from `kernel_factors.f64`,
+        all but the last of the old time steps are reused and only the new time rows and columns are computed.
+        The caller has to ensure that the leading blocks of `corr` coincide with the correlation of the shorter window,
+        e.g. by \ref readKernelFactors.
+        The costs then scale with `num_ts*num_ts` times the number of new time steps instead of `num_ts*num_ts*num_ts`.
     */
 	void getMemoryKernel(
 		gsl_matrix* kernel,
 		gsl_matrix* corr,
 		size_t const num_ts,
 		size_t const num_obs,
-		double const dt);
+		double const dt,
+		TensorUtils::tensor<double,5> *factors=nullptr);
+
+    /*!
+        \brief Returns a 64-bit FNV-1a checksum of the components `correlation(t,i,s,j)` with `t,s<num_leading`.
+    */
+    uint64_t getCorrelationChecksum(TensorUtils::tensor<double,4> &correlation, size_t num_leading);
+
+    /*!
+        \brief Reads the kernel factors of \ref getMemoryKernel from `out_path/kernel_factors.f64`.
+
+        The time step and the checksum of the leading blocks of the correlation function are read from `out_path/kernel_factors.txt`.
+        The checksum covers all old time steps, since the reused blocks depend on the last one through the difference quotients.
+        Throws \ref TensorUtils::ErrorHandler::CorruptFile, if they differ from `dt` and the leading blocks of `correlation`,
+        e.g. because the trajectories or the increment have changed. Then, the factors must be computed anew.
+    */
+    void readKernelFactors(
+        TensorUtils::tensor<double,5> &factors,
+        TensorUtils::tensor<double,4> &correlation,
+        double dt,
+        std::filesystem::path out_path);
+
+    /*!
+        \brief Writes the kernel factors to `out_path/kernel_factors.f64` and `dt` and `checksum` to `out_path/kernel_factors.txt`.
+
+        `checksum` has to be computed by \ref getCorrelationChecksum for `num_leading=num_ts`, before the correlation function is destroyed.
+    */
+    void writeKernelFactors(
+        TensorUtils::tensor<double,5> &factors,
+        uint64_t checksum,
+        double dt,
+        std::filesystem::path out_path);
     /*!
         \brief Computes the stationary memory kernel for a given correlation function.
     */
     TensorUtils::tensor<double,3> getMemoryKernel(TensorUtils::tensor<double,3> &correlation, double dt);
 
+    /*!
+        \brief Sets the dense memory kernel `kernel(t,i,s,j)` to zero for `t-s>memory_horizon`. Does nothing if `memory_horizon` is zero.
+
+        For memory kernels, which decay to noise after a finite lag, this removes the noise.
+        \ref getFluctuatingForce and \ref simulateTrajectories restrict the memory integrals to the same band for a given `memory_horizon`.
+        Hence, their costs scale with `num_ts*memory_horizon` instead of `num_ts*num_ts`.
+        To avoid the dense correlation function and kernel altogether, see \ref getBandedMemoryKernel.
+    */
+    void applyMemoryHorizon(TensorUtils::tensor<double,4> &kernel, size_t memory_horizon);
+
+    /*!
+        \brief Overloaded function for the stationary case. Sets `kernel(num_ts-1+tau,i,j)` to zero for `|tau|>memory_horizon`.
+    */
+    void applyMemoryHorizon(TensorUtils::tensor<double,3> &kernel, size_t memory_horizon);
+
+    /*!
+        \brief Computes the band `kernel(t,d,i,j)=K(t,i,t-memory_horizon+d,j)` with `d=0,...,memory_horizon`
+        of the non-stationary memory kernel from the band of the correlation function, see \ref getBandedCorrelationFunction.
+
+        The band of the correlation function must have a width of at least `memory_horizon+2`.
+        Within the band, the result coincides with \ref getMemoryKernel, since the derivatives couple neighboring time steps only
+        and the band of the inverse block triangular factors follows from the band of the factors, see \ref calcBandedLowerBlockTriangularInverse.
+        The costs scale with `num_ts*memory_horizon^2` and the memory with `num_ts*memory_horizon` instead of `num_ts^3` and `num_ts^2`.
+        \ref getFluctuatingForce, \ref simulateTrajectories and \ref RK4 accept the band, if `banded` is true.
+        For `memory_horizon>=num_ts-1` the band is not narrower than the dense kernel, use \ref getMemoryKernel instead.
+    */
+    TensorUtils::tensor<double,4> getBandedMemoryKernel(TensorUtils::tensor<double,4> &correlation, double dt, size_t memory_horizon);
+
     /*!
         \brief Computes the derivative of all trajectories using the symmetric difference quotient.
 
@@ -139,11 +257,12 @@ namespace KernelMethods {
     TensorUtils::tensor<double,3> diffTrajectories(TensorUtils::tensor<double,3> &trajectories, double dt, bool darboux_sum);
 
     /*!
-        \brief Block-wise matrix inversion.
+        \brief Block-wise matrix inversion. If `symmetric` is true, the blocks are assumed to be symmetric positive definite.
 
+        See \ref BatchedMatrices::invert.
         \return Returns a tensor defined by `return_val(n,:,:)=mat(n,:,:)^{-1}`.
     */
-    TensorUtils::tensor<double,3> matInverse(TensorUtils::tensor<double,3> &mat);
+    TensorUtils::tensor<double,3> matInverse(TensorUtils::tensor<double,3> &mat, bool symmetric=false);
 
     /*!
         \brief Differentiate with respect to the first index using the symmetric difference quotient.
@@ -156,6 +275,11 @@ namespace KernelMethods {
     */
     TensorUtils::tensor<double,3> getDrift(TensorUtils::tensor<double,4> &correlation, double dt);
 
+    /*!
+        \brief Returns the drift term for a given banded non-stationary correlation function, see \ref getBandedCorrelationFunction.
+    */
+    TensorUtils::tensor<double,3> getBandedDrift(TensorUtils::tensor<double,4> &correlation, double dt);
+
     /*!
         \brief Returns the drift term for a given stationary correlation function.
     */
@@ -164,13 +288,29 @@ namespace KernelMethods {
 
     /*!
         \brief Returns the fluctuating forces for each trajectory for the non-stationary case.
+
+        If `memory_horizon` is positive, the memory integral is restricted to the last `memory_horizon` time steps,
+        see \ref applyMemoryHorizon.
+        If `banded` is true, `kernel` holds the band of \ref getBandedMemoryKernel and its width replaces `memory_horizon`.
+        If `hkernel` is not a null pointer, the compressed kernel is used instead of `kernel`, which may be empty.
+        The lower Darboux sum is then evaluated by \ref HierarchicalKernel::multiply and `memory_horizon` has no effect.
+        The Simpson rule requires the dense kernel, which is restored by \ref HierarchicalKernel::dense.
+
+        Otherwise, the memory integral of each time step is a matrix product of the kernel row with all trajectories.
+        For the Simpson rule, the quadrature weights are multiplied into the kernel row beforehand.
+        The time steps are distributed over `num_threads` threads, or all hardware threads if `num_threads` is zero.
+        `kernel` is transposed and weighted in place.
     */
     TensorUtils::tensor<double,3> getFluctuatingForce(
         TensorUtils::tensor<double,4> &kernel,
         TensorUtils::tensor<double,3> &drift,
         TensorUtils::tensor<double,3> &trajectories,
         TensorUtils::tensor<double,1> &times,
-        bool darboux_sum);
+        bool darboux_sum,
+        size_t memory_horizon=0,
+        HierarchicalKernel *hkernel=nullptr,
+        size_t num_threads=0,
+        bool banded=false);
 
     /*!
         \brief Returns the fluctuating forces for each trajectory for the stationary case.
@@ -180,7 +320,8 @@ namespace KernelMethods {
         TensorUtils::tensor<double,2> &drift,
         TensorUtils::tensor<double,3> &trajectories,
         TensorUtils::tensor<double,1> &times,
-        bool darboux_sum);
+        bool darboux_sum,
+        size_t memory_horizon=0);
 
     /*!
         \brief Computes the average and covariance matrix of the fluctuating forces as required from
@@ -188,8 +329,9 @@ namespace KernelMethods {
 
         The average fluctuating forces are written to `out_path/ff_average.f64`.
         The covariance matrix is written to `out_path/ff_cov.f64` or `out_path/ff_cov_stationary.f64` in the stationary case.
+        The non-stationary covariance matrix is written with the given `encoding`.
     */
-    void writeCovarianceMatrix(TensorUtils::tensor<double,3> &ff, std::filesystem::path out_path, bool stationary=false);
+    void writeCovarianceMatrix(TensorUtils::tensor<double,3> &ff, std::filesystem::path out_path, bool stationary=false, TensorUtils::Encoding encoding=TensorUtils::Encoding::raw);
 
     /*!
         \brief Computes the average and covariance matrix of the initial values and fluctuating forces as required from
@@ -199,41 +341,264 @@ namespace KernelMethods {
         The covariance matrix of initial values and fluctuating forces is written to `out_path/ff_cov.f64`.
         In the stationary case, the covariance matrix of the fluctuating forces is written to `out_path/ff_cov_stationary.f64`
         and the covariance between the initial values and fluctuating forces is written to `out_path/ff_cov_extended.f64`.
+        Only the initial values `traj(n,0,i)` are used, hence `traj` may contain the first time step only.
+        The non-stationary covariance matrix is written with the given `encoding`.
+    */
+    void writeExtendedCovarianceMatrix(TensorUtils::tensor<double,3> &traj, TensorUtils::tensor<double,3> &ff, std::filesystem::path out_path, bool stationary=false, TensorUtils::Encoding encoding=TensorUtils::Encoding::raw);
+
+    /*!
+        \brief Computes the average and the band of width `width` of the non-stationary covariance matrix of the fluctuating forces
+        as required from \ref RandomForceGenerator::init_banded_cov.
+
+        The average is written to `out_path/ff_average.f64` and the band to `out_path/ff_cov_banded.f64`
+        in the layout of \ref getBandedCorrelationFunction.
+        The fluctuating forces are assumed to be uncorrelated beyond the memory horizon `width`, like the memory kernel.
+        If `traj` is not a null pointer, its initial values `traj(n,0,i)` are prepended as an additional first time step,
+        see \ref writeExtendedCovarianceMatrix.
     */
-    void writeExtendedCovarianceMatrix(TensorUtils::tensor<double,3> &traj, TensorUtils::tensor<double,3> &ff, std::filesystem::path out_path, bool stationary=false);
+    void writeBandedCovarianceMatrix(TensorUtils::tensor<double,3> &ff, size_t width, std::filesystem::path out_path, TensorUtils::tensor<double,3> *traj=nullptr);
+
+    /*!
+        \brief Adds the sum over all samples \f$ \sum_n x_n(t,i) \f$ to `sum` and the sum over all outer products
+        \f$ \sum_n x_n(t,i) x_n(s,j) \f$ to `sum_outer`, where \f$ x_n \f$ = `samples(n)`. Both sums are multiplied by `alpha`,
+        e.g. `alpha=-1` removes samples, which were added before.
+
+        Empty accumulators are allocated and initialized with zero.
+        Only the lower triangle of `sum_outer` (as a matrix of shape `{num_ts*num_obs,num_ts*num_obs}`) is updated,
+        see \ref getCorrelationFromMoments.
+    */
+    void accumulateMoments(
+        TensorUtils::tensor<double,3> &samples,
+        TensorUtils::tensor<double,2> &sum,
+        TensorUtils::tensor<double,4> &sum_outer,
+        double alpha=1.0);
+
+    /*!
+        \brief Returns the correlation function \f$ \langle (x(t,i)-c(t,i)) (x(s,j)-c(s,j)) \rangle \f$
+        from the moments accumulated by \ref accumulateMoments, where \f$ c \f$ = `offset`.
+
+        If `offset` is the average `sum/num_samples` and `unbiased` is true, this is the (unbiased) covariance matrix.
+    */
+    TensorUtils::tensor<double,4> getCorrelationFromMoments(
+        TensorUtils::tensor<double,2> &sum,
+        TensorUtils::tensor<double,4> &sum_outer,
+        size_t num_samples,
+        TensorUtils::tensor<double,2> &offset,
+        bool unbiased=false);
+
+    /*!
+        \brief Averages the two-time correlation function `correlation(t,i,s,j)` over all pairs of times with equal lag \f$ t-s \f$.
+
+        Returns the stationary correlation function of shape `{2*num_ts-1,num_obs,num_obs}` as obtained from \ref getStationaryCorrelation.
+    */
+    TensorUtils::tensor<double,3> averageStationaryCorrelation(TensorUtils::tensor<double,4> &correlation);
+
+    /*!
+        \brief Writes the correlation function of an ensemble of trajectories from the moments accumulated by \ref accumulateMoments.
+
+        If `shift` is true, the average initial value is subtracted and written to `out_path/mean_initial_value.f64`.
+        The correlation function is written to `out_path/correlation.f64`, or `out_path/correlation_stationary.f64` in the stationary case.
+        Together with `out_path/times.f64`, the output can be processed by `main_kernel` with `<out_folder>` set to `out_path`.
+    */
+    void writeEnsembleCorrelation(
+        TensorUtils::tensor<double,2> &sum,
+        TensorUtils::tensor<double,4> &sum_outer,
+        size_t num_samples,
+        TensorUtils::tensor<double,1> &times,
+        std::filesystem::path out_path,
+        bool shift,
+        bool txt_out,
+        bool stationary);
+
+    /*!
+        \brief Estimates the statistical errors of the non-stationary correlation function, drift term and memory kernel
+        by resampling blocks of trajectories.
+
+        The trajectories are split into `num_blocks` contiguous blocks, whose moments are accumulated once by \ref accumulateMoments.
+        If `num_replicas` is zero, there are `num_blocks` jackknife replicas, each leaving out one block.
+        Otherwise, each of the `num_replicas` bootstrap replicas draws `num_blocks` blocks with replacement.
+        A replica only sums the moments of its blocks, before its drift term and memory kernel are computed.
+        The replicas are distributed over `num_threads` threads, or all hardware threads if `num_threads` is zero.
+        Each thread holds about seven matrices of the size of the correlation function.
+        At least two trajectories are required.
+
+        The mean and the error of the replicas are written to `out_path/<name>_resampling_mean.f64` and `out_path/<name>_resampling_error.f64`
+        for `<name>` = `correlation`, `drift` and `kernel`, with the same layouts as `correlation.f64`, `drift.f64` and `kernel.f64`.
+        `memory_horizon` is applied to the kernels as in \ref applyMemoryHorizon.
+
+        If `banded` is true, the blocks and replicas hold the band of width `memory_horizon+2` of the correlation function only,
+        and the drift term and the band of the kernel are computed by \ref getBandedDrift and \ref getBandedMemoryKernel.
+        The outputs are then named `correlation_banded`, `drift` and `kernel_banded` with the layouts of
+        `correlation_banded.f64`, `drift.f64` and `kernel_banded.f64`, and only the drift term is written in text format.
+    */
+    void writeResamplingErrors(
+        TensorUtils::tensor<double,3> &traj,
+        TensorUtils::tensor<double,1> &times,
+        size_t num_blocks,
+        size_t num_replicas,
+        size_t num_threads,
+        size_t memory_horizon,
+        std::filesystem::path out_path,
+        bool txt_out,
+        bool banded=false);
+
+    /*!
+        \brief Returns the observable blocks, which are uncorrelated with each other.
+
+        Two observables `i` and `j` are coupled, if `|C(t,i,s,j)|>tolerance*sqrt(C(t,i,t,i)*C(s,j,s,j))` for any times `t` and `s`.
+        The blocks are the connected components of the coupled observables.
+        \return Returns the sorted observables of each block. The blocks are ordered by their first observable.
+    */
+    std::vector<std::vector<size_t>> getObservableBlocks(TensorUtils::tensor<double,4> &correlation, double tolerance);
+
+    /*!
+        \brief Writes the block of each observable to `out_path/observable_blocks.txt`.
+
+        The file contains one integer label per observable, separated by whitespace.
+        Observables with the same label belong to the same block. The file may also be written by hand.
+    */
+    void writeObservableBlocks(std::vector<std::vector<size_t>> &blocks, size_t num_obs, std::filesystem::path out_path);
+
+    /*!
+        \brief Reads the observable blocks from `out_path/observable_blocks.txt`. See \ref writeObservableBlocks.
+
+        Throws \ref TensorUtils::ErrorHandler::CorruptFile, if the file cannot be read or does not contain `num_obs` labels.
+    */
+    std::vector<std::vector<size_t>> readObservableBlocks(std::filesystem::path out_path, size_t num_obs);
+
+    /*!
+        \brief Returns the drift term of a non-stationary correlation function, whose observable blocks are uncorrelated.
+
+        The drift term is computed for each block of `blocks` separately on `num_threads` threads, or all hardware threads if `num_threads` is zero.
+        The drift term between different blocks is zero.
+    */
+    TensorUtils::tensor<double,3> getDecoupledDrift(
+        TensorUtils::tensor<double,4> &correlation,
+        double dt,
+        std::vector<std::vector<size_t>> &blocks,
+        size_t num_threads=0);
+
+    /*!
+        \brief Returns the memory kernel `kernel(t,i,s,j)` of a non-stationary correlation function, whose observable blocks are uncorrelated.
+
+        The memory kernel is computed for each block of `blocks` separately on `num_threads` threads, or all hardware threads if `num_threads` is zero.
+        For `num_blocks` blocks of equal size, the cost is reduced by the factor `num_blocks^2`. The memory kernel between different blocks is zero.
+    */
+    TensorUtils::tensor<double,4> getDecoupledMemoryKernel(
+        TensorUtils::tensor<double,4> &correlation,
+        double dt,
+        std::vector<std::vector<size_t>> &blocks,
+        size_t num_threads=0);
+
+    /*!
+        \brief As \ref getDecoupledDrift for the band of a correlation function, see \ref getBandedDrift.
+    */
+    TensorUtils::tensor<double,3> getDecoupledBandedDrift(
+        TensorUtils::tensor<double,4> &correlation,
+        double dt,
+        std::vector<std::vector<size_t>> &blocks,
+        size_t num_threads=0);
+
+    /*!
+        \brief As \ref getDecoupledMemoryKernel for the band of a correlation function, see \ref getBandedMemoryKernel.
+        The band of the memory kernel between different blocks is zero.
+    */
+    TensorUtils::tensor<double,4> getDecoupledBandedMemoryKernel(
+        TensorUtils::tensor<double,4> &correlation,
+        double dt,
+        size_t memory_horizon,
+        std::vector<std::vector<size_t>> &blocks,
+        size_t num_threads=0);
+
+    /*!
+        \brief Appends a block of simulated trajectories `sim` and the first `num_rand_ff` corresponding fluctuating forces `rand_ff`
+        to `out_path/SIM/traj.f64` and `out_path/SIM/rand_ff.f64`.
+
+        If `txt_out` is true, the trajectories are also written to `out_path/SIM/sim_<n>.txt`,
+        where `<n>` starts counting at `first`.
+    */
+    void writeSimulationChunk(
+        TensorUtils::tensor<double,3> &sim,
+        TensorUtils::tensor<double,3> &rand_ff,
+        TensorUtils::tensor<double,1> &times,
+        size_t first,
+        std::filesystem::path out_path,
+        bool txt_out,
+        size_t num_rand_ff);
 
     /*!
         \brief Draws the fluctuating forces and simulates new trajectories for the non-stationary case.
+
+        The trajectories are simulated in blocks of `chunk_size` trajectories,
+        which are appended to the output files by \ref writeSimulationChunk.
+        Hence, the memory requirements do not depend on `num_sim`. If `chunk_size` is zero, all trajectories are simulated at once.
+
+        Only the first `rand_ff_out` realizations of the fluctuating forces are written to `out_path/SIM/rand_ff.f64`,
+        or all of them if `rand_ff_out` is negative. Since all realizations are drawn independently, they form a random subset.
+        If `rand_ff_stats` is true, the average and covariance matrix of all drawn fluctuating forces are accumulated on the fly
+        and written to `out_path/SIM/ff_average.f64` and `out_path/SIM/ff_cov.f64`.
+        If `sim_correlation` is true, the correlation function of the simulated trajectories is accumulated on the fly
+        and written to `out_path/SIM` by \ref writeEnsembleCorrelation.
+
+        Only the initial values `traj(n,0,i)` are used, hence `traj` may contain the first time step only.
+        The number of time steps is given by `times`.
+        If `memory_horizon` is positive, the memory integral is restricted to the last `memory_horizon` time steps,
+        see \ref applyMemoryHorizon.
+        If `banded` is true, `kernel` holds the band of \ref getBandedMemoryKernel and its width replaces `memory_horizon`.
+        If `hkernel` is not a null pointer, the compressed kernel is used instead of `kernel`, which may be empty.
+        The lower Darboux sum is then evaluated on the fly by \ref HierarchicalKernel::step and `memory_horizon` has no effect.
+        The classical Runge-Kutta method requires the dense kernel, which is restored by \ref HierarchicalKernel::dense.
     */
-    TensorUtils::tensor<double,3> simulateTrajectories(
+    void simulateTrajectories(
         TensorUtils::tensor<double,3> &traj,
         TensorUtils::tensor<double,3> &drift,
         TensorUtils::tensor<double,4> &kernel,
         TensorUtils::tensor<double,1> &mean_initial_value,
         RandomForceGenerator &rfg,
-        double dt,
+        TensorUtils::tensor<double,1> &times,
         bool shift,
         bool gaussian_init_val,
         bool darboux_sum,
         size_t num_sim,
-        std::filesystem::path out_path);
+        std::filesystem::path out_path,
+        bool txt_out,
+        size_t chunk_size,
+        int rand_ff_out,
+        bool rand_ff_stats,
+        bool sim_correlation,
+        size_t memory_horizon=0,
+        HierarchicalKernel *hkernel=nullptr,
+        bool banded=false);
 
     /*!
         \brief Draws the fluctuating forces and simulates new trajectories for the stationary case.
+
+        See \ref simulateTrajectories for the non-stationary case for details on `chunk_size`, `rand_ff_out`, `rand_ff_stats`, `sim_correlation`
+        and `memory_horizon`.
+        If `embedding` is not a null pointer, the memory integral is evaluated recursively with the auxiliary variables of the
+        \ref MarkovianEmbedding, which must be fitted to `kernel`. Then, the cost per time step does not depend on the history length
+        and `memory_horizon` has no effect.
     */
-    TensorUtils::tensor<double,3> simulateTrajectories(
+    void simulateTrajectories(
         TensorUtils::tensor<double,3> &traj,
         TensorUtils::tensor<double,2> &drift,
         TensorUtils::tensor<double,3> &kernel,
         TensorUtils::tensor<double,1> &mean_initial_value,
         RandomForceGenerator &rfg,
-        double dt,
+        TensorUtils::tensor<double,1> &times,
         bool shift,
         bool gaussian_init_val,
         bool darboux_sum,
         size_t num_sim,
         std::filesystem::path out_path,
-        bool accelerate_stationary_decomp);
+        bool accelerate_stationary_decomp,
+        bool txt_out,
+        size_t chunk_size,
+        int rand_ff_out,
+        bool rand_ff_stats,
+        bool sim_correlation,
+        size_t memory_horizon=0,
+        MarkovianEmbedding *embedding=nullptr);
 }
 
 #endif  // KERNEL_KERNELMETHODS_H_
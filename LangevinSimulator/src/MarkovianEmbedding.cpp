@@ -0,0 +1,205 @@
+/**
+LangevinSimulator Version 1.0
+
+Copyright 2020-2022 Christoph Widder and Fabian Glatzel
+
+Christoph Widder <christoph.widder[at]merkur.uni-freiburg.de>
+Fabian Glatzel <fabian.glatzel[at]physik.uni-freiburg.de>
+
+This file is part of LangevinSimulator.
+
+LangevinSimulator is free software: you can redistribute it and/or modify it under the terms of
+the GNU General Public License as published by the Free Software Foundation, either
+version 3 of the License, or (at your option) any later version.
+
+LangevinSimulator is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with LangevinSimulator.
+If not, see <https://www.gnu.org/licenses/>.
+**/
+
+#include "MarkovianEmbedding.hpp"
+#include "GslAdapter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <gsl/gsl_blas.h>
+#include <gsl/gsl_linalg.h>
+#include <gsl/gsl_eigen.h>
+#include <gsl/gsl_complex_math.h>
+
+using namespace std;
+using namespace TensorUtils;
+
+MarkovianEmbedding::MarkovianEmbedding(tensor<double,3> &kernel, double tolerance)
+{
+    const size_t t_not = (kernel.shape[0]+1)/2-1;
+    const size_t num_obs = kernel.shape[1];
+    const size_t num_lags = t_not; // lags n=1,...,t_not
+    if(num_lags < 2)
+    {
+        throw ErrorHandler::ShapeMismatch("MarkovianEmbedding: Shape mismatch: At least two time-lags are required!");
+    }
+
+    // BLOCK HANKEL MATRICES H0(a,b)=K(a+b+1) AND H1(a,b)=K(a+b+2)
+    const size_t num_blocks = min(num_lags/2, max<size_t>(1,MAX_HANKEL_SIZE/num_obs));
+    const size_t dim = num_blocks*num_obs;
+    tensor<double,4> H0({num_blocks,num_obs,num_blocks,num_obs});
+    tensor<double,4> H1({num_blocks,num_obs,num_blocks,num_obs});
+    for(size_t a=0; a<num_blocks; a++)
+    {
+        for(size_t i=0; i<num_obs; i++)
+        {
+            for(size_t b=0; b<num_blocks; b++)
+            {
+                for(size_t k=0; k<num_obs; k++)
+                {
+                    H0(a,i,b,k) = kernel(t_not+a+b+1,i,k);
+                    H1(a,i,b,k) = kernel(t_not+a+b+2,i,k);
+                }
+            }
+        }
+    }
+
+    // SINGULAR VALUE DECOMPOSITION H0 = U S V^T, U IS STORED IN H0
+    gsl_matrix_view U = GslAdapter::matrix(H0);
+    gsl_matrix * V = gsl_matrix_alloc(dim,dim);
+    gsl_vector * S = gsl_vector_alloc(dim);
+    gsl_vector * work = gsl_vector_alloc(dim);
+    gsl_linalg_SV_decomp(&U.matrix,V,S,work);
+    gsl_vector_free(work);
+
+    // NUMBER OF EXPONENTIALS
+    double norm = 0.0;
+    for(size_t m=0; m<dim; m++)
+    {
+        norm += gsl_vector_get(S,m)*gsl_vector_get(S,m);
+    }
+    size_t order = dim;
+    double tail = 0.0;
+    while(order>1)
+    {
+        double sigma = gsl_vector_get(S,order-1);
+        if(tail+sigma*sigma > tolerance*tolerance*norm && sigma > 1e-12*gsl_vector_get(S,0))
+        {
+            break;
+        }
+        tail += sigma*sigma;
+        order--;
+    }
+
+    // REALIZATION A = S^{-1/2} U^T H1 V S^{-1/2}, B = S^{1/2} V^T, C = U S^{1/2} TRUNCATED TO order
+    A.alloc({order,order},0.0);
+    B.alloc({order,num_obs},0.0);
+    C.alloc({num_obs,order},0.0);
+    if(norm > 0.0)
+    {
+        gsl_matrix_view H1_mat = GslAdapter::matrix(H1);
+        gsl_matrix_view U_M = gsl_matrix_submatrix(&U.matrix,0,0,dim,order);
+        gsl_matrix_view V_M = gsl_matrix_submatrix(V,0,0,dim,order);
+        gsl_matrix * H1V = gsl_matrix_alloc(dim,order);
+        gsl_blas_dgemm(CblasNoTrans,CblasNoTrans,1.0,&H1_mat.matrix,&V_M.matrix,0.0,H1V);
+        gsl_matrix_view A_mat = GslAdapter::matrix(A,order,order);
+        gsl_blas_dgemm(CblasTrans,CblasNoTrans,1.0,&U_M.matrix,H1V,0.0,&A_mat.matrix);
+        gsl_matrix_free(H1V);
+        for(size_t m=0; m<order; m++)
+        {
+            double sqrt_sigma = sqrt(gsl_vector_get(S,m));
+            for(size_t l=0; l<order; l++)
+            {
+                A(m,l) /= sqrt_sigma*sqrt(gsl_vector_get(S,l));
+            }
+            for(size_t k=0; k<num_obs; k++)
+            {
+                B(m,k) = sqrt_sigma*gsl_matrix_get(V,k,m);
+                C(k,m) = sqrt_sigma*gsl_matrix_get(&U.matrix,k,m);
+            }
+        }
+    }
+    gsl_matrix_free(V);
+    gsl_vector_free(S);
+    H0.clear();
+    H1.clear();
+
+    // RELATIVE ERROR OF K_fit(n) = C A^(n-1) B FOR ALL LAGS
+    double err = 0.0;
+    double ref = 0.0;
+    tensor<double,2> W = B;
+    tensor<double,2> K_fit({num_obs,num_obs});
+    gsl_matrix_view W_mat = GslAdapter::matrix(W,order,num_obs);
+    gsl_matrix_view K_fit_mat = GslAdapter::matrix(K_fit,num_obs,num_obs);
+    for(size_t n=1; n<=num_lags; n++)
+    {
+        memory(&W_mat.matrix,&K_fit_mat.matrix);
+        for(size_t i=0; i<num_obs; i++)
+        {
+            for(size_t k=0; k<num_obs; k++)
+            {
+                err += (K_fit(i,k)-kernel(t_not+n,i,k))*(K_fit(i,k)-kernel(t_not+n,i,k));
+                ref += kernel(t_not+n,i,k)*kernel(t_not+n,i,k);
+            }
+        }
+        propagate(&W_mat.matrix);
+    }
+    fit_error = ref > 0.0 ? sqrt(err/ref) : 0.0;
+
+    // SPECTRAL RADIUS
+    tensor<double,2> A_copy = A;
+    gsl_matrix_view A_copy_mat = GslAdapter::matrix(A_copy,order,order);
+    gsl_vector_complex * eval = gsl_vector_complex_alloc(order);
+    gsl_eigen_nonsymm_workspace * w = gsl_eigen_nonsymm_alloc(order);
+    gsl_eigen_nonsymm(&A_copy_mat.matrix,eval,w);
+    gsl_eigen_nonsymm_free(w);
+    radius = 0.0;
+    for(size_t m=0; m<order; m++)
+    {
+        radius = max(radius,gsl_complex_abs(gsl_vector_complex_get(eval,m)));
+    }
+    gsl_vector_complex_free(eval);
+}
+
+MarkovianEmbedding::~MarkovianEmbedding()
+{
+    //dtor
+}
+
+size_t MarkovianEmbedding::order() const
+{
+    return A.shape[0];
+}
+
+double MarkovianEmbedding::error() const
+{
+    return fit_error;
+}
+
+double MarkovianEmbedding::spectral_radius() const
+{
+    return radius;
+}
+
+void MarkovianEmbedding::propagate(gsl_matrix *z, const gsl_matrix *x, double alpha)
+{
+    if(buffer.shape[0] != z->size1 || buffer.shape[1] != z->size2)
+    {
+        buffer.alloc_uninitialized({z->size1,z->size2});
+    }
+    gsl_matrix_const_view A_mat = GslAdapter::const_matrix(A,A.shape[0],A.shape[1]);
+    gsl_matrix_view buffer_mat = GslAdapter::matrix(buffer,z->size1,z->size2);
+    gsl_blas_dgemm(CblasNoTrans,CblasNoTrans,1.0,&A_mat.matrix,z,0.0,&buffer_mat.matrix);
+    if(x != nullptr)
+    {
+        gsl_matrix_const_view B_mat = GslAdapter::const_matrix(B,B.shape[0],B.shape[1]);
+        gsl_blas_dgemm(CblasNoTrans,CblasNoTrans,alpha,&B_mat.matrix,x,1.0,&buffer_mat.matrix);
+    }
+    gsl_matrix_memcpy(z,&buffer_mat.matrix);
+}
+
+void MarkovianEmbedding::memory(const gsl_matrix *z, gsl_matrix *y, double alpha, double beta)
+{
+    gsl_matrix_const_view C_mat = GslAdapter::const_matrix(C,C.shape[0],C.shape[1]);
+    gsl_blas_dgemm(CblasNoTrans,CblasNoTrans,alpha,&C_mat.matrix,z,beta,y);
+}
@@ -0,0 +1,96 @@
+/**
+LangevinSimulator Version 1.0
+
+Copyright 2020-2022 Christoph Widder and Fabian Glatzel
+
+Christoph Widder <christoph.widder[at]merkur.uni-freiburg.de>
+Fabian Glatzel <fabian.glatzel[at]physik.uni-freiburg.de>
+
+This file is part of LangevinSimulator.
+
+LangevinSimulator is free software: you can redistribute it and/or modify it under the terms of
+the GNU General Public License as published by the Free Software Foundation, either
+version 3 of the License, or (at your option) any later version.
+
+LangevinSimulator is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with LangevinSimulator.
+If not, see <https://www.gnu.org/licenses/>.
+**/
+
+#ifndef MARKOVIANEMBEDDING_HPP
+#define MARKOVIANEMBEDDING_HPP
+
+#include <gsl/gsl_matrix.h>
+
+#include "TensorUtils.hpp"
+
+/*!
+    \brief This class fits the stationary memory kernel with a sum of exponentials
+    and evaluates the memory integral recursively by means of auxiliary variables.
+
+    The kernel is approximated by `K(n*dt) = C A^(n-1) B` for `n>0`, where `A` is a real `M x M` matrix
+    and `B`, `C` are `M x num_obs` and `num_obs x M` matrices, respectively. The eigenvalues `l_m` of `A`
+    are the (complex) exponentials, i.e. `K(n*dt)` is a linear combination of `l_m^n`.
+    The fit is obtained with the eigensystem realization algorithm from the singular value decomposition of
+    the block Hankel matrix `H(a,b)=K((a+b+1)*dt)`.
+
+    The auxiliary variables `z(n) = sum_{s<n} A^(n-1-s) B x(s)` obey `z(n+1) = A z(n) + B x(n)`,
+    hence the memory integral `sum_{s<n} K((n-s)*dt) x(s) = C z(n)` costs `O(M*M+M*num_obs)` per time step
+    instead of `O(n*num_obs*num_obs)`.
+*/
+class MarkovianEmbedding
+{
+    public:
+        /*!
+            \brief Fits the stationary memory kernel `kernel` (see \ref KernelMethods::getMemoryKernel) up to the relative tolerance `tolerance`.
+
+            The number of exponentials `M` is the smallest number for which the discarded singular values of the Hankel matrix
+            have a relative norm below `tolerance`. The Hankel matrix is limited to `MAX_HANKEL_SIZE` rows.
+            The relative error of the fit with respect to all lags `n>0` is available via \ref error.
+        */
+        MarkovianEmbedding(TensorUtils::tensor<double,3> &kernel, double tolerance);
+        virtual ~MarkovianEmbedding();
+
+        //! \brief Returns the number of exponentials, i.e. the number of auxiliary variables per observable.
+        size_t order() const;
+
+        //! \brief Returns the relative error `|K_fit-K|/|K|` of the fitted kernel, where `|.|` is the Frobenius norm over all lags `n>0`.
+        double error() const;
+
+        //! \brief Returns the largest absolute value of the exponentials. The auxiliary system is unstable, if it exceeds one.
+        double spectral_radius() const;
+
+        /*!
+            \brief Advances the auxiliary variables `z` by one time step, i.e. `z = A z + alpha B x`.
+
+            `z` is an `M x num_traj` matrix and `x` a `num_obs x num_traj` matrix. If `x` is a null pointer, `z = A z`.
+        */
+        void propagate(gsl_matrix *z, const gsl_matrix *x=nullptr, double alpha=1.0);
+
+        /*!
+            \brief Evaluates the memory integral from the auxiliary variables, i.e. `y = alpha C z + beta y`.
+        */
+        void memory(const gsl_matrix *z, gsl_matrix *y, double alpha=1.0, double beta=0.0);
+
+        //! \brief Maximum number of rows of the block Hankel matrix.
+        static const size_t MAX_HANKEL_SIZE = 1024;
+
+    protected:
+        //! \private
+        TensorUtils::tensor<double,2> A;
+        //! \private
+        TensorUtils::tensor<double,2> B;
+        //! \private
+        TensorUtils::tensor<double,2> C;
+        //! \private
+        TensorUtils::tensor<double,2> buffer;
+        //! \private
+        double fit_error;
+        //! \private
+        double radius;
+};
+
+#endif // MARKOVIANEMBEDDING_HPP
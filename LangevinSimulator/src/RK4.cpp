@@ -22,6 +22,7 @@ If not, see <https://www.gnu.org/licenses/>.
 
 #include "RK4.hpp"
 #include "KernelMethods.hpp"
+#include "GslAdapter.hpp"
 
 #include <cmath>
 
@@ -30,9 +31,9 @@ If not, see <https://www.gnu.org/licenses/>.
 using namespace std;
 using namespace TensorUtils;
 
-RK4::RK4()
+RK4::RK4(size_t memory_horizon, MarkovianEmbedding *embedding, bool banded) : memory_horizon(memory_horizon), banded(banded), embedding(embedding)
 {
-    //ctor
+    history_base = 0;
 }
 
 RK4::~RK4()
@@ -49,24 +50,28 @@ tensor<double,1> RK4::f(
     tensor<double,2> &rand_ff)
 {
     const size_t num_obs = traj.shape[1];
-    const size_t num_ts = kernel.shape[0];
     const size_t num_obs_2 = num_obs*num_obs;
-    const size_t idx_t1 = n*num_ts*num_obs*num_obs;
+    const size_t idx_t1 = n*kernel.shape[1]*num_obs_2;
 
     tensor<double,1> f_n_x({num_obs}, 0.0);
 
-    for(size_t tau=0;tau<=n;tau++)
+    // A BANDED KERNEL HOLDS K(n,tau) AT (n,horizon+tau-n)
+    const size_t horizon = banded ? kernel.shape[1]-1 : memory_horizon;
+    const size_t tau_0 = horizon>0 && n>horizon ? n-horizon : 0;
+
+    for(size_t tau=tau_0;tau<=n;tau++)
     {
+        const size_t idx_tau = idx_t1+(banded ? horizon+tau-n : tau)*num_obs_2;
         for(size_t i = 0; i<num_obs; i++)
         {
             buffer_2d(tau,i) = 0.0;
             for(size_t k = 0; k<num_obs; k++)
             {
-                buffer_2d[tau*num_obs+i] += kernel[idx_t1+tau*num_obs_2+i*num_obs+k]*traj[tau*num_obs+k];
+                buffer_2d[tau*num_obs+i] += kernel[idx_tau+i*num_obs+k]*traj[tau*num_obs+k];
             }
         }
     }
-    size_t j=0;
+    size_t j=tau_0;
     while(j+1 < n) // Simpson rule
     {
         for(size_t i=0; i<num_obs; i++)
@@ -112,34 +117,61 @@ tensor<double,1> RK4::f(
 
     tensor<double,1> f_n_x({num_obs}, 0.0);
 
-    for(size_t tau=0;tau<=n;tau++)
+    if(embedding != nullptr)
     {
-        for(size_t i = 0; i<num_obs; i++)
+        // HISTORY s<history_base FROM THE AUXILIARY VARIABLES
+        const size_t d = n-history_base;
+        for(size_t i=0; i<num_obs; i++)
         {
-            buffer_2d(tau,i) = 0.0;
-            for(size_t k = 0; k<num_obs; k++)
+            f_n_x[i] = history(d,i);
+        }
+        // REMAINING TIME-STEPS history_base<=s<=n WITH THE WEIGHTS OF THE SIMPSON AND TRAPEZOIDAL RULE
+        const double w_base = history_base>0 ? 1.0 : 0.0;
+        const double weights[3][3] = {{w_base,0.0,0.0},{w_base+1.5,1.5,0.0},{w_base+1.0,4.0,1.0}};
+        for(size_t s=history_base; s<=n; s++)
+        {
+            for(size_t i = 0; i<num_obs; i++)
             {
-                buffer_2d[tau*num_obs+i] += kernel[ num_obs_2*(t_not+n-tau)+i*num_obs+k]*traj[tau*num_obs+k];
+                for(size_t k = 0; k<num_obs; k++)
+                {
+                    f_n_x[i] += weights[d][s-history_base]*kernel[ num_obs_2*(t_not+n-s)+i*num_obs+k]*traj[s*num_obs+k];
+                }
             }
         }
     }
-    size_t j=0;
-    while(j+1 < n) // Simpson rule
+    else
     {
-        for(size_t i=0; i<num_obs; i++)
+        const size_t tau_0 = memory_horizon>0 && n>memory_horizon ? n-memory_horizon : 0;
+
+        for(size_t tau=tau_0;tau<=n;tau++)
         {
-            f_n_x[i] += buffer_2d[j*num_obs+i];
-            f_n_x[i] += 4.0*buffer_2d[(j+1)*num_obs+i];
-            f_n_x[i] += buffer_2d[(j+2)*num_obs+i];
+            for(size_t i = 0; i<num_obs; i++)
+            {
+                buffer_2d(tau,i) = 0.0;
+                for(size_t k = 0; k<num_obs; k++)
+                {
+                    buffer_2d[tau*num_obs+i] += kernel[ num_obs_2*(t_not+n-tau)+i*num_obs+k]*traj[tau*num_obs+k];
+                }
+            }
         }
-        j+=2;
-    }
-    if(j+1 == n) // Trapezoidal rule for last time-interval
-    {
-        for(size_t i=0; i<num_obs; i++)
+        size_t j=tau_0;
+        while(j+1 < n) // Simpson rule
         {
-            f_n_x[i] += 1.5*buffer_2d[j*num_obs+i];
-            f_n_x[i] += 1.5*buffer_2d[(j+1)*num_obs+i];
+            for(size_t i=0; i<num_obs; i++)
+            {
+                f_n_x[i] += buffer_2d[j*num_obs+i];
+                f_n_x[i] += 4.0*buffer_2d[(j+1)*num_obs+i];
+                f_n_x[i] += buffer_2d[(j+2)*num_obs+i];
+            }
+            j+=2;
+        }
+        if(j+1 == n) // Trapezoidal rule for last time-interval
+        {
+            for(size_t i=0; i<num_obs; i++)
+            {
+                f_n_x[i] += 1.5*buffer_2d[j*num_obs+i];
+                f_n_x[i] += 1.5*buffer_2d[(j+1)*num_obs+i];
+            }
         }
     }
     f_n_x *= dt/3.0;
@@ -263,9 +295,17 @@ void RK4::integrate(
     buffer_2d.alloc(traj.shape,0.0);
     for(size_t n=0;n+2<traj.shape[0];n+=2)
     {
+        if(embedding != nullptr)
+        {
+            update_history(n,traj);
+        }
         process(n,dt,drift,kernel,traj,rand_ff);
     }
     if(traj.shape[0]%2 == 0){
+        if(embedding != nullptr)
+        {
+            update_history(traj.shape[0]-2,traj);
+        }
         tensor<double,1> k1 = f(traj.shape[0]-2,dt,drift,kernel,traj,rand_ff);
         for(size_t i=0; i< traj.shape[1]; i++)
         {
@@ -279,3 +319,32 @@ void RK4::integrate(
     }
 }
 
+
+void RK4::update_history(size_t n, tensor<double,2> &traj)
+{
+    const size_t num_obs = traj.shape[1];
+    const size_t order = embedding->order();
+    if(n==0)
+    {
+        history_state.alloc({order,1},0.0);
+        history.alloc({3,num_obs},0.0);
+    }
+    else
+    {
+        // ADD TIME-STEPS n-2 AND n-1 WITH THE WEIGHTS OF THE SIMPSON RULE
+        gsl_matrix_view z = GslAdapter::matrix(history_state,order,1);
+        gsl_matrix_const_view x_0 = gsl_matrix_const_view_array(&traj(n-2),num_obs,1);
+        gsl_matrix_const_view x_1 = gsl_matrix_const_view_array(&traj(n-1),num_obs,1);
+        embedding->propagate(&z.matrix,&x_0.matrix,n==2 ? 1.0 : 2.0);
+        embedding->propagate(&z.matrix,&x_1.matrix,4.0);
+    }
+    tensor<double,2> z_d = history_state;
+    gsl_matrix_view z = GslAdapter::matrix(z_d,order,1);
+    for(size_t d=0; d<3; d++)
+    {
+        gsl_matrix_view history_d = gsl_matrix_view_array(&history(d),num_obs,1);
+        embedding->memory(&z.matrix,&history_d.matrix);
+        embedding->propagate(&z.matrix);
+    }
+    history_base = n;
+}
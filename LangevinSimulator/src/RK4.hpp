@@ -26,6 +26,7 @@ If not, see <https://www.gnu.org/licenses/>.
 #include <vector>
 
 #include "TensorUtils.hpp"
+#include "MarkovianEmbedding.hpp"
 
 /*!
     \brief This class offers routines to integrate the nsGLE using the classical Runge-Kutta method (RK4).
@@ -33,7 +34,16 @@ If not, see <https://www.gnu.org/licenses/>.
 class RK4
 {
     public:
-        RK4();
+        /*!
+            \brief If `memory_horizon` is positive, the memory integral is restricted to the last `memory_horizon` time steps,
+            i.e. the memory kernel `K(t,s)` is assumed to vanish for `t-s>memory_horizon*dt`.
+            If `banded` is true, the non-stationary kernel is the band of \ref KernelMethods::getBandedMemoryKernel,
+            whose width replaces `memory_horizon`.
+
+            If `embedding` is not a null pointer, the memory integral of the stationary case is evaluated with the auxiliary variables
+            of the \ref MarkovianEmbedding for all but the last few time steps. Then, `memory_horizon` has no effect in the stationary case.
+        */
+        RK4(size_t memory_horizon=0, MarkovianEmbedding *embedding=nullptr, bool banded=false);
         virtual ~RK4();
 
         /*!
@@ -105,10 +115,30 @@ class RK4
             TensorUtils::tensor<double,2> &traj,
             TensorUtils::tensor<double,2> &rand_ff);
 
+        /*!
+            \brief Advances the auxiliary variables of the \ref MarkovianEmbedding to the time-step `n`,
+            i.e. they account for all time-steps `s<n` of `traj`, and stores the memory integrals at `t=n*dt`, `(n+1)*dt` and `(n+2)*dt`.
+
+            Must be called for `n=0,2,4,...`, before \ref process is called for `n`.
+        */
+        void update_history(size_t n, TensorUtils::tensor<double,2> &traj);
+
         //! \private
         TensorUtils::tensor<double,1> buffer;
         //! \private
         TensorUtils::tensor<double,2> buffer_2d;
+        //! \private
+        size_t memory_horizon;
+        //! \private
+        bool banded;
+        //! \private
+        MarkovianEmbedding *embedding;
+        //! \private
+        TensorUtils::tensor<double,2> history_state;
+        //! \private
+        TensorUtils::tensor<double,2> history;
+        //! \private
+        size_t history_base;
 };
 
 #endif // RK4_HPP
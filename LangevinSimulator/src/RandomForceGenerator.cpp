@@ -21,8 +21,11 @@ If not, see <https://www.gnu.org/licenses/>.
 **/
 
 #include "RandomForceGenerator.hpp"
+#include "GslAdapter.hpp"
 
+#include <atomic>
 #include <iostream>
+#include <thread>
 #include <sys/time.h>
 #include <cmath>
 #include <cstring>
@@ -53,22 +56,29 @@ RandomForceGenerator::RandomForceGenerator()
     gettimeofday(&tv,0);
     unsigned long mySeed = tv.tv_sec + tv.tv_usec;
     gsl_rng_set(rng_r, mySeed);
+
+    buffer = nullptr;
+    banded = false;
 }
 
 RandomForceGenerator::~RandomForceGenerator()
 {
     // free GSL random number generator
     gsl_rng_free (rng_r);
-    gsl_matrix_free(ff_decomp);
     gsl_vector_free(buffer);
-    gsl_vector_free(buffer2);
     for(auto it=stationary_decomp.begin(); it!=stationary_decomp.end(); it++)
     {
         gsl_matrix_complex_free(*it);
     }
 }
 
-void RandomForceGenerator::init_cov(tensor<double,2> &ff_average, tensor<double,4> &ff_cov, filesystem::path out_path)
+void RandomForceGenerator::init_cov(
+    tensor<double,2> &ff_average,
+    tensor<double,4> &ff_cov,
+    filesystem::path out_path,
+    TensorUtils::Encoding encoding,
+    vector<vector<size_t>> *blocks,
+    size_t num_threads)
 {
     // store average
     this->ff_average = ff_average;
@@ -78,18 +88,78 @@ void RandomForceGenerator::init_cov(tensor<double,2> &ff_average, tensor<double,
     size_t n_max = num_ts*num_obs;
 
     // allocate
-    ff_decomp = gsl_matrix_alloc(n_max,n_max);
     buffer = gsl_vector_alloc(n_max);
-    buffer2 = gsl_vector_alloc(n_max);
     rand_mult_gaussian.alloc({num_ts,num_obs});
 
     // initialize
-    cout << "Calculate rotation matrix using spectral decomposition." << endl;
-    set_decomp(ff_cov,ff_decomp);
+    if(blocks == nullptr || blocks->size() < 2)
+    {
+        cout << "Calculate rotation matrix using spectral decomposition." << endl;
+        set_decomp(ff_cov);
+    }
+    else
+    {
+        if(num_threads == 0)
+        {
+            num_threads = max<size_t>(thread::hardware_concurrency(),1);
+        }
+        num_threads = min(num_threads,blocks->size());
+        cout << "Calculate rotation matrix using spectral decomposition of " << blocks->size() << " observable blocks on " << num_threads << " threads." << endl;
+        // THE ROTATION MATRIX IS BLOCK-DIAGONAL, TOO. THE BLOCKS WRITE DISJOINT COMPONENTS
+        tensor<double,4> cov = std::move(ff_cov);
+        ff_cov = tensor<double,4>({num_ts,num_obs,num_ts,num_obs},0.0);
+        atomic<size_t> next_block(0);
+        auto worker = [&]()
+        {
+            for(size_t b=next_block++; b<blocks->size(); b=next_block++)
+            {
+                vector<size_t> &obs = (*blocks)[b];
+                size_t m = obs.size();
+                tensor<double,4> block;
+                block.alloc_uninitialized({num_ts,m,num_ts,m});
+                for(size_t t=0; t<num_ts; t++)
+                {
+                    for(size_t k=0; k<m; k++)
+                    {
+                        for(size_t s=0; s<num_ts; s++)
+                        {
+                            for(size_t l=0; l<m; l++)
+                            {
+                                block(t,k,s,l) = cov(t,obs[k],s,obs[l]);
+                            }
+                        }
+                    }
+                }
+                set_decomp(block);
+                for(size_t t=0; t<num_ts; t++)
+                {
+                    for(size_t k=0; k<m; k++)
+                    {
+                        for(size_t s=0; s<num_ts; s++)
+                        {
+                            for(size_t l=0; l<m; l++)
+                            {
+                                ff_cov(t,obs[k],s,obs[l]) = block(t,k,s,l);
+                            }
+                        }
+                    }
+                }
+            }
+        };
+        vector<thread> workers;
+        for(size_t n=0; n<num_threads; n++)
+        {
+            workers.emplace_back(worker);
+        }
+        for(thread &w : workers)
+        {
+            w.join();
+        }
+    }
 
-    ff_cov << *ff_decomp->data;
     cout << "Write rotation matrix: " << out_path/"ff_decomp.f64" << endl;
-    ff_cov.write("ff_decomp.f64",out_path);
+    ff_cov.write("ff_decomp.f64",out_path,encoding);
+    ff_decomp = std::move(ff_cov);
 }
 
 void RandomForceGenerator::init_cov(tensor<double,2> &ff_average, tensor<double,3> &ff_cov, filesystem::path out_path)
@@ -200,18 +270,74 @@ void RandomForceGenerator::init_decomp(tensor<double,2> &ff_average, tensor<doub
     size_t n_max = num_ts*num_obs;
 
     // allocate
-    this->ff_decomp = gsl_matrix_alloc(n_max,n_max);
     buffer = gsl_vector_alloc(n_max);
-    buffer2 = gsl_vector_alloc(n_max);
     rand_mult_gaussian.alloc({num_ts,num_obs});
 
-    ff_decomp >> *this->ff_decomp->data;
+    this->ff_decomp = std::move(ff_decomp);
+}
+
+void RandomForceGenerator::init_banded_cov(
+    tensor<double,2> &ff_average,
+    tensor<double,4> &ff_cov,
+    filesystem::path out_path,
+    vector<vector<size_t>> *blocks)
+{
+    if(blocks != nullptr)
+    {
+        // DECOUPLE THE OBSERVABLE BLOCKS
+        size_t num_obs = ff_cov.shape[2];
+        vector<size_t> label(num_obs);
+        for(size_t b=0; b<blocks->size(); b++)
+        {
+            for(size_t i : (*blocks)[b])
+            {
+                label[i] = b;
+            }
+        }
+        for(size_t n=0; n<ff_cov.shape[0]*ff_cov.shape[1]; n++)
+        {
+            for(size_t i=0; i<num_obs; i++)
+            {
+                for(size_t j=0; j<num_obs; j++)
+                {
+                    if(label[i] != label[j])
+                    {
+                        ff_cov[(n*num_obs+i)*num_obs+j] = 0.0;
+                    }
+                }
+            }
+        }
+    }
+    cout << "Calculate banded rotation matrix using block Cholesky decomposition." << endl;
+    set_banded_decomp(ff_cov);
+    cout << "Write rotation matrix: " << out_path/"ff_decomp_banded.f64" << endl;
+    ff_cov.write("ff_decomp_banded.f64",out_path);
+    init_banded_decomp(ff_average,ff_cov);
+}
+
+void RandomForceGenerator::init_banded_decomp(tensor<double,2> &ff_average, tensor<double,4> &ff_decomp)
+{
+    // store average
+    this->ff_average = ff_average;
+
+    size_t num_ts = ff_decomp.shape[0];
+    size_t num_obs = ff_decomp.shape[2];
+
+    // allocate
+    buffer = gsl_vector_alloc(num_ts*num_obs);
+    rand_mult_gaussian.alloc({num_ts,num_obs});
+
+    // ROW t OF THE BAND IS STORED AS MATRIX OF SHAPE {num_obs,(width+1)*num_obs}
+    this->ff_decomp = ff_decomp.transpose({0,2,1,3});
+    ff_decomp.clear();
+    banded = true;
 }
 
-void RandomForceGenerator::set_decomp(tensor<double,4> &source, gsl_matrix *dest)
+void RandomForceGenerator::set_decomp(tensor<double,4> &cov)
 {
-    source >> *dest->data;
-    size_t n_max = source.shape[0]*source.shape[1];
+    gsl_matrix_view dest_view = GslAdapter::matrix(cov);
+    gsl_matrix *dest = &dest_view.matrix;
+    size_t n_max = cov.shape[0]*cov.shape[1];
 
     gsl_vector *eval = gsl_vector_alloc (n_max);
     gsl_matrix *evec = gsl_matrix_alloc (n_max, n_max);
@@ -243,6 +369,66 @@ void RandomForceGenerator::set_decomp(tensor<double,4> &source, gsl_matrix *dest
     gsl_matrix_free (evec);
 }
 
+void RandomForceGenerator::set_banded_decomp(tensor<double,4> &cov)
+{
+    size_t num_ts = cov.shape[0];
+    size_t width = cov.shape[1]-1;
+    size_t num_obs = cov.shape[2];
+
+    // M(t,t)^-T=UD^{-1/2} FOR EACH TIME STEP, WITH ZERO FOR THE DISCARDED EIGENVALUES
+    tensor<double,3> diag_inverse({num_ts,num_obs,num_obs},0.0);
+    gsl_matrix *schur = gsl_matrix_alloc(num_obs,num_obs);
+    gsl_matrix *evec = gsl_matrix_alloc(num_obs,num_obs);
+    gsl_vector *eval = gsl_vector_alloc(num_obs);
+    gsl_eigen_symmv_workspace * w = gsl_eigen_symmv_alloc(num_obs);
+    for(size_t t=0; t<num_ts; t++)
+    {
+        size_t t0 = t>width ? t-width : 0;
+        // M(t,u) = [C(t,u) - SUM_v M(t,v)*M(u,v)^T] * M(u,u)^-T, WHERE M(t,v) VANISHES FOR t-v>width
+        for(size_t u=t0; u<t; u++)
+        {
+            gsl_matrix_view m_tu = gsl_matrix_view_array(&cov(t,width+u-t),num_obs,num_obs);
+            for(size_t v=t0; v<u; v++)
+            {
+                gsl_matrix_const_view m_tv = gsl_matrix_const_view_array(&cov(t,width+v-t),num_obs,num_obs);
+                gsl_matrix_const_view m_uv = gsl_matrix_const_view_array(&cov(u,width+v-u),num_obs,num_obs);
+                gsl_blas_dgemm(CblasNoTrans,CblasTrans,-1.0,&m_tv.matrix,&m_uv.matrix,1.0,&m_tu.matrix);
+            }
+            gsl_matrix_memcpy(schur,&m_tu.matrix);
+            gsl_matrix_const_view inverse_u = gsl_matrix_const_view_array(&diag_inverse(u),num_obs,num_obs);
+            gsl_blas_dgemm(CblasNoTrans,CblasNoTrans,1.0,schur,&inverse_u.matrix,0.0,&m_tu.matrix);
+        }
+        // SCHUR COMPLEMENT C(t,t) - SUM_u M(t,u)*M(t,u)^T
+        gsl_matrix_view m_tt = gsl_matrix_view_array(&cov(t,width),num_obs,num_obs);
+        for(size_t u=t0; u<t; u++)
+        {
+            gsl_matrix_const_view m_tu = gsl_matrix_const_view_array(&cov(t,width+u-t),num_obs,num_obs);
+            gsl_blas_dgemm(CblasNoTrans,CblasTrans,-1.0,&m_tu.matrix,&m_tu.matrix,1.0,&m_tt.matrix);
+        }
+        gsl_matrix_memcpy(schur,&m_tt.matrix);
+        gsl_eigen_symmv(schur,eval,evec,w);
+        double max_eval = 0.0;
+        for(size_t j=0; j<num_obs; j++)
+        {
+            max_eval = max(max_eval,gsl_vector_get(eval,j));
+        }
+        for(size_t j=0; j<num_obs; j++)
+        {
+            // NEGATIVE AND NEGLIGIBLE EIGENVALUES ARE DISCARDED
+            double root = gsl_vector_get(eval,j) > 1e-12*max_eval ? sqrt(gsl_vector_get(eval,j)) : 0.0;
+            for(size_t i=0; i<num_obs; i++)
+            {
+                gsl_matrix_set(&m_tt.matrix,i,j,gsl_matrix_get(evec,i,j)*root);
+                diag_inverse(t,i,j) = root > 0.0 ? gsl_matrix_get(evec,i,j)/root : 0.0;
+            }
+        }
+    }
+    gsl_eigen_symmv_free(w);
+    gsl_vector_free(eval);
+    gsl_matrix_free(evec);
+    gsl_matrix_free(schur);
+}
+
 tensor<double,2> RandomForceGenerator::pull_multivariate_gaussian()
 {
     // draw independent standard normal distributed variables
@@ -251,11 +437,30 @@ tensor<double,2> RandomForceGenerator::pull_multivariate_gaussian()
         gsl_vector_set(buffer,n,gsl_ran_gaussian(rng_r,1.0));
     }
 
-    // compute multi-dimensional Gaussian variables
-    gsl_blas_dgemv(CblasNoTrans,1.0,ff_decomp,buffer,0.0,buffer2);
+    // compute multi-dimensional Gaussian variables and store data
+    if(banded)
+    {
+        size_t num_ts = ff_decomp.shape[0];
+        size_t num_obs = ff_decomp.shape[1];
+        size_t width = ff_decomp.shape[2]-1;
+        for(size_t t=0; t<num_ts; t++)
+        {
+            // rand_ff(t) = SUM_s M(t,s)*z(s) FOR t-width<=s<=t
+            size_t t0 = t>width ? t-width : 0;
+            gsl_matrix_const_view decomp_t = gsl_matrix_const_view_array_with_tda(&ff_decomp(t,0,width+t0-t),num_obs,(t-t0+1)*num_obs,(width+1)*num_obs);
+            gsl_vector_const_view rand_t = gsl_vector_const_subvector(buffer,t0*num_obs,(t-t0+1)*num_obs);
+            gsl_vector_view out_t = gsl_vector_view_array(&rand_mult_gaussian(t),num_obs);
+            gsl_blas_dgemv(CblasNoTrans,1.0,&decomp_t.matrix,&rand_t.vector,0.0,&out_t.vector);
+        }
+    }
+    else
+    {
+        gsl_matrix_view decomp = GslAdapter::matrix(ff_decomp);
+        gsl_vector_view out = GslAdapter::vector(rand_mult_gaussian);
+        gsl_blas_dgemv(CblasNoTrans,1.0,&decomp.matrix,buffer,0.0,&out.vector);
+    }
 
-    // store data and return
-    rand_mult_gaussian << *buffer2->data;
+    // return
     rand_mult_gaussian += ff_average;
     return rand_mult_gaussian;
 }
@@ -300,7 +505,6 @@ tensor<double,2> RandomForceGenerator::pull_stationary_multivariate_gaussian()
     tensor<double, 2> ff({num_ts,num_obs});
     ff << ff_coeff[0];
     ff_coeff.clear();
-    ff *= sqrt(num_pad);
-    ff += ff_average;
+    ff = ff*sqrt(num_pad) + ff_average;
     return ff;
 }
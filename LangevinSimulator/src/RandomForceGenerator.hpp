@@ -45,21 +45,56 @@ class RandomForceGenerator
 
         /*!
             \brief Computes and writes the rotation matrix for a given covariance matrix. On exit, the RandomForceGenerator is initialized.
+            The rotation matrix of a non-stationary covariance matrix is written with the given `encoding`.
+            It is computed in the memory of `ff_cov`, which is moved into the RandomForceGenerator, i.e. `ff_cov` is empty on exit.
+            If `blocks` is not a null pointer, the observable blocks are assumed to be uncorrelated with each other, see \ref KernelMethods::getObservableBlocks.
+            Then, each block is decomposed separately on `num_threads` threads, or all hardware threads if `num_threads` is zero.
         */
-        void init_cov(TensorUtils::tensor<double,2> &ff_average, TensorUtils::tensor<double,4> &ff_cov, std::filesystem::path out_path);
+        void init_cov(
+            TensorUtils::tensor<double,2> &ff_average,
+            TensorUtils::tensor<double,4> &ff_cov,
+            std::filesystem::path out_path,
+            TensorUtils::Encoding encoding=TensorUtils::Encoding::raw,
+            std::vector<std::vector<size_t>> *blocks=nullptr,
+            size_t num_threads=0);
         void init_cov(TensorUtils::tensor<double,2> &ff_average, TensorUtils::tensor<double,3> &ff_cov, std::filesystem::path out_path);
 
         /*!
             \brief Initializes the RandomForceGenerator with a previously computed rotation matrix.
+            The rotation matrix is moved into the RandomForceGenerator, i.e. `ff_decomp` is empty on exit.
         */
         void init_decomp(TensorUtils::tensor<double,2> &ff_average, TensorUtils::tensor<double,4> &ff_decomp);
 
+        /*!
+            \brief Computes and writes the banded rotation matrix for the band `ff_cov(t,d,i,j)=C(t,i,t-width+d,j)` of a covariance matrix,
+            see \ref KernelMethods::writeBandedCovarianceMatrix. On exit, the RandomForceGenerator is initialized.
+
+            The covariance matrix is assumed to vanish outside the band. Then, its block Cholesky factor `M` has the same band,
+            which is written to `out_path/ff_decomp_banded.f64` in the same layout. See \ref set_banded_decomp.
+            The costs scale with `num_ts*width^2` and the memory with `num_ts*width` instead of `num_ts^3` and `num_ts^2`.
+            If `blocks` is not a null pointer, the covariances between different observable blocks are set to zero beforehand,
+            such that the blocks of the fluctuating forces are drawn independently as for \ref init_cov.
+            `ff_cov` is empty on exit.
+        */
+        void init_banded_cov(
+            TensorUtils::tensor<double,2> &ff_average,
+            TensorUtils::tensor<double,4> &ff_cov,
+            std::filesystem::path out_path,
+            std::vector<std::vector<size_t>> *blocks=nullptr);
+
+        /*!
+            \brief Initializes the RandomForceGenerator with a previously computed banded rotation matrix, see \ref init_banded_cov.
+            `ff_decomp` is empty on exit.
+        */
+        void init_banded_decomp(TensorUtils::tensor<double,2> &ff_average, TensorUtils::tensor<double,4> &ff_decomp);
+
         /*!
             \brief Draw multivariate normal distributed fluctuating forces.
 
             \return Returns the fluctuating forces `rand_ff = Mz`.
             The rotation matrix `M` is given by `M=UD^{1/2}`, where `C=UDU^{-1}` is the spectral decomposition of the covariance matrix
             and `z` contains independent, standard normal distributed random numbers.
+            For a banded rotation matrix, see \ref init_banded_cov, the sum `rand_ff(t)=SUM_s M(t,s)z(s)` runs over the band only.
         */
         TensorUtils::tensor<double,2> pull_multivariate_gaussian();
         TensorUtils::tensor<double,2> pull_stationary_multivariate_gaussian();
@@ -69,19 +104,27 @@ class RandomForceGenerator
         /*!
             \brief Computes `M=UD^{1/2}`, where `C=UDU^{-1}` is the spectral decomposition of the covariance matrix of the fluctuating forces.
 
-            This function is called within the constructor and stores the matrix `M` in an internal buffer to be used by \ref pull_multivariate_gaussian().
+            The covariance matrix `cov` is overwritten with the matrix `M` in place.
         */
-        void set_decomp(TensorUtils::tensor<double,4> &source, gsl_matrix *dest);
+        void set_decomp(TensorUtils::tensor<double,4> &cov);
+
+        /*!
+            \brief Computes the band of the block Cholesky factor `M` with `MM^T=C` of a banded covariance matrix in place.
+
+            The diagonal blocks `M(t,t)=UD^{1/2}` are obtained from the spectral decomposition `UDU^T` of the Schur complements,
+            whose negative eigenvalues, e.g. due to the truncation of the covariance matrix, are set to zero.
+        */
+        void set_banded_decomp(TensorUtils::tensor<double,4> &cov);
 
         //! \private
         TensorUtils::tensor<double,2> rand_mult_gaussian;
 
         //! \private
-        gsl_matrix *ff_decomp;
+        TensorUtils::tensor<double,4> ff_decomp;
         //! \private
-        gsl_vector *buffer;
+        bool banded;
         //! \private
-        gsl_vector *buffer2;
+        gsl_vector *buffer;
         //! \private
         TensorUtils::tensor<double,2> ff_average;
 
@@ -39,9 +39,13 @@ int main(int argc, char *argv[]) {
 
 	string out_folder;
 	bool txt_out;
+	bool compress;
 	bool gaussian_init_val;
 	bool darboux_sum;
 	bool stationary;
+	size_t memory_horizon;
+	double hmatrix_tolerance;
+	size_t ff_threads;
 
 	ParameterHandler cmdtool {argc, argv};
 	cmdtool.process_flag_help();
@@ -51,6 +55,8 @@ int main(int argc, char *argv[]) {
 		out_folder = cmdtool.get_string("out_folder", "./OUT");
         cmdtool.add_usage("txt_out: Boolean. If true, writes output files in text format. Default: true");
         txt_out = cmdtool.get_bool("txt_out", true);
+        cmdtool.add_usage("compress: Boolean. If true, large binary output files are written compressed. They cannot be read by the Python utilities. Default: false");
+        compress = cmdtool.get_bool("compress", false);
         cmdtool.add_usage("gaussian_init_val: Boolean. If true, the initial values will be drawn from a Gaussian. \
                           Else, the original initial values will be used for numerical simulations. Default: false");
         gaussian_init_val = cmdtool.get_bool("gaussian_init_val", false);
@@ -60,6 +66,17 @@ int main(int argc, char *argv[]) {
         darboux_sum = cmdtool.get_bool("darboux_sum", true);
 		cmdtool.add_usage("stationary: Boolean. If true, treats the process as stationary. Default: false.");
 		stationary = cmdtool.get_bool("stationary", false);
+		cmdtool.add_usage("memory_horizon: Integer. If positive, the memory kernel K(t,s) is set to zero for t-s > <memory_horizon> time steps \
+                     and the memory integrals are restricted accordingly. If <stationary>=false, the band of the memory kernel is read from kernel_banded.f64 \
+                     and only the band of the covariance matrix of the fluctuating forces is written to ff_cov_banded.f64. Default: 0, i.e. unlimited.");
+		memory_horizon = cmdtool.get_int("memory_horizon", 0);
+		cmdtool.add_usage("hmatrix_tolerance: Float. If positive and <stationary> is false, the compressed memory kernel kernel_hmatrix.f64 is used. \
+                     If it does not exist, kernel.f64 is compressed with this relative tolerance per block. \
+                     No effect, if <memory_horizon> is positive. Default: 0.");
+		hmatrix_tolerance = cmdtool.get_double("hmatrix_tolerance", 0.0);
+		cmdtool.add_usage("ff_threads: Integer. If <stationary>=false, number of threads computing the memory integrals of the time steps. \
+                     If zero, all hardware threads are used. Default: 0.");
+		ff_threads = cmdtool.get_int("ff_threads", 0);
 	} catch (const ParameterHandler::BadParamException &ex) {
 		cmdtool.show_usage();
 		throw ex;
@@ -68,12 +85,17 @@ int main(int argc, char *argv[]) {
 	cout << "PARAMETERS: " << endl;
 	cout << "out_folder" << '\t'<< out_folder << endl;
 	cout << "txt_out" << '\t'<< txt_out << endl;
+	cout << "compress" << '\t'<< compress << endl;
 	cout << "gaussian_init_val" << '\t'<< gaussian_init_val << endl;
 	cout << "darboux_sum" << '\t' << darboux_sum << endl;
 	cout << "stationary" << '\t' << stationary << endl;
+	cout << "memory_horizon" << '\t' << memory_horizon << endl;
+	cout << "hmatrix_tolerance" << '\t' << hmatrix_tolerance << endl;
+	cout << "ff_threads" << '\t' << ff_threads << endl;
 
 
 	filesystem::path out_path = out_folder;
+	TensorUtils::Encoding encoding = compress ? TensorUtils::Encoding::compressed : TensorUtils::Encoding::packed;
 
     if(!stationary)
     {
@@ -87,10 +109,6 @@ int main(int argc, char *argv[]) {
         {
             cout << "Unable to read binary. Calculate fluctuating forces." << endl;
 
-            cout << "Load memory kernel from: " << out_path/"kernel.f64" << endl;
-            tensor<double,4> kernel;
-            kernel.read(out_path/"kernel.f64");
-
             cout << "Load trajectories from: " << out_path/"traj.f64" << endl;
             tensor<double,3> trajectories;
             trajectories.read(out_path/"traj.f64");
@@ -99,51 +117,112 @@ int main(int argc, char *argv[]) {
             tensor<double,1> times;
             times.read(out_path/"times.f64");
 
+            tensor<double,4> kernel;
+            HierarchicalKernel hkernel;
+            if(memory_horizon > 0)
+            {
+                cout << "Load band of memory kernel from: " << out_path/"kernel_banded.f64" << endl;
+                kernel.read(out_path/"kernel_banded.f64");
+                if(kernel.shape[1] != memory_horizon+1)
+                {
+                    throw TensorUtils::ErrorHandler::ShapeMismatch("main_fluctuating_forces: Band of memory kernel does not match the memory horizon!");
+                }
+            }
+            else if(hmatrix_tolerance > 0.0)
+            {
+                try
+                {
+                    cout << "Search compressed memory kernel: " << out_path/"kernel_hmatrix.f64" << endl;
+                    hkernel.read(out_path/"kernel_hmatrix.f64");
+                    if(hkernel.num_ts() != times.shape[0] || hkernel.num_obs() != trajectories.shape[2])
+                    {
+                        throw TensorUtils::ErrorHandler::ShapeMismatch("main_fluctuating_forces: Compressed memory kernel does not match the time steps or observables!");
+                    }
+                }
+                catch(exception &ex)
+                {
+                    cout << "Unable to read binary. Compress memory kernel from: " << out_path/"kernel.f64" << endl;
+                    kernel.read(out_path/"kernel.f64");
+                    hkernel = HierarchicalKernel(kernel,hmatrix_tolerance);
+                    kernel.clear();
+                }
+            }
+            else
+            {
+                cout << "Load memory kernel from: " << out_path/"kernel.f64" << endl;
+                kernel.read(out_path/"kernel.f64");
+            }
+
             cout << "Search drift term: " << out_path/"drift.f64" << endl;
             tensor<double,3> drift;
             drift.read(out_path/"drift.f64");
 
             // calculate fluctuating forces
-            fluctuating_force = KernelMethods::getFluctuatingForce(kernel, drift, trajectories, times, darboux_sum);
+            fluctuating_force = KernelMethods::getFluctuatingForce(kernel, drift, trajectories, times, darboux_sum, memory_horizon,
+                                                                     hmatrix_tolerance > 0.0 && memory_horizon == 0 ? &hkernel : nullptr, ff_threads,
+                                                                     memory_horizon > 0);
 
             cout << "Write fluctuating forces." << endl;
             fluctuating_force.write("ff.f64",out_path);
             if(txt_out)
             {
                 filesystem::create_directories(out_path/"FF");
-                tensor<double,2> ff({fluctuating_force.shape[1],fluctuating_force.shape[2]});
                 for(size_t n=0; n<fluctuating_force.shape[0]; n++)
                 {
-                    ff << fluctuating_force(n);
-                    InputOutput::write(times,ff,(out_path/"FF")/("ff_"+to_string(n)+".txt"));
+                    InputOutput::write(times,tensor_view<double>(fluctuating_force).slice({n}),(out_path/"FF")/("ff_"+to_string(n)+".txt"));
                 }
             }
         }
         tensor<double,4> ff_cov;
         tensor<double,2> ff_average;
-        try
+        if(memory_horizon > 0)
         {
-            cout << "Search covariance of fluctuating forces: " << out_path/"ff_cov.f64" << endl;
-            ff_cov.read(out_path/"ff_cov.f64");
-            cout << "Search average of fluctuating forces: " << out_path/"ff_average.f64" << endl;
-            ff_average.read(out_path/"ff_average.f64");
+            try
+            {
+                cout << "Search band of covariance of fluctuating forces: " << out_path/"ff_cov_banded.f64" << endl;
+                ff_cov.read(out_path/"ff_cov_banded.f64");
+                cout << "Search average of fluctuating forces: " << out_path/"ff_average.f64" << endl;
+                ff_average.read(out_path/"ff_average.f64");
+            }
+            catch(exception &ex)
+            {
+                cout << "Unable to read binary." << endl;
+                tensor<double,3> trajectories;
+                if(gaussian_init_val)
+                {
+                    cout << "Load initial values of trajectories from: " << out_path/"traj.f64" << endl;
+                    trajectories.read(out_path/"traj.f64", 1, 0, 1);
+                }
+                cout << "Compute average and band of covariance matrix of fluctuating forces." << endl;
+                KernelMethods::writeBandedCovarianceMatrix(fluctuating_force, memory_horizon, out_path, gaussian_init_val ? &trajectories : nullptr);
+            }
         }
-        catch(exception &ex)
+        else
         {
-            cout << "Unable to read binary." << endl;
-            if(!gaussian_init_val)
+            try
             {
-                cout << "Compute average and covariance matrix of fluctuating forces." << endl;
-                KernelMethods::writeCovarianceMatrix(fluctuating_force, out_path);
+                cout << "Search covariance of fluctuating forces: " << out_path/"ff_cov.f64" << endl;
+                ff_cov.read(out_path/"ff_cov.f64");
+                cout << "Search average of fluctuating forces: " << out_path/"ff_average.f64" << endl;
+                ff_average.read(out_path/"ff_average.f64");
             }
-            else
+            catch(exception &ex)
             {
-                cout << "Load trajectories from: " << out_path/"traj.f64" << endl;
-                tensor<double,3> trajectories;
-                trajectories.read(out_path/"traj.f64");
+                cout << "Unable to read binary." << endl;
+                if(!gaussian_init_val)
+                {
+                    cout << "Compute average and covariance matrix of fluctuating forces." << endl;
+                    KernelMethods::writeCovarianceMatrix(fluctuating_force, out_path, false, encoding);
+                }
+                else
+                {
+                    cout << "Load initial values of trajectories from: " << out_path/"traj.f64" << endl;
+                    tensor<double,3> trajectories;
+                    trajectories.read(out_path/"traj.f64", 1, 0, 1);
 
-                cout << "Compute average and covariance matrix of initial values and fluctuating forces." << endl;
-                KernelMethods::writeExtendedCovarianceMatrix(trajectories, fluctuating_force, out_path);
+                    cout << "Compute average and covariance matrix of initial values and fluctuating forces." << endl;
+                    KernelMethods::writeExtendedCovarianceMatrix(trajectories, fluctuating_force, out_path, false, encoding);
+                }
             }
         }
     }
@@ -176,18 +255,16 @@ int main(int argc, char *argv[]) {
             drift.read(out_path/"drift_stationary.f64");
 
             // calculate fluctuating forces
-            fluctuating_force = KernelMethods::getFluctuatingForce(kernel, drift, trajectories, times, darboux_sum);
+            fluctuating_force = KernelMethods::getFluctuatingForce(kernel, drift, trajectories, times, darboux_sum, memory_horizon);
 
             cout << "Write fluctuating forces." << endl;
             fluctuating_force.write("ff.f64",out_path);
             if(txt_out)
             {
                 filesystem::create_directories(out_path/"FF");
-                tensor<double,2> ff({fluctuating_force.shape[1],fluctuating_force.shape[2]});
                 for(size_t n=0; n<fluctuating_force.shape[0]; n++)
                 {
-                    ff << fluctuating_force(n);
-                    InputOutput::write(times,ff,(out_path/"FF")/("ff_"+to_string(n)+".txt"));
+                    InputOutput::write(times,tensor_view<double>(fluctuating_force).slice({n}),(out_path/"FF")/("ff_"+to_string(n)+".txt"));
                 }
             }
         }
@@ -210,9 +287,9 @@ int main(int argc, char *argv[]) {
             }
             else
             {
-                cout << "Load trajectories from: " << out_path/"traj.f64" << endl;
+                cout << "Load initial values of trajectories from: " << out_path/"traj.f64" << endl;
                 tensor<double,3> trajectories;
-                trajectories.read(out_path/"traj.f64");
+                trajectories.read(out_path/"traj.f64", 1, 0, 1);
 
                 cout << "Compute average and covariance matrix of initial values and fluctuating forces." << endl;
                 KernelMethods::writeExtendedCovarianceMatrix(trajectories, fluctuating_force, out_path, true);
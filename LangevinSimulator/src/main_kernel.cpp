@@ -20,6 +20,7 @@ You should have received a copy of the GNU General Public License along with Lan
 If not, see <https://www.gnu.org/licenses/>.
 **/
 
+#include "GslAdapter.hpp"
 #include "InputOutput.hpp"
 #include "KernelMethods.hpp"
 
@@ -40,7 +41,16 @@ int main(int argc, char** argv) {
 
 	string out_folder;
 	bool txt_out;
+	bool compress;
 	bool stationary;
+	size_t memory_horizon;
+	double hmatrix_tolerance;
+	bool extend_kernel;
+	size_t resampling_blocks;
+	size_t bootstrap_replicas;
+	size_t resampling_threads;
+	bool observable_blocks;
+	size_t block_threads;
 
 	ParameterHandler cmdtool {argc, argv};
 	cmdtool.process_flag_help();
@@ -50,8 +60,37 @@ int main(int argc, char** argv) {
 		out_folder = cmdtool.get_string("out_folder", "./OUT");
         cmdtool.add_usage("txt_out: Boolean. If true, writes output files in text format. Default: true");
         txt_out = cmdtool.get_bool("txt_out", true);
+        cmdtool.add_usage("compress: Boolean. If true, large binary output files are written compressed. They cannot be read by the Python utilities. Default: false");
+        compress = cmdtool.get_bool("compress", false);
 		cmdtool.add_usage("stationary: Boolean. If true, treats the process as stationary. Default: false.");
 		stationary = cmdtool.get_bool("stationary", false);
+		cmdtool.add_usage("memory_horizon: Integer. If positive, the memory kernel K(t,s) is set to zero for t-s > <memory_horizon> time steps \
+                     and the memory integrals are restricted accordingly. If <stationary>=false, only the band of the memory kernel is computed \
+                     from correlation_banded.f64, or from the band of correlation.f64 if the former does not exist, and written to kernel_banded.f64. \
+                     Then, <hmatrix_tolerance> and <extend_kernel> have no effect \
+                     and <memory_horizon> must be smaller than the number of time steps minus one. Default: 0, i.e. unlimited.");
+		memory_horizon = cmdtool.get_int("memory_horizon", 0);
+		cmdtool.add_usage("hmatrix_tolerance: Float. If positive, the non-stationary memory kernel is compressed to a hierarchical low-rank matrix \
+                     with this relative tolerance per block and written to kernel_hmatrix.f64. Default: 0.");
+		hmatrix_tolerance = cmdtool.get_double("hmatrix_tolerance", 0.0);
+		cmdtool.add_usage("extend_kernel: Boolean. If true, the factors of the non-stationary memory kernel are kept in kernel_factors.f64. \
+                     If they stem from a shorter time window with the same time step and leading correlation blocks, as recorded in kernel_factors.txt, \
+                     only the new time rows and columns are computed. Default: false.");
+		extend_kernel = cmdtool.get_bool("extend_kernel", false);
+		cmdtool.add_usage("resampling_blocks: Integer. If positive and <stationary>=false, the trajectories in traj.f64 are split into <resampling_blocks> blocks \
+                     and the errors of the correlation function, drift term and memory kernel are estimated by resampling these blocks. \
+                     If <memory_horizon> is positive, only their bands are resampled. Requires at least two trajectories. Default: 0.");
+		resampling_blocks = cmdtool.get_int("resampling_blocks", 0);
+		cmdtool.add_usage("bootstrap_replicas: Integer. Number of bootstrap replicas. If zero, the jackknife leaves out one block per replica. Default: 0.");
+		bootstrap_replicas = cmdtool.get_int("bootstrap_replicas", 0);
+		cmdtool.add_usage("resampling_threads: Integer. Number of threads computing the replicas. If zero, all hardware threads are used. Default: 0.");
+		resampling_threads = cmdtool.get_int("resampling_threads", 0);
+		cmdtool.add_usage("observable_blocks: Boolean. If true and <stationary>=false, the observable blocks in observable_blocks.txt are treated as uncorrelated. \
+                     The drift term and memory kernel are computed for each block separately and vanish between different blocks. \
+                     Then, <extend_kernel> has no effect. Default: false.");
+		observable_blocks = cmdtool.get_bool("observable_blocks", false);
+		cmdtool.add_usage("block_threads: Integer. Number of threads computing the observable blocks. If zero, all hardware threads are used. Default: 0.");
+		block_threads = cmdtool.get_int("block_threads", 0);
 	} catch (const ParameterHandler::BadParamException &ex) {
 		cmdtool.show_usage();
 		throw ex;
@@ -60,11 +99,123 @@ int main(int argc, char** argv) {
 	cout << "PARAMETERS: " << endl;
 	cout << "out_folder" << '\t'<< out_folder << endl;
 	cout << "txt_out" << '\t'<< txt_out << endl;
+	cout << "compress" << '\t'<< compress << endl;
 	cout << "stationary" << '\t'<< stationary << endl;
+	cout << "memory_horizon" << '\t' << memory_horizon << endl;
+	cout << "hmatrix_tolerance" << '\t' << hmatrix_tolerance << endl;
+	cout << "extend_kernel" << '\t' << extend_kernel << endl;
+	cout << "resampling_blocks" << '\t' << resampling_blocks << endl;
+	cout << "bootstrap_replicas" << '\t' << bootstrap_replicas << endl;
+	cout << "resampling_threads" << '\t' << resampling_threads << endl;
+	cout << "observable_blocks" << '\t' << observable_blocks << endl;
+	cout << "block_threads" << '\t' << block_threads << endl;
 
 	filesystem::path out_path = out_folder;
+	TensorUtils::Encoding encoding = compress ? TensorUtils::Encoding::compressed : TensorUtils::Encoding::packed;
 
-    if(!stationary)
+    if(!stationary && memory_horizon > 0)
+    {
+        TensorUtils::tensor<double,1> times;
+        cout << "Load times from: " << out_path/"times.f64" << endl;
+        times.read(out_path/"times.f64");
+        double dt = times[1]-times[0];
+        if(memory_horizon+1 >= times.shape[0])
+        {
+            throw TensorUtils::ErrorHandler::ShapeMismatch("main_kernel: The memory horizon must be smaller than the number of time steps minus one, set memory_horizon=0 instead!");
+        }
+
+        TensorUtils::tensor<double,4> correlation;
+        try
+        {
+            cout << "Load band of correlation from: " << out_path/"correlation_banded.f64" << endl;
+            correlation.read(out_path/"correlation_banded.f64");
+            if(correlation.shape[1] < memory_horizon+3)
+            {
+                throw TensorUtils::ErrorHandler::ShapeMismatch("main_kernel: Band of correlation is too narrow for the memory horizon!");
+            }
+        }
+        catch(exception &ex)
+        {
+            cout << "Unable to read binary. Load correlation from: " << out_path/"correlation.f64" << endl;
+            TensorUtils::tensor<double,4> dense_correlation;
+            dense_correlation.read(out_path/"correlation.f64");
+            correlation = KernelMethods::getCorrelationBand(dense_correlation,memory_horizon+2);
+        }
+
+        vector<vector<size_t>> blocks;
+        if(observable_blocks)
+        {
+            cout << "Load observable blocks from: " << out_path/"observable_blocks.txt" << endl;
+            blocks = KernelMethods::readObservableBlocks(out_path,correlation.shape[2]);
+            cout << "Number of observable blocks: " << blocks.size() << endl;
+        }
+
+        TensorUtils::tensor<double,3> drift;
+        try
+        {
+            cout << "Search drift term: " << out_path/"drift.f64" << endl;
+            drift.read(out_path/"drift.f64");
+            if(drift.shape[0] != correlation.shape[0])
+            {
+                throw TensorUtils::ErrorHandler::ShapeMismatch("main_kernel: Drift term and correlation differ in the number of time steps!");
+            }
+        }
+        catch(exception &ex)
+        {
+            cout << "Unable to read binary. Calculate drift." << endl;
+            if(blocks.size() > 1)
+            {
+                drift = KernelMethods::getDecoupledBandedDrift(correlation,dt,blocks,block_threads);
+            }
+            else
+            {
+                drift = KernelMethods::getBandedDrift(correlation,dt);
+            }
+            cout << "Write drift term: " << out_path/"drift.f64" << endl;
+            drift.write("drift.f64",out_path);
+            if(txt_out)
+            {
+                InputOutput::write(times,drift,filesystem::path(out_path/"drift.txt"));
+            }
+            drift.clear();
+        }
+
+        TensorUtils::tensor<double,4> memory_kernel;
+        try
+        {
+            cout << "Search band of memory kernel: " << out_path/"kernel_banded.f64" << endl;
+            memory_kernel.read(out_path/"kernel_banded.f64");
+            if(memory_kernel.shape[0] != correlation.shape[0] || memory_kernel.shape[1] != memory_horizon+1)
+            {
+                throw TensorUtils::ErrorHandler::ShapeMismatch("main_kernel: Memory kernel does not match the correlation or the memory horizon!");
+            }
+        }
+        catch(exception &ex)
+        {
+            cout << "Unable to read binary. Calculate band of memory kernel." << endl;
+            if(blocks.size() > 1)
+            {
+                memory_kernel = KernelMethods::getDecoupledBandedMemoryKernel(correlation,dt,memory_horizon,blocks,block_threads);
+            }
+            else
+            {
+                memory_kernel = KernelMethods::getBandedMemoryKernel(correlation,dt,memory_horizon);
+            }
+            cout << "Write band of memory kernel: " << out_path/"kernel_banded.f64" << endl;
+            memory_kernel.write("kernel_banded.f64",out_path,encoding);
+        }
+        correlation.clear();
+        memory_kernel.clear();
+
+        if(resampling_blocks > 0)
+        {
+            TensorUtils::tensor<double,3> traj;
+            cout << "Load trajectories from: " << out_path/"traj.f64" << endl;
+            traj.read(out_path/"traj.f64");
+            KernelMethods::writeResamplingErrors(traj,times,resampling_blocks,bootstrap_replicas,resampling_threads,memory_horizon,out_path,txt_out,true);
+        }
+    }
+    else if(!stationary)
     {
         TensorUtils::tensor<double,4> correlation;
         cout << "Load correlation from: " << out_path/"correlation.f64" << endl;
@@ -74,16 +225,35 @@ int main(int argc, char** argv) {
         cout << "Load times from: " << out_path/"times.f64" << endl;
         times.read(out_path/"times.f64");
 
+        vector<vector<size_t>> blocks;
+        if(observable_blocks)
+        {
+            cout << "Load observable blocks from: " << out_path/"observable_blocks.txt" << endl;
+            blocks = KernelMethods::readObservableBlocks(out_path,correlation.shape[1]);
+            cout << "Number of observable blocks: " << blocks.size() << endl;
+        }
+
         TensorUtils::tensor<double,3> drift;
         try
         {
             cout << "Search drift term: " << out_path/"drift.f64" << endl;
             drift.read(out_path/"drift.f64");
+            if(drift.shape[0] != correlation.shape[0])
+            {
+                throw TensorUtils::ErrorHandler::ShapeMismatch("main_kernel: Drift term and correlation differ in the number of time steps!");
+            }
         }
         catch(exception &ex)
         {
             cout << "Unable to read binary. Calculate drift." << endl;
-            drift = KernelMethods::getDrift(correlation,times[1]-times[0]);
+            if(blocks.size() > 1)
+            {
+                drift = KernelMethods::getDecoupledDrift(correlation,times[1]-times[0],blocks,block_threads);
+            }
+            else
+            {
+                drift = KernelMethods::getDrift(correlation,times[1]-times[0]);
+            }
             cout << "Write drift term: " << out_path/"drift.f64" << endl;
             drift.write("drift.f64",out_path);
             if(txt_out)
@@ -98,27 +268,82 @@ int main(int argc, char** argv) {
         {
             cout << "Search memory kernel: " << out_path/"kernel.f64" << endl;
             memory_kernel.read(out_path/"kernel.f64");
+            if(memory_kernel.shape[0] != correlation.shape[0])
+            {
+                throw TensorUtils::ErrorHandler::ShapeMismatch("main_kernel: Memory kernel and correlation differ in the number of time steps!");
+            }
         }
         catch(exception &ex)
         {
             cout << "Unable to read binary. Calculate memory kernel." << endl;
             size_t num_ts = correlation.shape[0];
             size_t num_obs = correlation.shape[1];
-            size_t num_tot = num_ts*num_obs;
-            gsl_matrix* kernel = gsl_matrix_alloc(num_tot, num_tot);
-            gsl_matrix* corr = gsl_matrix_alloc(num_tot, num_tot);
-            correlation >> *corr->data;
-            KernelMethods::getMemoryKernel(kernel,corr,num_ts,num_obs,times[1]-times[0]);
-            gsl_matrix_free(corr);
-            memory_kernel.alloc({num_ts,num_obs,num_ts,num_obs});
-            memory_kernel << *kernel->data;
-            gsl_matrix_free(kernel);
+            if(blocks.size() > 1)
+            {
+                memory_kernel = KernelMethods::getDecoupledMemoryKernel(correlation,times[1]-times[0],blocks,block_threads);
+            }
+            else if(extend_kernel)
+            {
+                memory_kernel.alloc_uninitialized({num_ts,num_obs,num_ts,num_obs});
+                gsl_matrix_view kernel = GslAdapter::matrix(memory_kernel);
+                gsl_matrix_view corr = GslAdapter::matrix(correlation);  // correlation is destroyed
+                TensorUtils::tensor<double,5> factors;
+                try
+                {
+                    cout << "Search kernel factors: " << out_path/"kernel_factors.f64" << endl;
+                    KernelMethods::readKernelFactors(factors,correlation,times[1]-times[0],out_path);
+                    cout << "Reuse kernel factors of " << factors.shape[1] << " time steps." << endl;
+                }
+                catch(exception &ex)
+                {
+                    cout << ex.what() << endl;
+                    cout << "Unable to reuse binary. Calculate kernel factors." << endl;
+                    factors.clear();
+                }
+                uint64_t checksum = KernelMethods::getCorrelationChecksum(correlation,num_ts);
+                KernelMethods::getMemoryKernel(&kernel.matrix,&corr.matrix,num_ts,num_obs,times[1]-times[0],&factors);
+                cout << "Write kernel factors: " << out_path/"kernel_factors.f64" << endl;
+                KernelMethods::writeKernelFactors(factors,checksum,times[1]-times[0],out_path);
+            }
+            else
+            {
+                memory_kernel.alloc_uninitialized({num_ts,num_obs,num_ts,num_obs});
+                gsl_matrix_view kernel = GslAdapter::matrix(memory_kernel);
+                gsl_matrix_view corr = GslAdapter::matrix(correlation);  // correlation is destroyed
+                KernelMethods::getMemoryKernel(&kernel.matrix,&corr.matrix,num_ts,num_obs,times[1]-times[0]);
+            }
+            correlation.clear();
+            KernelMethods::applyMemoryHorizon(memory_kernel,memory_horizon);
             cout << "Write memory kernel: " << out_path/"kernel.f64" << endl;
             if(txt_out)
             {
                 InputOutput::write(times,memory_kernel,out_path/"kernel.txt");
             }
-            memory_kernel.transpose({0,2,1,3}).write("kernel.f64",out_path);
+            memory_kernel.transpose({0,2,1,3}).write("kernel.f64",out_path,encoding);
+            if(hmatrix_tolerance > 0.0)
+            {
+                TensorUtils::tensor<double,4> buffer;
+                buffer = memory_kernel.transpose({0,2,1,3});
+                memory_kernel = std::move(buffer);
+            }
+        }
+
+        if(hmatrix_tolerance > 0.0)
+        {
+            cout << "Compress memory kernel." << endl;
+            HierarchicalKernel hkernel(memory_kernel,hmatrix_tolerance);
+            cout << "Compression ratio: " << double(hkernel.size())/memory_kernel.size() << endl;
+            memory_kernel.clear();
+            cout << "Write compressed memory kernel: " << out_path/"kernel_hmatrix.f64" << endl;
+            hkernel.write("kernel_hmatrix.f64",out_path);
+        }
+
+        if(resampling_blocks > 0)
+        {
+            TensorUtils::tensor<double,3> traj;
+            cout << "Load trajectories from: " << out_path/"traj.f64" << endl;
+            traj.read(out_path/"traj.f64");
+            KernelMethods::writeResamplingErrors(traj,times,resampling_blocks,bootstrap_replicas,resampling_threads,memory_horizon,out_path,txt_out);
         }
     }
     else
@@ -161,6 +386,7 @@ int main(int argc, char** argv) {
         {
             cout << "Unable to read binary. Calculate memory kernel." << endl;
             memory_kernel = KernelMethods::getMemoryKernel(correlation,dt);
+            KernelMethods::applyMemoryHorizon(memory_kernel,memory_horizon);
             cout << "Write memory kernel: " << out_path/"kernel_stationary.f64" << endl;
             if(txt_out)
             {
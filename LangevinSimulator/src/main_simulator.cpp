@@ -45,10 +45,20 @@ int main(int argc, char *argv[]) {
 	string out_folder;
 	bool shift;
 	bool txt_out;
+	bool compress;
 	bool gaussian_init_val;
 	bool darboux_sum;
 	bool stationary;
 	bool accelerate_stationary_decomp;
+	size_t sim_chunk_size;
+	int rand_ff_out;
+	bool rand_ff_stats;
+	bool sim_correlation;
+	size_t memory_horizon;
+	double exp_fit_tolerance;
+	double hmatrix_tolerance;
+	bool observable_blocks;
+	size_t block_threads;
 
 	ParameterHandler cmdtool {argc, argv};
 	cmdtool.process_flag_help();
@@ -62,6 +72,8 @@ int main(int argc, char *argv[]) {
 		shift = cmdtool.get_bool("shift", true);
 		cmdtool.add_usage("txt_out: Boolean. If true, writes output files in text format. Default: true");
 		txt_out = cmdtool.get_bool("txt_out", true);
+		cmdtool.add_usage("compress: Boolean. If true, large binary output files are written compressed. They cannot be read by the Python utilities. Default: false");
+		compress = cmdtool.get_bool("compress", false);
         cmdtool.add_usage("gaussian_init_val: Boolean. If true, the initial values will be drawn from a Gaussian. \
                           Else, the original initial values will be used for numerical simulations. Default: false");
         gaussian_init_val = cmdtool.get_bool("gaussian_init_val", false);
@@ -76,6 +88,38 @@ int main(int argc, char *argv[]) {
 		cmdtool.add_usage("accelerate_stationary_decomp: Boolean. If true, uses FFT to compute the spectral decomposition \
                      and to draw the fluctuating forces with optimal run-time complexity. \
                     No effect if <stationary> is false or if <gaussian_init_val> is true. Default: false.");
+		cmdtool.add_usage("sim_chunk_size: Number of trajectories which are simulated and written at once. \
+                     Limits the memory requirements for large <num_sim>. If 0, all trajectories are simulated at once. Default: 1000.");
+		sim_chunk_size = cmdtool.get_int("sim_chunk_size", 1000);
+		cmdtool.add_usage("rand_ff_out: Number of realizations of the drawn fluctuating forces which are written to SIM/rand_ff.f64. \
+                     If negative, all realizations are written. Default: -1.");
+		rand_ff_out = cmdtool.get_int("rand_ff_out", -1);
+		cmdtool.add_usage("rand_ff_stats: Boolean. If true, the average and covariance matrix of the drawn fluctuating forces \
+                     are accumulated during the simulation and written to SIM/ff_average.f64 and SIM/ff_cov.f64. Default: false.");
+		rand_ff_stats = cmdtool.get_bool("rand_ff_stats", false);
+		cmdtool.add_usage("sim_correlation: Boolean. If true, the correlation function of the simulated trajectories is accumulated \
+                     during the simulation and written to SIM/correlation.f64 (SIM/correlation_stationary.f64 if <stationary> is true). \
+                     The memory kernel of the simulated trajectories can then be obtained by running main_kernel with <out_folder>/SIM. Default: false.");
+		sim_correlation = cmdtool.get_bool("sim_correlation", false);
+		cmdtool.add_usage("memory_horizon: Integer. If positive, the memory kernel K(t,s) is set to zero for t-s > <memory_horizon> time steps \
+                     and the memory integrals are restricted accordingly. If <stationary>=false, the band of the memory kernel is read from kernel_banded.f64 \
+                     and the fluctuating forces are drawn with the banded rotation matrix ff_decomp_banded.f64, which is computed from ff_cov_banded.f64 \
+                     if it does not exist. Default: 0, i.e. unlimited.");
+		memory_horizon = cmdtool.get_int("memory_horizon", 0);
+		cmdtool.add_usage("exp_fit_tolerance: Float. If positive and <stationary> is true, the memory kernel is fitted by a sum of exponentials \
+                     up to this relative tolerance and the memory integral is evaluated recursively with auxiliary variables. \
+                     Then, the cost per time step does not depend on the history length and <memory_horizon> has no effect. Default: 0.");
+		exp_fit_tolerance = cmdtool.get_double("exp_fit_tolerance", 0.0);
+		cmdtool.add_usage("hmatrix_tolerance: Float. If positive and <stationary> is false, the compressed memory kernel kernel_hmatrix.f64 is used. \
+                     If it does not exist, kernel.f64 is compressed with this relative tolerance per block. \
+                     No effect, if <memory_horizon> is positive. Default: 0.");
+		hmatrix_tolerance = cmdtool.get_double("hmatrix_tolerance", 0.0);
+		cmdtool.add_usage("observable_blocks: Boolean. If true and <stationary>=false, the observable blocks in observable_blocks.txt are treated as uncorrelated. \
+                     The covariance matrix of the fluctuating forces is decomposed for each block separately. \
+                     If <memory_horizon> is positive, the band of the covariance matrix is decoupled between the blocks and decomposed at once. Default: false.");
+		observable_blocks = cmdtool.get_bool("observable_blocks", false);
+		cmdtool.add_usage("block_threads: Integer. Number of threads decomposing the observable blocks. If zero, all hardware threads are used. Default: 0.");
+		block_threads = cmdtool.get_int("block_threads", 0);
 	} catch (const ParameterHandler::BadParamException &ex) {
 		cmdtool.show_usage();
 		throw ex;
@@ -86,17 +130,68 @@ int main(int argc, char *argv[]) {
 	cout << "out_folder" << '\t'<< out_folder << endl;
 	cout << "shift" << '\t'<< shift << endl;
 	cout << "txt_out" << '\t'<< txt_out << endl;
+	cout << "compress" << '\t'<< compress << endl;
 	cout << "gaussian_init_val" << '\t'<< gaussian_init_val << endl;
 	cout << "darboux_sum" << '\t' << darboux_sum << endl;
 	cout << "accelerate_stationary_decomp" << '\t' << accelerate_stationary_decomp << endl;
+	cout << "sim_chunk_size" << '\t' << sim_chunk_size << endl;
+	cout << "rand_ff_out" << '\t' << rand_ff_out << endl;
+	cout << "rand_ff_stats" << '\t' << rand_ff_stats << endl;
+	cout << "sim_correlation" << '\t' << sim_correlation << endl;
+	cout << "memory_horizon" << '\t' << memory_horizon << endl;
+	cout << "exp_fit_tolerance" << '\t' << exp_fit_tolerance << endl;
+	cout << "hmatrix_tolerance" << '\t' << hmatrix_tolerance << endl;
+	cout << "observable_blocks" << '\t' << observable_blocks << endl;
+	cout << "block_threads" << '\t' << block_threads << endl;
 
 	filesystem::path out_path = out_folder;
+	TensorUtils::Encoding encoding = compress ? TensorUtils::Encoding::compressed : TensorUtils::Encoding::packed;
 
     if(!stationary)
     {
+        tensor<double,3> trajectories;
+        cout << "Load initial values of trajectories from: " << out_path/"traj.f64" << endl;
+        trajectories.read(out_path/"traj.f64", 1, 0, 1);
+
+        tensor<double,1> times;
+        cout << "Load times from: " << out_path/"times.f64" << endl;
+        times.read(out_path/"times.f64");
+
         tensor<double,4> kernel;
-        cout << "Load memory kernel from: " << out_path/"kernel.f64" << endl;
-        kernel.read(out_path/"kernel.f64");
+        HierarchicalKernel hkernel;
+        if(memory_horizon > 0)
+        {
+            cout << "Load band of memory kernel from: " << out_path/"kernel_banded.f64" << endl;
+            kernel.read(out_path/"kernel_banded.f64");
+            if(kernel.shape[1] != memory_horizon+1)
+            {
+                throw TensorUtils::ErrorHandler::ShapeMismatch("main_simulator: Band of memory kernel does not match the memory horizon!");
+            }
+        }
+        else if(hmatrix_tolerance > 0.0)
+        {
+            try
+            {
+                cout << "Search compressed memory kernel: " << out_path/"kernel_hmatrix.f64" << endl;
+                hkernel.read(out_path/"kernel_hmatrix.f64");
+                if(hkernel.num_ts() != times.shape[0] || hkernel.num_obs() != trajectories.shape[2])
+                {
+                    throw TensorUtils::ErrorHandler::ShapeMismatch("main_simulator: Compressed memory kernel does not match the time steps or observables!");
+                }
+            }
+            catch(exception &ex)
+            {
+                cout << "Unable to read binary. Compress memory kernel from: " << out_path/"kernel.f64" << endl;
+                kernel.read(out_path/"kernel.f64");
+                hkernel = HierarchicalKernel(kernel,hmatrix_tolerance);
+                kernel.clear();
+            }
+        }
+        else
+        {
+            cout << "Load memory kernel from: " << out_path/"kernel.f64" << endl;
+            kernel.read(out_path/"kernel.f64");
+        }
 
         tensor<double,3> drift;
         cout << "Load drift from: " << out_path/"drift.f64" << endl;
@@ -106,14 +201,6 @@ int main(int argc, char *argv[]) {
         cout << "Load ff_average from: " << out_path/"ff_average.f64" << endl;
         ff_average.read(out_path/"ff_average.f64");
 
-        tensor<double,3> trajectories;
-        cout << "Load trajectories from: " << out_path/"traj.f64" << endl;
-        trajectories.read(out_path/"traj.f64");
-
-        tensor<double,1> times;
-        cout << "Load times from: " << out_path/"times.f64" << endl;
-        times.read(out_path/"times.f64");
-
         tensor<double,1> mean_initial_value;
         if(shift)
         {
@@ -123,55 +210,89 @@ int main(int argc, char *argv[]) {
 
         cout << "Initialize random force generator." << endl;
         RandomForceGenerator rfg;
-        try
+        if(memory_horizon > 0)
         {
-            tensor<double,4> ff_decomp;
-            cout << "Load rotation matrix from: " << out_path/"ff_decomp.f64" << endl;
-            ff_decomp.read(out_path/"ff_decomp.f64");
+            try
+            {
+                tensor<double,4> ff_decomp;
+                cout << "Load banded rotation matrix from: " << out_path/"ff_decomp_banded.f64" << endl;
+                ff_decomp.read(out_path/"ff_decomp_banded.f64");
 
-            rfg.init_decomp(ff_average,ff_decomp);
+                rfg.init_banded_decomp(ff_average,ff_decomp);
+            }
+            catch(exception &ex)
+            {
+                cout << "Unable to load rotation matrix." << endl;
+
+                tensor<double,4> ff_cov;
+                cout << "Load band of covariance matrix of fluctuating forces from: " << out_path/"ff_cov_banded.f64" << endl;
+                ff_cov.read(out_path/"ff_cov_banded.f64");
+
+                vector<vector<size_t>> blocks;
+                if(observable_blocks)
+                {
+                    cout << "Load observable blocks from: " << out_path/"observable_blocks.txt" << endl;
+                    blocks = KernelMethods::readObservableBlocks(out_path,ff_cov.shape[2]);
+                }
+                rfg.init_banded_cov(ff_average,ff_cov,out_path,observable_blocks ? &blocks : nullptr);
+            }
             ff_average.clear();
-            ff_decomp.clear();
         }
-        catch(exception &ex)
+        else
         {
-            cout << "Unable to load rotation matrix." << endl;
+            try
+            {
+                tensor<double,4> ff_decomp;
+                cout << "Load rotation matrix from: " << out_path/"ff_decomp.f64" << endl;
+                ff_decomp.read(out_path/"ff_decomp.f64");
+
+                rfg.init_decomp(ff_average,ff_decomp);
+                ff_average.clear();
+                ff_decomp.clear();
+            }
+            catch(exception &ex)
+            {
+                cout << "Unable to load rotation matrix." << endl;
 
-            tensor<double,4> ff_cov;
-            cout << "Load covariance matrix of fluctuating forces from: " << out_path/"ff_cov.f64" << endl;
-            ff_cov.read(out_path/"ff_cov.f64");
+                tensor<double,4> ff_cov;
+                cout << "Load covariance matrix of fluctuating forces from: " << out_path/"ff_cov.f64" << endl;
+                ff_cov.read(out_path/"ff_cov.f64");
 
-            rfg.init_cov(ff_average,ff_cov,out_path);
-            ff_average.clear();
-            ff_cov.clear();
+                vector<vector<size_t>> blocks;
+                if(observable_blocks)
+                {
+                    cout << "Load observable blocks from: " << out_path/"observable_blocks.txt" << endl;
+                    blocks = KernelMethods::readObservableBlocks(out_path,ff_cov.shape[1]);
+                }
+                rfg.init_cov(ff_average,ff_cov,out_path,encoding,observable_blocks ? &blocks : nullptr,block_threads);
+                ff_average.clear();
+                ff_cov.clear();
+            }
         }
 
         cout << "Draw fluctuating forces and simulate trajectories." << endl;
-        tensor<double,3> sim = KernelMethods::simulateTrajectories(
+        KernelMethods::simulateTrajectories(
             trajectories,
             drift,
             kernel,
             mean_initial_value,
             rfg,
-            times[1]-times[0],
+            times,
             shift,
             gaussian_init_val,
             darboux_sum,
             num_sim,
-            out_path);
-        cout << "Write simulated trajectories: " << (out_path/"SIM")/"traj.f64" << endl;
-        sim.write("traj.f64",out_path/"SIM");
+            out_path,
+            txt_out,
+            sim_chunk_size,
+            rand_ff_out,
+            rand_ff_stats,
+            sim_correlation,
+            memory_horizon,
+            hmatrix_tolerance > 0.0 && memory_horizon == 0 ? &hkernel : nullptr,
+            memory_horizon > 0);
         cout << "Write times: " << (out_path/"SIM")/"times.f64" << endl;
         times.write("times.f64",out_path/"SIM");
-        if(txt_out)
-        {
-            tensor<double,2> sim_traj({sim.shape[1],sim.shape[2]});
-            for(size_t n=0;n<num_sim;n++)
-            {
-                sim_traj << sim(n);
-                InputOutput::write(times,sim_traj,(out_path/"SIM")/("sim_"+to_string(n)+".txt"));
-            }
-        }
     }
     else
     {
@@ -188,8 +309,8 @@ int main(int argc, char *argv[]) {
         ff_average.read(out_path/"ff_average.f64");
 
         tensor<double,3> trajectories;
-        cout << "Load trajectories from: " << out_path/"traj.f64" << endl;
-        trajectories.read(out_path/"traj.f64");
+        cout << "Load initial values of trajectories from: " << out_path/"traj.f64" << endl;
+        trajectories.read(out_path/"traj.f64", 1, 0, 1);
 
         tensor<double,1> times;
         cout << "Load times from: " << out_path/"times.f64" << endl;
@@ -242,7 +363,7 @@ int main(int argc, char *argv[]) {
                             }
                         }
                     }
-                    rfg.init_cov(ff_average,ff_cov,out_path);
+                    rfg.init_cov(ff_average,ff_cov,out_path,encoding);
                     ff_cov.clear();
                 }
                 else
@@ -283,39 +404,50 @@ int main(int argc, char *argv[]) {
                 }
                 ff_cov_extended.clear();
 
-                rfg.init_cov(ff_average,ff_cov,out_path);
+                rfg.init_cov(ff_average,ff_cov,out_path,encoding);
                 ff_cov.clear();
             }
             ff_average.clear();
         }
 
+        MarkovianEmbedding *embedding = nullptr;
+        if(exp_fit_tolerance > 0.0)
+        {
+            cout << "Fit memory kernel with a sum of exponentials." << endl;
+            embedding = new MarkovianEmbedding(kernel,exp_fit_tolerance);
+            cout << "Number of exponentials: " << embedding->order() << endl;
+            cout << "Relative error of fit: " << embedding->error() << endl;
+            cout << "Spectral radius: " << embedding->spectral_radius() << endl;
+            if(embedding->spectral_radius() > 1.0)
+            {
+                cout << "Warning: The auxiliary variables are unstable. Decrease <exp_fit_tolerance>." << endl;
+            }
+        }
+
         cout << "Draw fluctuating forces and simulate trajectories." << endl;
-        tensor<double,3> sim = KernelMethods::simulateTrajectories(
+        KernelMethods::simulateTrajectories(
             trajectories,
             drift,
             kernel,
             mean_initial_value,
             rfg,
-            times[1]-times[0],
+            times,
             shift,
             gaussian_init_val,
             darboux_sum,
             num_sim,
             out_path,
-            accelerate_stationary_decomp);
-        cout << "Write simulated trajectories: " << (out_path/"SIM")/"traj.f64" << endl;
-        sim.write("traj.f64",out_path/"SIM");
+            accelerate_stationary_decomp,
+            txt_out,
+            sim_chunk_size,
+            rand_ff_out,
+            rand_ff_stats,
+            sim_correlation,
+            memory_horizon,
+            embedding);
+        delete embedding;
         cout << "Write times: " << (out_path/"SIM")/"times.f64" << endl;
         times.write("times.f64",out_path/"SIM");
-        if(txt_out)
-        {
-            tensor<double,2> sim_traj({sim.shape[1],sim.shape[2]});
-            for(size_t n=0;n<num_sim;n++)
-            {
-                sim_traj << sim(n);
-                InputOutput::write(times,sim_traj,(out_path/"SIM")/("sim_"+to_string(n)+".txt"));
-            }
-        }
     }
 
     cout << "END: main_simulator" << endl << endl;
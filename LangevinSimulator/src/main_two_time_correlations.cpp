@@ -27,6 +27,7 @@ If not, see <https://www.gnu.org/licenses/>.
 #include "TensorUtils.hpp"
 #include "FourierTransforms.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -56,9 +57,13 @@ int main(int argc, char** argv) {
 	string out_folder;
 	bool shift;
 	bool txt_out;
+	bool compress;
 	size_t mollifier_width;
 	bool stationary;
 	size_t chop_stationary_trajectories;
+	bool incremental;
+	double block_tolerance;
+	size_t memory_horizon;
 
 	ParameterHandler cmdtool {argc, argv};
 	cmdtool.process_flag_help();
@@ -74,12 +79,22 @@ int main(int argc, char** argv) {
 		cmdtool.add_usage("out_folder: Default: ./OUT");
 		cmdtool.add_usage("shift: Boolean. If true, the average initial value is subtracted. No effect, if false. Default: true");
 		cmdtool.add_usage("txt_out: Boolean. If true, writes output files in text format. Default: true");
+		cmdtool.add_usage("compress: Boolean. If true, large binary output files are written compressed. They cannot be read by the Python utilities. Default: false");
 		cmdtool.add_usage("mollifier_width: unsigned integer. Total width of the mollifier is 2*<mollifier_width> time-steps. \
                     No effect, if <mollifier_width> is set to zero. If <mollifier_width> is positive, all input trajectories will be mollified.");
 		cmdtool.add_usage("stationary: Boolean. If true, treats the process as stationary. Default: false.");
 		cmdtool.add_usage("chop_stationary_trajectories: Unsigned integer. No effect, if <chop_stationary_trajectories>=0 or <stationary>=false. \
                     Chops the trajectories into smaller pieces with size <chop_stationary_trajectories>, \
                     but uses the 'unchopped' trajectories to compute the correlation function. Default: 0.");
+		cmdtool.add_usage("incremental: Boolean. If true and <stationary>=false, the sums of the trajectories and of their outer products \
+                    and the list of ingested files are kept in <out_folder>. Only files, which entered or left <file_range> since the last run, are read \
+                    and the correlation function is updated accordingly. Default: false.");
+		cmdtool.add_usage("block_tolerance: Float. If positive and <stationary>=false, observables whose normalized correlation stays below this tolerance \
+                    are assigned to different blocks, which are written to observable_blocks.txt. \
+                    main_kernel and main_simulator treat the blocks separately, if <observable_blocks>=true. Default: 0.");
+		cmdtool.add_usage("memory_horizon: Integer. If positive and <stationary>=false, only the band C(t,s) with |t-s| <= <memory_horizon>+2 of the correlation function \
+                    is computed, as required by main_kernel for the same <memory_horizon>, and written to correlation_banded.f64 instead of correlation.f64. \
+                    Then, <block_tolerance> has no effect. No effect, if <incremental>=true. Default: 0, i.e. unlimited.");
 		// TODO parameters for choosing a certain file set
 
 		in_folder = cmdtool.get_string("in_folder","./TEST_DATA");
@@ -92,9 +107,13 @@ int main(int argc, char** argv) {
 		out_folder = cmdtool.get_string("out_folder", "./OUT");
 		shift = cmdtool.get_bool("shift", true);
 		txt_out = cmdtool.get_bool("txt_out", true);
+		compress = cmdtool.get_bool("compress", false);
 		mollifier_width = cmdtool.get_int("mollifier_width", 0);
 		stationary = cmdtool.get_bool("stationary", false);
 		chop_stationary_trajectories = cmdtool.get_int("chop_stationary_trajectories", 0);
+		incremental = cmdtool.get_bool("incremental", false);
+		block_tolerance = cmdtool.get_double("block_tolerance", 0.0);
+		memory_horizon = cmdtool.get_int("memory_horizon", 0);
 
 	} catch (const ParameterHandler::BadParamException &ex) {
 		cmdtool.show_usage();
@@ -111,11 +130,16 @@ int main(int argc, char** argv) {
 	cout << "out_folder" << '\t'<< out_folder << endl;
 	cout << "shift" << '\t'<< shift << endl;
 	cout << "txt_out" << '\t'<< txt_out << endl;
+	cout << "compress" << '\t'<< compress << endl;
 	cout << "mollifier_width" << '\t'<< mollifier_width << endl;
 	cout << "stationary" << '\t'<< stationary << endl;
 	cout << "chop_stationary_trajectories" << '\t'<< chop_stationary_trajectories << endl;
+	cout << "incremental" << '\t'<< incremental << endl;
+	cout << "block_tolerance" << '\t'<< block_tolerance << endl;
+	cout << "memory_horizon" << '\t'<< memory_horizon << endl;
 
 	filesystem::path out_path = out_folder;
+	TensorUtils::Encoding encoding = compress ? TensorUtils::Encoding::compressed : TensorUtils::Encoding::packed;
 	filesystem::path in_path = in_folder;
 
     /**
@@ -126,6 +150,174 @@ int main(int argc, char** argv) {
     vector<size_t> unchopped_shape;
     vector<size_t> chopped_shape;
 
+    /**
+        INCREMENTAL UPDATE OF THE CORRELATION FUNCTION
+    **/
+    if(incremental && !stationary)
+    {
+        stringstream settings;
+        settings << in_prefix << ' ' << t_min << ' ' << t_max << ' ' << increment << ' ' << num_obs << ' ' << mollifier_width << ' ' << shift;
+        vector<string> data_files = InputOutput::getDataFilenames(file_range, in_path, in_prefix);
+        vector<string> ingested_files;
+        TensorUtils::tensor<double,2> sum;
+        TensorUtils::tensor<double,4> sum_outer;
+        try
+        {
+            cout << "Search ingested files: " << out_path/"ingested_files.txt" << endl;
+            ifstream in(out_path/"ingested_files.txt");
+            string line;
+            if(!getline(in,line) || line != settings.str())
+            {
+                throw TensorUtils::ErrorHandler::CorruptFile("main_two_time_correlations: Files were ingested with different parameters!");
+            }
+            while(getline(in,line))
+            {
+                ingested_files.push_back(line);
+            }
+            cout << "Search sums: " << out_path/"moments_sum.f64" << endl;
+            sum.read(out_path/"moments_sum.f64");
+            sum_outer.read(out_path/"moments_sum_outer.f64");
+            traj.read(out_path/"traj.f64");
+            times.read(out_path/"times.f64");
+            if(traj.shape[0]!=ingested_files.size() || traj.shape[1]!=sum.shape[0] || traj.shape[2]!=sum.shape[1]
+               || times.size()!=sum.shape[0] || sum_outer.size()!=sum.size()*sum.size())
+            {
+                throw TensorUtils::ErrorHandler::ShapeMismatch("main_two_time_correlations: Stored sums and trajectories do not match!");
+            }
+            if(shift)
+            {
+                // THE STORED TRAJECTORIES ARE SHIFTED BY THE PREVIOUS MEAN INITIAL VALUE
+                TensorUtils::tensor<double,1> mean_initial_value;
+                mean_initial_value.read(out_path/"mean_initial_value.f64");
+                for(size_t k=0; k<traj.size(); k++)
+                {
+                    traj[k] += mean_initial_value[k%traj.shape[2]];
+                }
+            }
+        }
+        catch(exception &ex)
+        {
+            cout << "Unable to read sums. Ingest all files." << endl;
+            ingested_files.clear();
+            traj.clear();
+            sum.clear();
+            sum_outer.clear();
+        }
+
+        set<string> requested(data_files.begin(), data_files.end());
+        set<string> known(ingested_files.begin(), ingested_files.end());
+        vector<size_t> kept;
+        vector<size_t> removed;
+        for(size_t n=0; n<ingested_files.size(); n++)
+        {
+            (requested.count(ingested_files[n])>0 ? kept : removed).push_back(n);
+        }
+        vector<string> new_files;
+        for(string &file : data_files)
+        {
+            if(known.count(file)==0)
+            {
+                new_files.push_back(file);
+            }
+        }
+        cout << "Kept files: " << kept.size() << ", removed files: " << removed.size() << ", new files: " << new_files.size() << endl;
+
+        size_t traj_size = traj.shape[1]*traj.shape[2];
+        if(kept.size()==0)
+        {
+            sum.clear();
+            sum_outer.clear();
+        }
+        else if(removed.size()>0)
+        {
+            // DOWNDATE THE SUMS BY THE TRAJECTORIES, WHICH LEFT THE FILE RANGE
+            TensorUtils::tensor<double,3> samples;
+            samples.alloc_uninitialized({removed.size(),traj.shape[1],traj.shape[2]});
+            for(size_t n=0; n<removed.size(); n++)
+            {
+                copy(&traj[removed[n]*traj_size],&traj[removed[n]*traj_size]+traj_size,&samples[n*traj_size]);
+            }
+            KernelMethods::accumulateMoments(samples,sum,sum_outer,-1.0);
+        }
+        TensorUtils::tensor<double,3> new_traj;
+        if(new_files.size()>0)
+        {
+            cout << "Read new trajectories from text files." << endl;
+            new_traj = InputOutput::readTrajectories(new_files,t_min,t_max,increment,num_obs);
+            TensorUtils::tensor<double,1> new_times = InputOutput::popTimes(new_traj);
+            if(mollifier_width>1)
+            {
+                cout << "Mollify new trajectories." << endl;
+                KernelMethods::mollifyTrajectories(new_times,new_traj,mollifier_width);
+            }
+            if(kept.size()>0 && (new_traj.shape[1]!=traj.shape[1] || new_traj.shape[2]!=traj.shape[2]))
+            {
+                throw TensorUtils::ErrorHandler::ShapeMismatch("main_two_time_correlations: New trajectories differ in the number of time steps or observables!");
+            }
+            times = std::move(new_times);
+            KernelMethods::accumulateMoments(new_traj,sum,sum_outer);
+        }
+        if(kept.size()+new_traj.shape[0]==0)
+        {
+            throw TensorUtils::ErrorHandler::ShapeMismatch("main_two_time_correlations: No trajectories in file range!");
+        }
+
+        // KEPT TRAJECTORIES FIRST, NEW TRAJECTORIES LAST
+        TensorUtils::tensor<double,3> all_traj;
+        all_traj.alloc_uninitialized({kept.size()+new_traj.shape[0],sum.shape[0],sum.shape[1]});
+        vector<string> all_files;
+        traj_size = sum.size();
+        for(size_t n=0; n<kept.size(); n++)
+        {
+            copy(&traj[kept[n]*traj_size],&traj[kept[n]*traj_size]+traj_size,&all_traj[n*traj_size]);
+            all_files.push_back(ingested_files[kept[n]]);
+        }
+        if(new_files.size()>0)
+        {
+            copy(&new_traj[0],&new_traj[0]+new_traj.size(),&all_traj[kept.size()*traj_size]);
+            all_files.insert(all_files.end(),new_files.begin(),new_files.end());
+        }
+        traj = std::move(all_traj);
+        new_traj.clear();
+
+        cout << "Write ingested files: " << out_path/"ingested_files.txt" << endl;
+        filesystem::create_directories(out_path);
+        ofstream out(out_path/"ingested_files.txt");
+        out << settings.str() << endl;
+        for(string &file : all_files)
+        {
+            out << file << endl;
+        }
+        out.close();
+        cout << "Write sums: " << out_path/"moments_sum.f64" << endl;
+        sum.write("moments_sum.f64",out_path);
+        sum_outer.write("moments_sum_outer.f64",out_path,encoding);
+        KernelMethods::writeEnsembleCorrelation(sum,sum_outer,traj.shape[0],times,out_path,shift,txt_out,false);
+        if(block_tolerance > 0.0)
+        {
+            sum_outer.clear();
+            TensorUtils::tensor<double,4> correlation;
+            correlation.read(out_path/"correlation.f64");
+            vector<vector<size_t>> blocks = KernelMethods::getObservableBlocks(correlation,block_tolerance);
+            cout << "Number of observable blocks: " << blocks.size() << endl;
+            KernelMethods::writeObservableBlocks(blocks,correlation.shape[1],out_path);
+        }
+        if(shift)
+        {
+            for(size_t k=0; k<traj.size(); k++)
+            {
+                traj[k] -= sum[k%traj.shape[2]]/traj.shape[0];
+            }
+        }
+        cout << "Write trajectories: " << out_path/"traj.f64" << endl;
+        traj.write("traj.f64",out_path);
+        cout << "Write times: " << out_path/"times.f64" << endl;
+        times.write("times.f64",out_path);
+
+        cout << "END: main_two_time_correlations" << endl << endl;
+        return 0;
+    }
+
     try
     {
         cout << "Search trajectories: " << out_path/"traj.f64" << endl;
@@ -164,26 +356,17 @@ int main(int argc, char** argv) {
                 }
                 else
                 {
-                    TensorUtils::tensor<double,3> buffer({traj.shape[0],traj.shape[1]-traj.shape[1]%chop_stationary_trajectories,traj.shape[2]});
-                    for(size_t n=0; n< buffer.shape[0]; n++)
-                    {
-                        for(size_t t=0; t<buffer.shape[1]; t++)
-                        {
-                            for(size_t o=0; o<buffer.shape[2]; o++)
-                            {
-                                buffer(n,t,o) = traj(n,t,o);
-                            }
-                        }
-                    }
-                    traj = buffer;
-                    buffer.clear();
+                    // drop the last time steps in place
+                    TensorUtils::tensor_view<double> buffer = TensorUtils::tensor_view<double>(traj).range(1,0,traj.shape[1]-traj.shape[1]%chop_stationary_trajectories);
+                    buffer.copy_to(&traj[0]);
+                    traj.resize(buffer.size());
+                    traj.reshape(buffer.shape);
                     unchopped_shape = traj.shape;
                     chopped_shape = {traj.shape[0]*(traj.shape[1]/chop_stationary_trajectories),chop_stationary_trajectories,traj.shape[2]};
                     traj.reshape(chopped_shape);
                     TensorUtils::tensor<double,1> new_times({traj.shape[1]});
                     new_times << times[0];
-                    times = new_times;
-                    new_times.clear();
+                    times = std::move(new_times);
                 }
             }
         }
@@ -206,7 +389,27 @@ int main(int argc, char** argv) {
     /**
         CORRELATION FUNCTION
     **/
-    if(!stationary)
+    if(!stationary && memory_horizon > 0)
+    {
+        TensorUtils::tensor<double,4> correlation;
+        try
+        {
+            cout << "Search band of correlation function: " << out_path/"correlation_banded.f64" << endl;
+            correlation.read(out_path/"correlation_banded.f64");
+            if(correlation.shape[0] != traj.shape[1] || correlation.shape[1] < memory_horizon+3)
+            {
+                throw TensorUtils::ErrorHandler::ShapeMismatch("main_two_time_correlations: Band of correlation function is too narrow!");
+            }
+        }
+        catch(exception &ex)
+        {
+            cout << "Unable to read binary. Calculate band of correlation function." << endl;
+            correlation = KernelMethods::getBandedCorrelationFunction(traj,memory_horizon+2);
+            cout << "Write band of correlation function: " << out_path/"correlation_banded.f64" << endl;
+            correlation.write("correlation_banded.f64",out_path,encoding);
+        }
+    }
+    else if(!stationary)
     {
         TensorUtils::tensor<double,4> correlation;
         try
@@ -219,12 +422,18 @@ int main(int argc, char** argv) {
             cout << "Unable to read binary. Calculate correlation function." << endl;
             correlation = KernelMethods::getCorrelationFunction(traj);
             cout << "Write correlation function: " << out_path/"correlation.f64" << endl;
-            correlation.write("correlation.f64",out_path);
+            correlation.write("correlation.f64",out_path,encoding);
             if(txt_out)
             {
                 InputOutput::write(times,correlation,out_path/"correlation.txt");
             }
         }
+        if(block_tolerance > 0.0)
+        {
+            vector<vector<size_t>> blocks = KernelMethods::getObservableBlocks(correlation,block_tolerance);
+            cout << "Number of observable blocks: " << blocks.size() << endl;
+            KernelMethods::writeObservableBlocks(blocks,correlation.shape[1],out_path);
+        }
     }
     else
     {
@@ -256,8 +465,7 @@ int main(int argc, char** argv) {
                         }
                     }
                 }
-                correlation = buffer;
-                buffer.clear();
+                correlation = std::move(buffer);
             }
             cout << "Write correlation function: " << out_path/"correlation_stationary.f64" << endl;
             correlation.write("correlation_stationary.f64",out_path);
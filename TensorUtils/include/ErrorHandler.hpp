@@ -37,8 +37,8 @@ namespace TensorUtils
         \brief This namespace contains error handler classes that inherit from "std::runtime_error".
         Most error handling is enabled only for the debug library "libtensor_utilsd.so".
 
-        TensorUtils provides error handling to trace down rank or shape mismatches, invalid indices
-        and invalid file paths.
+        TensorUtils provides error handling to trace down rank or shape mismatches, invalid indices,
+        invalid file paths and corrupted files.
     */
     namespace ErrorHandler
     {
@@ -58,6 +58,17 @@ namespace TensorUtils
             explicit UnableToOpenFile (const std::string& what_arg) : std::runtime_error(what_arg) {};
         };
 
+        //! This error is thrown, if a binary file has an invalid header, is truncated or fails its checksums. Inherits from std::runtime_error.
+        /*!
+            See \ref ErrorHandler for details.
+        */
+        class CorruptFile : public std::runtime_error
+        {
+            public:
+            //! Constructor inherited from std::runtime_error.
+            explicit CorruptFile (const std::string& what_arg) : std::runtime_error(what_arg) {};
+        };
+
         //! This error is thrown if any tensor operation is called with invalid shapes or an invalid number of indices. Inherits from std::runtime_error.
         /*! If an index is out of range, std::out_of_range is thrown instead.
             Invalid usage of tensors with fixed ranks have their own error class \ref RankMismatch.
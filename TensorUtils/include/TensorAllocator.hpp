@@ -0,0 +1,122 @@
+/**
+\internal
+    TensorUtils Version 0.1
+
+    Copyright 2022 Christoph Widder
+
+    This file is part of TensorUtils.
+
+    TensorUtils is free software: you can redistribute it and/or modify it under the terms of
+    the GNU General Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    TensorUtils is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+    without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+    PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with TensorUtils.
+    If not, see <https://www.gnu.org/licenses/>.
+\endinternal
+**/
+
+#ifndef TENSORALLOCATOR_HPP
+#define TENSORALLOCATOR_HPP
+
+#include <memory>
+#include <new>
+#include <utility>
+#include <cstddef>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace TensorUtils
+{
+    /*!
+        \addtogroup TensorUtils
+        @{
+    */
+
+    //! This class defines the allocator of the components of \ref TensorBase.
+    /*!
+        It behaves like std::allocator<T>, except for the following points:
+        - Components constructed without arguments are default-initialized instead of value-initialized.
+          Hence, `resize(n)` of the underlying container leaves new components of arithmetic type uninitialized,
+          while `resize(n, val)` still initializes them with `val`. See also \ref TensorBase<T>::alloc_uninitialized.
+        - The memory is aligned to \ref alignment bytes, i.e. to a cache line and to the widest SIMD registers.
+        - Allocations of at least \ref huge_page_size bytes are aligned to \ref huge_page_size and,
+          on Linux, advised to be backed by transparent huge pages. This reduces TLB misses of large tensors.
+    */
+    template<class T>
+    class TensorAllocator : public std::allocator<T>
+    {
+        public:
+            //! \private
+            template<class U>
+            struct rebind
+            {
+                typedef TensorAllocator<U> other;
+            };
+
+            //! \private
+            TensorAllocator() noexcept {}
+
+            //! \private
+            template<class U>
+            TensorAllocator(const TensorAllocator<U> &other) noexcept : std::allocator<T>(other) {}
+
+            //! Alignment of all allocations in bytes.
+            static constexpr std::size_t alignment = 64;
+
+            //! Allocations of at least this number of bytes are backed by huge pages.
+            static constexpr std::size_t huge_page_size = std::size_t(1) << 21;
+
+            //! Allocates uninitialized memory for `num` objects of type T.
+            T* allocate(std::size_t num)
+            {
+                if(num > std::size_t(-1)/sizeof(T))
+                {
+                    throw std::bad_array_new_length();
+                }
+                std::size_t num_bytes = num*sizeof(T);
+                void* ptr = ::operator new(num_bytes, std::align_val_t(get_alignment(num_bytes)));
+                #if defined(MADV_HUGEPAGE)
+                if(num_bytes >= huge_page_size)
+                {
+                    madvise(ptr, num_bytes, MADV_HUGEPAGE); // only a hint, failure is harmless
+                }
+                #endif
+                return static_cast<T*>(ptr);
+            }
+
+            //! Deallocates the memory at `ptr`, which was obtained by allocate(num).
+            void deallocate(T* ptr, std::size_t num) noexcept
+            {
+                ::operator delete(ptr, std::align_val_t(get_alignment(num*sizeof(T))));
+            }
+
+            //! Default-initializes the object at `ptr`.
+            template<class U>
+            void construct(U* ptr)
+            {
+                ::new(static_cast<void*>(ptr)) U;
+            }
+
+            //! Constructs the object at `ptr` from `args`.
+            template<class U, class... Args>
+            void construct(U* ptr, Args&&... args)
+            {
+                ::new(static_cast<void*>(ptr)) U(std::forward<Args>(args)...);
+            }
+
+        private:
+            static constexpr std::size_t get_alignment(std::size_t num_bytes)
+            {
+                return num_bytes >= huge_page_size ? huge_page_size : alignment;
+            }
+    };
+    /*! @} */
+}
+
+#endif // TENSORALLOCATOR_HPP
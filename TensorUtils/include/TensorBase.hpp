@@ -22,22 +22,36 @@
 #ifndef TENSORBASE_HPP
 #define TENSORBASE_HPP
 
+#include "TensorAllocator.hpp"
+#include "TensorExpression.hpp"
+
 #include <vector>
 #include <string>
 
 namespace TensorUtils
 {
+    //! Encoding of the payload of binary files, see \ref TensorBase<T>::write(std::string,std::string,Encoding).
+    enum class Encoding
+    {
+        raw,        //!< The components are stored as they are.
+        packed,     //!< As \ref raw, but symmetric tensors store their upper triangle only.
+        compressed  //!< The components are stored in chunks, which are byte-shuffled and compressed.
+    };
+
     /*!
         \brief This is the main class of this project.
-        It inherits from std::vector<T> and adds methods to make it a tensor.
+        It inherits from std::vector<T, TensorAllocator<T>> and adds methods to make it a tensor.
     */
     template<class T>
-    class TensorBase : public std::vector<T>
+    class TensorBase : public std::vector<T, TensorAllocator<T>>
     {
         public:
 
+            //! Type of the underlying container.
+            typedef std::vector<T, TensorAllocator<T>> storage_type;
+
             // avoid name hiding of base class constructors
-            using std::vector<T>::vector;
+            using std::vector<T, TensorAllocator<T>>::vector;
 
             /*!
                 Empty constructor.
@@ -92,9 +106,65 @@ namespace TensorUtils
             */
             TensorBase(const std::vector<size_t> &shape, const T& val);
 
+            /*!
+                Constructor. Evaluates the element-wise expression `rhs`. See \ref TensorExpression.
+                \code
+                #include "TensorUtils.hpp"
+
+                int main()
+                {
+                    TensorUtils::tensor<double> foo({2,3,5,7},1.0);
+                    TensorUtils::tensor<double> bar(foo+2.0*foo);
+
+                    return 0;
+                }
+                \endcode
+            */
+            template<class E>
+            TensorBase(const TensorExpression<E> &rhs) : storage_type()
+            {
+                const E &expr = rhs.expression();
+                shape = expr.tensor().shape;
+                incr = expr.tensor().incr;
+                storage_type::resize(expr.size());
+                T* ptr = storage_type::data();
+                for(size_t n=0; n<expr.size(); n++)
+                {
+                    ptr[n] = T(expr[n]);
+                }
+            }
+
+            //! Copy constructor.
+            TensorBase(const TensorBase<T> &rhs) = default;
+
+            //! Move constructor. Takes over the memory of `rhs` without copying any component.
+            TensorBase(TensorBase<T> &&rhs) = default;
+
             //! \private
             virtual ~TensorBase();
 
+            //! Copy assignment.
+            TensorBase<T>& operator= (const TensorBase<T> &rhs) = default;
+
+            /*!
+                Move assignment. Takes over the memory of `rhs` without copying any component.
+                \code
+                #include "TensorUtils.hpp"
+
+                int main()
+                {
+                    TensorUtils::tensor<double> foo({2,3,5,7},1.0);
+                    TensorUtils::tensor<double> bar;
+
+                    bar = std::move(foo);               // no copy
+                    bar = bar.transpose({3,2,1,0});     // no copy of the returned tensor
+
+                    return 0;
+                }
+                \endcode
+            */
+            TensorBase<T>& operator= (TensorBase<T> &&rhs) = default;
+
             /*!
                 Allocates the necessary memory and initializes \ref shape and \ref incr accordingly.
                 If an empty shape is received, the tensor is a scalar with exactly one component.
@@ -136,6 +206,27 @@ namespace TensorUtils
             */
             void alloc(const std::vector<size_t> &shape, const T& val);
 
+            /*!
+                Same as \ref alloc(const std::vector<size_t> &), but leaves newly allocated components uninitialized.
+                Use this, if all components are overwritten anyway, to avoid a serial initialization pass over the whole memory.
+                \param shape    Used to initialize \ref shape.
+
+                \code
+                #include "TensorUtils.hpp"
+
+                int main()
+                {
+                    TensorUtils::tensor<float> foo;
+
+                    foo.alloc_uninitialized({2,3,5,7});
+                    foo.arange();
+
+                    return 0;
+                }
+                \endcode
+            */
+            void alloc_uninitialized(const std::vector<size_t> &shape);
+
             /*!
                 \param val All components are initialized with this value.
 
@@ -241,7 +332,27 @@ namespace TensorUtils
                 The header line is followed by a lexicographical list of all sub-matrices. Vectors are row-vectors.
                 Note that \ref print will display the same format.
 
-                Binary files are formatted as follows.
+                Binary files are written in version 2 of the format, which describes itself.
+                The header has a fixed size and all integers are in the byte order of the writer:
+                    - 8 bytes magic number "\x93TENSOR\n"
+                    - uint32 version, i.e. 2, and uint32 byte order marker 0x01020304
+                    - 8 bytes type of the components, given by its extension without dot and padded with zeros, e.g. "f64"
+                    - uint64 size of a component in bytes, rank, number of components in the payload,
+                      byte offset of the payload, bytes per checksum chunk and byte offset of the checksums
+                    - 64 uint64 specifying \ref shape, followed by 64 uint64 specifying the strides in components
+                    - uint32 encoding, i.e. 0 if raw and 1 if compressed, and uint32 flag, which is 1 if only the upper triangle is stored
+                      row by row, i.e. the payload contains \f$ M(M+1)/2 \f$ components of an \f$ M \times M \f$ matrix
+                    - uint32 CRC-32 of all preceding bytes of the header and 4 reserved bytes
+
+                The payload starts at a page-aligned offset, i.e. 4096 bytes, and is followed by the CRC-32 of each chunk of the payload.
+                If the size of the checksum chunks is zero, there are no checksums.
+                Compressed payloads start with a table of the uint64 offsets of all chunks and their end, relative to the payload.
+                See \ref write(std::string,std::string,Encoding) for details.
+                When reading, the type of the components is taken from the header, while the extension only selects the binary format.
+                Files in foreign byte order and with arbitrary strides are converted. Invalid headers, truncated payloads or
+                failing checksums throw \ref ErrorHandler::CorruptFile.
+
+                Files in the legacy format are still read. It is formatted as follows.
                 The first block contains sizeof(size_t) bytes specifying shape.size().
                 The second block contains shape.size()*sizeof(size_t) bytes specifying the components of \ref shape.
                 The third block contains sizeof(size_t) bytes specifying the container size.
@@ -270,6 +381,10 @@ namespace TensorUtils
                     {
                         //
                     }
+                    catch(CorruptFile &ex) // invalid header or checksum mismatch: corrupted file!
+                    {
+                        //
+                    }
                     catch(std::exception &ex) // catch any other exception
                     {
                         //
@@ -281,6 +396,58 @@ namespace TensorUtils
             */
             void read(std::string path);
 
+            /*!
+                Reads the hyper-rectangular sub-block `[begin[d],end[d])` along each axis `d` of a tensor stored in a file.
+                Axes beyond `begin.size()` are read entirely. Ends beyond the shape in the file are clipped to it.
+                For binary files, only the requested components are read, i.e. each contiguous run of the sub-block
+                is read by a positioned read. The checksums of binary files are not verified, since they span entire chunks.
+                Text files are read entirely and the sub-block is copied afterwards.
+                See \ref read(std::string) for details on the file format.
+                \param path  Specifies the source path.
+                \param begin First index along each leading axis.
+                \param end   One past the last index along each leading axis.
+                \code
+                #include "TensorUtils.hpp"
+
+                int main()
+                {
+                    using namespace TensorUtils;
+
+                    tensor<double> foo({100,1000,3}, 1.0);
+                    foo.write("foo.f64", ".");
+
+                    tensor<double> bar;
+                    bar.read("foo.f64", {10,0}, {20,1}); // bar(n,0,o) == foo(10+n,0,o), shape {10,1,3}
+
+                    return 0;
+                }
+                \endcode
+            */
+            void read(std::string path, const std::vector<size_t> &begin, const std::vector<size_t> &end);
+
+            /*!
+                Reads the components with indices in `[begin,end)` along `axis` of a tensor stored in a file,
+                e.g. the initial values of a set of trajectories. All other axes are read entirely.
+                See \ref read(std::string,const std::vector<size_t>&,const std::vector<size_t>&) for details.
+                \code
+                #include "TensorUtils.hpp"
+
+                int main()
+                {
+                    using namespace TensorUtils;
+
+                    tensor<double> foo({100,1000,3}, 1.0);
+                    foo.write("foo.f64", ".");
+
+                    tensor<double> bar;
+                    bar.read("foo.f64", 1, 0, 1); // bar(n,0,o) == foo(n,0,o), shape {100,1,3}
+
+                    return 0;
+                }
+                \endcode
+            */
+            void read(std::string path, unsigned axis, size_t begin, size_t end);
+
             /*!
                 Write arbitrary tensors to text or binary files.
                 \param oname    Specifies the file name.
@@ -357,8 +524,72 @@ namespace TensorUtils
             */
             void write(std::string oname, std::string folder, int precision);
 
+            /*!
+                For binary files only. See also \ref write(std::string,std::string) for details.
+                \param oname     Specifies the file name. Binary file extensions only.
+                \param folder    Specifies the output path.
+                \param encoding  Encoding of the payload, see \ref Encoding.
+
+                With \ref Encoding::packed, a tensor, which is symmetric with respect to swapping the first and the second half
+                of its indices, e.g. a covariance matrix \f$ C_{tisj} = C_{sjti} \f$, is stored as its upper triangle.
+                This halves the file size and the bandwidth of \ref read. Other tensors are stored as with \ref Encoding::raw.
+                With \ref Encoding::compressed, the payload is split into chunks of 1 MiB, which are converted and compressed
+                in parallel. Each chunk is byte-shuffled, i.e. the k-th bytes of all components are grouped, such that signs,
+                exponents and leading mantissa bytes form long repetitive runs, and then compressed by an LZ77 codec.
+                Chunks that do not shrink are stored as they are. Symmetric tensors are packed as with \ref Encoding::packed
+                before compression. Zero blocks, e.g. the triangular part of a causal memory kernel,
+                compress to almost nothing. \ref read detects the encoding and decompresses the chunks in parallel.
+                Packed and compressed files cannot be appended to.
+                \code
+                #include "TensorUtils.hpp"
+
+                int main()
+                {
+                    using namespace TensorUtils;
+
+                    tensor<double> foo({100,3,100,3}, 1.0);
+
+                    foo.write("foo.f64", ".", Encoding::compressed);
+                    foo.read("foo.f64");
+
+                    return 0;
+                }
+                \endcode
+            */
+            void write(std::string oname, std::string folder, Encoding encoding);
+
+            /*!
+                Appends the tensor along its first axis to a binary file, e.g. to write large data sets block by block.
+                If the file does not exist yet, it is created as with \ref write(std::string,std::string).
+                Otherwise, the rank and all but the first dimension must match the shape stored in the file.
+                The data is written first and the header is updated afterwards,
+                such that the file remains readable with \ref read if the program is interrupted.
+                Files in the legacy format remain in the legacy format, see \ref read.
+                \param oname   Specifies the file name. Binary file extensions only, see \ref write(std::string,std::string).
+                \param folder  Specifies the output path.
+
+                \code
+                #include "TensorUtils.hpp"
+
+                int main()
+                {
+                    using namespace TensorUtils;
+
+                    tensor<double> foo({2,5,7}, 1.0);
+
+                    foo.write("foo.f64", ".");  // shape {2,5,7}
+                    foo.append("foo.f64", "."); // shape {4,5,7}
+
+                    return 0;
+                }
+                \endcode
+            */
+            void append(std::string oname, std::string folder);
+
             /*!
                 Permutes the indices of the tensor and returns by value.
+                Axes which are contiguous in both tensors are merged, such that common permutations
+                reduce to copying contiguous rows or to a cache-blocked transposition of tiles.
                 \param axes Permutation of (0,1,...,N-1), where N is the rank. Indices are transposed accordingly.
                 \return Tensor with transposed indices.
 
@@ -431,6 +662,8 @@ namespace TensorUtils
                 It is possible to mix summation, element-wise multiplication and the usual tensor product as desired.
                 The order of the return value can be set as desired and is given in increasing order of the resulting indices.
                 Additionally, it is possible to compute only a sub-tensor of the final result by setting the parameter \p idx_at.
+                If both operands have the same floating point type, each index occurs at most once per operand, no index is shared without summation
+                and \p idx_at is empty, the operands are permuted and multiplied by a cache-blocked matrix product.
                 \param rhs Second operand.
                 \param idx_lhs Indices of first operand represented by signed intergers.
                 \param idx_rhs Indices of second operand represented by signed integers.
@@ -476,6 +709,7 @@ namespace TensorUtils
                 Indices represented by negative integers are summed over.
                 The order of the return value can be set as desired and is given in increasing order of the resulting indices.
                 Optionally, it is possible to compute only a sub-tensor of the final result by setting the parameter \p idx_at.
+                If each index occurs once and \p idx_at is empty, the tensor is permuted and the contiguous rows are summed directly.
                 \param idx_lhs Indices of first operand represented by signed integers.
                 \param idx_at  Indices specifying the sub-tensor to be computed.
 
@@ -536,7 +770,7 @@ namespace TensorUtils
                 }
                 \endcode
             */
-            template<class T2> TensorBase<T>&   operator=   (const TensorBase<T2>& rhs);
+            template<class T2> TensorBase<T>&   operator=   (const TensorBase<T2>& rhs) { return assign_converted(rhs); }
 
             /*!
                 Add the tensor \p rhs. Number of components must match, else \ref ErrorHandler::ShapeMismatch is thrown.
@@ -560,28 +794,6 @@ namespace TensorUtils
             */
             template<class T2> TensorBase<T>&   operator+=  (const TensorBase<T2>& rhs);
 
-            /*!
-                Returns the sum of this tensor \p with rhs. Number of components must match, else \ref ErrorHandler::ShapeMismatch is thrown.
-                \code
-                #include "TensorUtils.hpp"
-
-                int main()
-                {
-                    TensorUtils::tensor<long double> foo({2,3,5,7},1.0);
-                    TensorUtils::tensor<float> bar({2,3,5,7},1.0);
-
-                    foo = foo + bar;
-
-                    bar.alloc({2*3,5*7},1.0);
-
-                    foo = foo + bar;
-
-                    return 0;
-                }
-                \endcode
-            */
-            template<class T2> TensorBase<T>    operator+   (const TensorBase<T2>& rhs);
-
             /*!
                 Substract the tensor \p rhs. Number of components must match, else \ref ErrorHandler::ShapeMismatch is thrown.
                 \code
@@ -605,29 +817,24 @@ namespace TensorUtils
             template<class T2> TensorBase<T>&   operator-=  (const TensorBase<T2>& rhs);
 
             /*!
-                Returns the difference of this tensor \p with rhs. Number of components must match, else \ref ErrorHandler::ShapeMismatch is thrown.
+                Multiply this tensor with \p rhs.
                 \code
                 #include "TensorUtils.hpp"
 
                 int main()
                 {
                     TensorUtils::tensor<long double> foo({2,3,5,7},1.0);
-                    TensorUtils::tensor<float> bar({2,3,5,7},1.0);
-
-                    foo = foo - bar;
-
-                    bar.alloc({2*3,5*7},1.0);
 
-                    foo = foo - bar;
+                    foo *= 2;
 
                     return 0;
                 }
                 \endcode
             */
-            template<class T2> TensorBase<T>    operator-   (const TensorBase<T2>& rhs);
+            TensorBase<T>&                      operator*=  (const T& rhs);
 
             /*!
-                Multiply this tensor with \p rhs.
+                Divide this tensor with \p rhs.
                 \code
                 #include "TensorUtils.hpp"
 
@@ -635,64 +842,120 @@ namespace TensorUtils
                 {
                     TensorUtils::tensor<long double> foo({2,3,5,7},1.0);
 
-                    foo *= 2;
+                    foo /= 2;
 
                     return 0;
                 }
                 \endcode
             */
-            TensorBase<T>&                      operator*=  (const T& rhs);
+            TensorBase<T>&                      operator/=  (const T& rhs);
 
             /*!
-                Scalar multiplication from the right.
+                Assigns the element-wise expression `rhs` in a single loop. \ref shape and \ref incr are taken
+                from the leftmost tensor of the expression. See \ref TensorExpression.
                 \code
                 #include "TensorUtils.hpp"
 
                 int main()
                 {
                     TensorUtils::tensor<long double> foo({2,3,5,7},1.0);
+                    TensorUtils::tensor<float> bar({2,3,5,7},1.0);
+
+                    foo = foo*2 + bar - foo/3;
+
+                    bar.alloc({2*3,5*7},1.0);
 
-                    foo = foo*2;
+                    foo = 2*foo - bar;
 
                     return 0;
                 }
                 \endcode
             */
-            TensorBase<T>                       operator*   (const T& rhs);
+            template<class E>
+            TensorBase<T>& operator= (const TensorExpression<E> &rhs)
+            {
+                const E &expr = rhs.expression();
+                if(storage_type::size() != expr.size())
+                {
+                    TensorBase<T> result(rhs); // *this might be an operand
+                    storage_type::swap(result);
+                    shape.swap(result.shape);
+                    incr.swap(result.incr);
+                    return *this;
+                }
+                T* ptr = storage_type::data();
+                for(size_t n=0; n<expr.size(); n++)
+                {
+                    ptr[n] = T(expr[n]); // reads only the n-th component of each operand
+                }
+                shape = expr.tensor().shape;
+                incr = expr.tensor().incr;
+                return *this;
+            }
 
             /*!
-                Divide this tensor with \p rhs.
+                Adds the element-wise expression `rhs` in a single loop. Number of components must match, else \ref ErrorHandler::ShapeMismatch is thrown.
                 \code
                 #include "TensorUtils.hpp"
 
                 int main()
                 {
-                    TensorUtils::tensor<long double> foo({2,3,5,7},1.0);
+                    TensorUtils::tensor<double> foo({2,3,5,7},1.0);
+                    TensorUtils::tensor<double> bar({2,3,5,7},1.0);
 
-                    foo /= 2;
+                    foo += 0.5*bar;
 
                     return 0;
                 }
                 \endcode
             */
-            TensorBase<T>&                      operator/=  (const T& rhs);
+            template<class E>
+            TensorBase<T>& operator+= (const TensorExpression<E> &rhs)
+            {
+                const E &expr = rhs.expression();
+                if(storage_type::size() != expr.size())
+                {
+                    throw ErrorHandler::ShapeMismatch("TensorUtils::TensorBase<T>::operator+=:: Shape mismatch: Arguments have not the same number of elements!");
+                }
+                T* ptr = storage_type::data();
+                for(size_t n=0; n<expr.size(); n++)
+                {
+                    ptr[n] += expr[n];
+                }
+                return *this;
+            }
 
             /*!
-                Element-wise division.
+                Substracts the element-wise expression `rhs` in a single loop. Number of components must match, else \ref ErrorHandler::ShapeMismatch is thrown.
                 \code
                 #include "TensorUtils.hpp"
 
                 int main()
                 {
-                    TensorUtils::tensor<long double> foo({2,3,5,7},1.0);
+                    TensorUtils::tensor<double> foo({2,3,5,7},1.0);
+                    TensorUtils::tensor<double> bar({2,3,5,7},1.0);
 
-                    foo = foo/2;
+                    foo -= 0.5*bar;
 
                     return 0;
                 }
                 \endcode
             */
-            TensorBase<T>                       operator/   (const T& rhs);
+            template<class E>
+            TensorBase<T>& operator-= (const TensorExpression<E> &rhs)
+            {
+                const E &expr = rhs.expression();
+                if(storage_type::size() != expr.size())
+                {
+                    throw ErrorHandler::ShapeMismatch("TensorUtils::TensorBase<T>::operator-=:: Shape mismatch: Arguments have not the same number of elements!");
+                }
+                T* ptr = storage_type::data();
+                for(size_t n=0; n<expr.size(); n++)
+                {
+                    ptr[n] -= expr[n];
+                }
+                return *this;
+            }
 
             /*!
                 Initialize this tensor from an array in lexicographical order. No error-handling!
@@ -742,23 +1005,6 @@ namespace TensorUtils
             */
             template<class T2>  T2&             operator>>  (T2& rhs);
 
-            /*!
-                Scalar multiplication from the left.
-                \code
-                #include "TensorUtils.hpp"
-
-                int main()
-                {
-                    TensorUtils::tensor<long double> foo({2,3,5,7},1.0);
-
-                    foo = 2*foo;
-
-                    return 0;
-                }
-                \endcode
-            */
-            friend TensorBase<T> operator* (const T& lhs, TensorBase<T> rhs) { rhs*=lhs; return rhs; };
-
             /*!
                 Assign a sub-tensor this tensor with a sub-tensor of \p rhs. Number of components must match, else \ref ErrorHandler::ShapeMismatch is thrown.
                 \param rhs Second operand.
@@ -1008,7 +1254,7 @@ namespace TensorUtils
                         }
                     }
 
-                    // Remember that TensorBase<T> inherits from std::vector<T>
+                    // Remember that TensorBase<T> inherits from std::vector<T, TensorAllocator<T>>
                     elem=0;
                     for(auto it=foo.begin(); it!=foo.end(); it++)
                     {
@@ -1130,9 +1376,15 @@ namespace TensorUtils
             //! \private
             template<class BUFFER_TYPE> void read_bin(std::string path);
             //! \private
-            template<class BUFFER_TYPE> void write_bin(std::string basename, std::string folder);
+            template<class BUFFER_TYPE> void read_bin_block(std::string path, const std::vector<size_t> &begin, const std::vector<size_t> &end);
+            //! \private
+            template<class BUFFER_TYPE> void write_bin(std::string basename, std::string folder, Encoding encoding);
+            //! \private
+            template<class BUFFER_TYPE> void append_bin(std::string basename, std::string folder);
             //! \private
             template<class BUFFER_TYPE> void write_txt(std::string oname, std::string folder, int precision);
+            //! \private
+            template<class T2> TensorBase<T>& assign_converted(const TensorBase<T2>& rhs);
     };
 }
 
@@ -24,6 +24,9 @@
 
 #include "TensorBase.hpp"
 
+#include <type_traits>
+#include <utility>
+
 namespace TensorUtils
 {
     /*!
@@ -73,12 +76,21 @@ namespace TensorUtils
             //! Inherits from \ref TensorBase and throws \ref ErrorHandler::RankMismatch if shape.size()!=N.
             TensorDerived(const std::vector<size_t> shape, const T& val);
 
+            //! Copy constructor.
+            TensorDerived(const TensorDerived<T,N> &rhs) = default;
+
+            //! Move constructor. Takes over the memory of `rhs` and leaves `rhs` empty with rank N.
+            TensorDerived(TensorDerived<T,N> &&rhs);
+
             //! Inherits from \ref TensorBase and throws \ref ErrorHandler::RankMismatch if shape.size()!=N.
             void alloc(const std::vector<size_t> shape);
 
             //! Inherits from \ref TensorBase and throws \ref ErrorHandler::RankMismatch if shape.size()!=N.
             void alloc(const std::vector<size_t> shape, const T &val);
 
+            //! Inherits from \ref TensorBase and throws \ref ErrorHandler::RankMismatch if shape.size()!=N.
+            void alloc_uninitialized(const std::vector<size_t> shape);
+
             //! Inherits from \ref TensorBase and resizes \ref shape and \ref incr with size N.
             void clear();
 
@@ -87,6 +99,86 @@ namespace TensorUtils
 
             //! Calls \ref TensorBase<T>::operator= and returns *this by reference. Throws \ref ErrorHandler::RankMismatch if shape.size()!=N.
             TensorDerived<T,N>& operator= (const std::vector<T> &rhs);
+
+            //! Copy assignment.
+            TensorDerived<T,N>& operator= (const TensorDerived<T,N> &rhs) = default;
+
+            //! Move assignment. Takes over the memory of `rhs` and leaves `rhs` empty with rank N.
+            TensorDerived<T,N>& operator= (TensorDerived<T,N> &&rhs);
+
+            //! Takes over the memory of `rhs`, e.g. a returned tensor, without copying. Throws \ref ErrorHandler::RankMismatch if rhs.shape.size()!=N.
+            TensorDerived<T,N>& operator= (TensorBase<T> &&rhs);
+
+            //! Evaluates the expression `rhs`. Throws \ref ErrorHandler::RankMismatch if shape.size()!=N. See \ref TensorExpression.
+            template<class E>
+            TensorDerived(const TensorExpression<E> &rhs) : TensorBase<T>(rhs)
+            {
+                if(N != this->shape.size())
+                {
+                    throw ErrorHandler::RankMismatch("TensorUtils::TensorDerived<T,N>::TensorDerived:: Rank mismatch!");
+                }
+            }
+
+            //! Calls \ref TensorBase<T>::operator= and returns *this by reference. Throws \ref ErrorHandler::RankMismatch if shape.size()!=N.
+            template<class E>
+            TensorDerived<T,N>& operator= (const TensorExpression<E> &rhs)
+            {
+                if(N != rhs.expression().tensor().shape.size())
+                {
+                    throw ErrorHandler::RankMismatch("TensorUtils::TensorDerived<T,N>::operator=:: Rank mismatch!");
+                }
+                TensorBase<T>::operator=(rhs);
+                return *this;
+            }
+
+            /*!
+                Element access with at most N indices. See \ref TensorBase<T>::operator()(const std::vector<size_t> &).
+                Since the rank is known at compile time, passing more than N indices does not compile
+                and the index arithmetic is inlined. The increment of the last index is always one,
+                such that loops over the last index compile to contiguous memory access, which can be vectorized.
+                Indices are only checked, if THROW_EXCEPTIONS is defined non-zero before including this header.
+            */
+            template<class... Idx, class = typename std::enable_if<std::conjunction<std::is_integral<Idx>...>::value>::type>
+            T& operator()(Idx... indices)
+            {
+                static_assert(sizeof...(Idx)<=size_t(N), "TensorUtils::TensorDerived<T,N>::operator():: Too many indices!");
+                #if defined(THROW_EXCEPTIONS) && THROW_EXCEPTIONS
+                return TensorBase<T>::operator()(std::vector<size_t>{size_t(indices)...});
+                #else
+                return this->data()[offset<0>(size_t(indices)...)];
+                #endif
+            }
+
+            //! See \ref TensorBase<T>::operator()(const std::vector<size_t> &).
+            T& operator()(const std::vector<size_t> &indices)
+            {
+                return TensorBase<T>::operator()(indices);
+            }
+
+            //! See \ref TensorBase<T>::operator()(const std::vector<size_t> &).
+            T& operator()(const std::vector<size_t*> &indices)
+            {
+                return TensorBase<T>::operator()(indices);
+            }
+
+        private:
+            // OFFSET OF THE INDICES K,K+1,... IN MEMORY
+            template<size_t K, class... Idx>
+            size_t offset(size_t n, Idx... indices) const
+            {
+                size_t result = (K+1==size_t(N)) ? n : this->incr[K]*n;
+                if constexpr(sizeof...(Idx)>0)
+                {
+                    result += offset<K+1>(indices...);
+                }
+                return result;
+            }
+
+            template<size_t K>
+            size_t offset() const
+            {
+                return 0;
+            }
     };
 
     //! This class specialization defines a tensor with mutable rank and inherits from \ref TensorBase.
@@ -108,6 +200,25 @@ namespace TensorUtils
 
             //! Calls \ref TensorBase<T>::operator= and returns *this by reference.
             TensorDerived<T,-1>& operator= (const std::vector<T> &rhs);
+
+            //! Takes over the memory of `rhs`, e.g. a returned tensor, without copying.
+            TensorDerived<T,-1>& operator= (TensorBase<T> &&rhs)
+            {
+                TensorBase<T>::operator=(std::move(rhs));
+                return *this;
+            }
+
+            //! Constructor is inherited from \ref TensorBase. See \ref TensorExpression.
+            template<class E>
+            TensorDerived(const TensorExpression<E> &rhs) : TensorBase<T>(rhs) {};
+
+            //! Calls \ref TensorBase<T>::operator= and returns *this by reference.
+            template<class E>
+            TensorDerived<T,-1>& operator= (const TensorExpression<E> &rhs)
+            {
+                TensorBase<T>::operator=(rhs);
+                return *this;
+            }
     };
     /*! @} */
 }
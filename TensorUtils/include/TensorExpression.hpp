@@ -0,0 +1,208 @@
+/**
+\internal
+    TensorUtils Version 0.1
+
+    Copyright 2022 Christoph Widder
+
+    This file is part of TensorUtils.
+
+    TensorUtils is free software: you can redistribute it and/or modify it under the terms of
+    the GNU General Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    TensorUtils is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+    without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+    PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with TensorUtils.
+    If not, see <https://www.gnu.org/licenses/>.
+\endinternal
+**/
+
+#ifndef TENSOREXPRESSION_HPP
+#define TENSOREXPRESSION_HPP
+
+#include "ErrorHandler.hpp"
+
+#include <cstddef>
+#include <type_traits>
+
+namespace TensorUtils
+{
+    template<class T> class TensorBase;
+
+    /*!
+        \addtogroup TensorUtils
+        @{
+    */
+
+    //! Base class of all lazily evaluated element-wise expressions of tensors.
+    /*!
+        The operators +, -, * and / with tensor operands do not compute a result, but return an expression,
+        which refers to its operands. The expression is evaluated component by component in a single loop,
+        when it is assigned to a tensor, e.g. by \ref TensorBase<T>::operator=(const TensorExpression<E>&)
+        or \ref TensorBase<T>::operator+=(const TensorExpression<E>&). Hence, chained operations neither
+        create temporary tensors nor pass over the memory more than once.
+        The type of the components and the shape of an expression are taken from its leftmost tensor operand.
+        The operands must have the same number of components, else \ref ErrorHandler::ShapeMismatch is thrown.
+        \code
+        #include "TensorUtils.hpp"
+
+        int main()
+        {
+            TensorUtils::tensor<double,2> foo({2,3},1.0);
+            TensorUtils::tensor<double,2> bar({2,3},2.0);
+
+            foo = 2.0*foo + bar/4.0;    // single loop, no temporary tensors
+            foo -= 0.5*bar;             // single loop, no temporary tensors
+
+            return 0;
+        }
+        \endcode
+    */
+    template<class E>
+    class TensorExpression
+    {
+        public:
+            //! Returns the expression of the derived type.
+            const E& expression() const
+            {
+                return static_cast<const E&>(*this);
+            }
+    };
+
+    //! \private
+    template<class T>
+    class TensorTerminal : public TensorExpression<TensorTerminal<T>>
+    {
+        public:
+            typedef T value_type;
+
+            TensorTerminal(const TensorBase<T> &tensor) : tensor_ptr(&tensor), data(tensor.data()) {}
+
+            size_t size() const { return tensor_ptr->size(); }
+            const TensorBase<T>& tensor() const { return *tensor_ptr; }
+            T operator[](size_t n) const { return data[n]; }
+
+        private:
+            const TensorBase<T>* tensor_ptr;
+            const T* data;
+    };
+
+    //! \private
+    template<class L, class R, class OP>
+    class TensorBinary : public TensorExpression<TensorBinary<L,R,OP>>
+    {
+        public:
+            typedef typename L::value_type value_type;
+
+            TensorBinary(const L &lhs, const R &rhs) : lhs(lhs), rhs(rhs)
+            {
+                if(lhs.size() != rhs.size())
+                {
+                    throw ErrorHandler::ShapeMismatch("TensorUtils::TensorExpression:: Shape mismatch: Arguments have not the same number of elements!");
+                }
+            }
+
+            size_t size() const { return lhs.size(); }
+            decltype(auto) tensor() const { return lhs.tensor(); }
+            value_type operator[](size_t n) const { return value_type(OP::apply(lhs[n],rhs[n])); }
+
+        private:
+            L lhs;
+            R rhs;
+    };
+
+    //! \private
+    template<class L, class OP>
+    class TensorScalar : public TensorExpression<TensorScalar<L,OP>>
+    {
+        public:
+            typedef typename L::value_type value_type;
+
+            TensorScalar(const L &lhs, const value_type &rhs) : lhs(lhs), rhs(rhs) {}
+
+            size_t size() const { return lhs.size(); }
+            decltype(auto) tensor() const { return lhs.tensor(); }
+            value_type operator[](size_t n) const { return value_type(OP::apply(lhs[n],rhs)); }
+
+        private:
+            L lhs;
+            value_type rhs;
+    };
+
+    //! \private
+    namespace TensorOperation
+    {
+        struct Plus     { template<class A, class B> static auto apply(const A &a, const B &b) { return a+b; } };
+        struct Minus    { template<class A, class B> static auto apply(const A &a, const B &b) { return a-b; } };
+        struct Times    { template<class A, class B> static auto apply(const A &a, const B &b) { return a*b; } };
+        struct Divide   { template<class A, class B> static auto apply(const A &a, const B &b) { return a/b; } };
+
+        // CONVERT TENSORS AND EXPRESSIONS TO EXPRESSIONS
+        template<class T>
+        TensorTerminal<T> make_expression(const TensorBase<T> &tensor) { return TensorTerminal<T>(tensor); }
+
+        template<class E>
+        const E& make_expression(const TensorExpression<E> &expr) { return expr.expression(); }
+
+        template<class A>
+        using expression_t = typename std::decay<decltype(make_expression(std::declval<const A&>()))>::type;
+
+        // TRUE FOR TENSORS AND EXPRESSIONS
+        template<class A, class = void>
+        struct is_operand : std::false_type {};
+
+        template<class A>
+        struct is_operand<A, std::void_t<decltype(make_expression(std::declval<const A&>()))>> : std::true_type {};
+
+        template<class A, class B>
+        using enable_binary = typename std::enable_if<is_operand<A>::value && is_operand<B>::value>::type;
+
+        template<class A, class S>
+        using enable_scalar = typename std::enable_if<is_operand<A>::value && std::is_arithmetic<S>::value>::type;
+    }
+
+    //! Lazy sum of two tensors or expressions. See \ref TensorExpression.
+    template<class A, class B, class = TensorOperation::enable_binary<A,B>>
+    auto operator+(const A &lhs, const B &rhs)
+    {
+        using namespace TensorOperation;
+        return TensorBinary<expression_t<A>,expression_t<B>,Plus>(make_expression(lhs),make_expression(rhs));
+    }
+
+    //! Lazy difference of two tensors or expressions. See \ref TensorExpression.
+    template<class A, class B, class = TensorOperation::enable_binary<A,B>>
+    auto operator-(const A &lhs, const B &rhs)
+    {
+        using namespace TensorOperation;
+        return TensorBinary<expression_t<A>,expression_t<B>,Minus>(make_expression(lhs),make_expression(rhs));
+    }
+
+    //! Lazy scalar multiplication from the right. See \ref TensorExpression.
+    template<class A, class S, class = TensorOperation::enable_scalar<A,S>>
+    auto operator*(const A &lhs, const S &rhs)
+    {
+        using namespace TensorOperation;
+        return TensorScalar<expression_t<A>,Times>(make_expression(lhs),rhs);
+    }
+
+    //! Lazy scalar multiplication from the left. See \ref TensorExpression.
+    template<class S, class A, TensorOperation::enable_scalar<A,S>* = nullptr>
+    auto operator*(const S &lhs, const A &rhs)
+    {
+        using namespace TensorOperation;
+        return TensorScalar<expression_t<A>,Times>(make_expression(rhs),lhs);
+    }
+
+    //! Lazy division by a scalar. See \ref TensorExpression.
+    template<class A, class S, class = TensorOperation::enable_scalar<A,S>>
+    auto operator/(const A &lhs, const S &rhs)
+    {
+        using namespace TensorOperation;
+        return TensorScalar<expression_t<A>,Divide>(make_expression(lhs),rhs);
+    }
+    /*! @} */
+}
+
+#endif // TENSOREXPRESSION_HPP
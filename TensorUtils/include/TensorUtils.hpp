@@ -24,6 +24,7 @@
 
 #include "ErrorHandler.hpp"
 #include "TensorDerived.hpp"
+#include "TensorView.hpp"
 
 /*!
     \addtogroup TensorUtils
@@ -55,6 +56,24 @@ namespace TensorUtils
         \endcode
     */
     template<class T, int N=-1> using tensor = TensorDerived<T,N>;
+
+    /*!
+        \brief Alias declaration for the non-owning view "TensorView<T>",
+        where "T" is the type of the components.
+
+        \code
+        #include "TensorUtils.hpp"
+
+        int main()
+        {
+            TensorUtils::tensor<double,3> my_tensor({2,3,5});
+            TensorUtils::tensor_view<double> my_view(my_tensor);
+
+            return 0;
+        }
+        \endcode
+    */
+    template<class T> using tensor_view = TensorView<T>;
     /*! @} */
 }
 /*! @} */
@@ -76,7 +95,8 @@ namespace TensorUtils
 
     \section intro Introduction
 
-	TensorUtils presents a tensor class which is derived from std::vector<T>.
+	TensorUtils presents a tensor class which is derived from std::vector<T>
+	(with the allocator \ref TensorUtils::TensorAllocator).
 	It allows the usage of all std::vector routines, but has its own constructors.
 	The tensor class allows to allocate, initialize, read and write tensors of
 	floating or integral types up to rank 8. It provides text and binary file
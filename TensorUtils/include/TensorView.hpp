@@ -0,0 +1,136 @@
+/**
+\internal
+    TensorUtils Version 0.1
+
+    Copyright 2022 Christoph Widder
+
+    This file is part of TensorUtils.
+
+    TensorUtils is free software: you can redistribute it and/or modify it under the terms of
+    the GNU General Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    TensorUtils is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+    without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+    PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along with TensorUtils.
+    If not, see <https://www.gnu.org/licenses/>.
+\endinternal
+**/
+
+#ifndef TENSORVIEW_HPP
+#define TENSORVIEW_HPP
+
+#include "TensorBase.hpp"
+
+#include <vector>
+
+namespace TensorUtils
+{
+    /*!
+        \addtogroup TensorUtils
+        @{
+    */
+
+    //! This class defines a non-owning, strided view of the components of a tensor.
+    /*!
+        A view consists of a pointer to its first component, a \ref shape and the increments \ref incr
+        of each index in memory. Slicing, restricting index ranges and transposing a view only changes
+        these members, but never copies any data. The view is invalidated, if the storage of the viewed tensor is reallocated.
+        \code
+        #include "TensorUtils.hpp"
+
+        int main()
+        {
+            using namespace TensorUtils;
+
+            tensor<double,3> foo({2,3,5});
+            foo.arange();
+
+            tensor_view<double> bar(foo);
+            bar = bar.slice({1}).range(1,1,5);  // bar(t,o) == foo(1,t,o+1), shape {3,4}
+            bar(0,0) = -1.0;                    // foo(1,0,1) == -1.0
+
+            tensor<double,2> foobar;
+            foobar = bar.copy();                // contiguous copy of shape {3,4}
+
+            return 0;
+        }
+        \endcode
+    */
+    template<class T>
+    class TensorView
+    {
+        public:
+            //! Empty view.
+            TensorView();
+
+            //! Views all components of `tensor`.
+            TensorView(TensorBase<T> &tensor);
+
+            //! Views the components at `data` with the given shape and increments.
+            TensorView(T* data, const std::vector<size_t> &shape, const std::vector<size_t> &incr);
+
+            //! Returns the number of viewed components.
+            size_t size() const;
+
+            //! Returns true, if the viewed components are stored contiguously in lexicographical order.
+            bool contiguous() const;
+
+            /*!
+                Fixes the leading indices to `idx_at` and returns the view of the remaining indices.
+                See also \ref TensorBase<T>::slice.
+            */
+            TensorView<T> slice(const std::vector<size_t> &idx_at) const;
+
+            /*!
+                Restricts the index `axis` to the range [begin,end) and returns the view.
+                The index of the returned view starts counting at zero.
+            */
+            TensorView<T> range(unsigned axis, size_t begin, size_t end) const;
+
+            /*!
+                Permutes the indices of the view. See also \ref TensorBase<T>::transpose.
+            */
+            TensorView<T> transpose(const std::vector<unsigned> &axes) const;
+
+            //! Returns a contiguous copy of the viewed components.
+            TensorBase<T> copy() const;
+
+            /*!
+                Copies the viewed components in lexicographical order to the contiguous memory at `dst`.
+                The components are copied front to back, such that `dst` may alias the viewed storage
+                as long as no component is overwritten before it is read, e.g. to compact a tensor in place.
+            */
+            void copy_to(T* dst) const;
+
+            //! Copies the contiguous memory at `src` in lexicographical order to the viewed components.
+            void copy_from(const T* src);
+
+            //! Element access. See \ref TensorBase<T>::operator()(const std::vector<size_t> &).
+            T& operator()(const std::vector<size_t> &indices) const;
+            //! See \ref operator()(const std::vector<size_t> &).
+            T& operator()() const;
+            //! See \ref operator()(const std::vector<size_t> &).
+            T& operator()(size_t n0) const;
+            //! See \ref operator()(const std::vector<size_t> &).
+            T& operator()(size_t n0, size_t n1) const;
+            //! See \ref operator()(const std::vector<size_t> &).
+            T& operator()(size_t n0, size_t n1, size_t n2) const;
+            //! See \ref operator()(const std::vector<size_t> &).
+            T& operator()(size_t n0, size_t n1, size_t n2, size_t n3) const;
+
+            //! Pointer to the first viewed component.
+            T* data;
+
+            //! Dimensions of the view.
+            std::vector<size_t> shape;
+
+            //! Increments in memory for each index of the view.
+            std::vector<size_t> incr;
+    };
+    /*! @} */
+}
+
+#endif // TENSORVIEW_HPP
@@ -27,6 +27,7 @@ If not, see <https://www.gnu.org/licenses/>.
 #endif // THROW_BASIC_EXCEPTIONS
 
 #include "TensorBase.hpp"
+#include "TensorView.hpp"
 #include "ErrorHandler.hpp"
 
 #include <iostream>
@@ -36,6 +37,14 @@ If not, see <https://www.gnu.org/licenses/>.
 #include <functional>
 #include <cstring>
 #include <iomanip>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
 
 using namespace std;
 using namespace TensorUtils;
@@ -46,19 +55,19 @@ using namespace ErrorHandler;
 **/
 
 template<class T>
-TensorBase<T>::TensorBase() : vector<T>()
+TensorBase<T>::TensorBase() : storage_type()
 {
     //
 }
 
 template<class T>
-TensorBase<T>::TensorBase(const vector<size_t> &shape) : vector<T>()
+TensorBase<T>::TensorBase(const vector<size_t> &shape) : storage_type()
 {
     alloc(shape);
 }
 
 template<class T>
-TensorBase<T>::TensorBase(const vector<size_t> &shape, const T& val) : vector<T>()
+TensorBase<T>::TensorBase(const vector<size_t> &shape, const T& val) : storage_type()
 {
     alloc(shape, val);
 }
@@ -75,10 +84,28 @@ TensorBase<T>::~TensorBase()
 
 template<class T>
 void TensorBase<T>::alloc(const vector<size_t> &shape)
+{
+    size_t num_old = storage_type::size();
+    alloc_uninitialized(shape);
+    if(storage_type::size() > num_old)
+    {
+        std::fill(storage_type::begin()+num_old, storage_type::end(), T());
+    }
+}
+
+template<class T>
+void TensorBase<T>::alloc(const vector<size_t> &shape, const T& val)
+{
+    alloc_uninitialized(shape);
+    init(val);
+}
+
+template<class T>
+void TensorBase<T>::alloc_uninitialized(const vector<size_t> &shape)
 {
     if(shape.empty())
     {
-        vector<T>::resize(1); // scalar
+        storage_type::resize(1); // scalar
         this->shape.clear();
         incr.clear();
         return;
@@ -96,26 +123,19 @@ void TensorBase<T>::alloc(const vector<size_t> &shape)
         num_elems *= shape[dim+1];
     }
     num_elems *= shape.front();
-    vector<T>::resize(num_elems);
-}
-
-template<class T>
-void TensorBase<T>::alloc(const vector<size_t> &shape, const T& val)
-{
-    alloc(shape);
-    init(val);
+    storage_type::resize(num_elems);
 }
 
 template<class T>
 void TensorBase<T>::init(const T& val)
 {
-    vector<T>::assign(vector<T>::size(), val);
+    storage_type::assign(storage_type::size(), val);
 }
 
 template<class T>
 void TensorBase<T>::arange(T val)
 {
-    for(auto it=vector<T>::begin();it!=vector<T>::end();it++)
+    for(auto it=storage_type::begin();it!=storage_type::end();it++)
     {
         *it=val;
         val++;
@@ -125,7 +145,7 @@ void TensorBase<T>::arange(T val)
 template<class T>
 void TensorBase<T>::clear()
 {
-    vector<T>::clear();
+    storage_type::clear();
     shape.clear();
     incr.clear();
 }
@@ -143,7 +163,7 @@ void TensorBase<T>::print_helper()
         cout << *it << '\t';
     }
     cout << '\n' << '\n';
-    for(size_t n=0;n<vector<T>::size();n++)
+    for(size_t n=0;n<storage_type::size();n++)
     {
         cout << (BUFFER_TYPE)(*this)[n] << '\t';
         if(incr.empty())
@@ -176,6 +196,994 @@ void TensorBase<signed char>::print()
     TensorBase<signed char>::print_helper<int>();
 }
 
+/**
+    BINARY FILE FORMAT
+**/
+
+// VERSION 2: FIXED-SIZE HEADER, PAYLOAD AT A PAGE-ALIGNED OFFSET, CRC-32 OF EACH CHUNK OF THE PAYLOAD BEHIND IT
+static const char BINARY_MAGIC[8] = {'\x93','T','E','N','S','O','R','\n'};
+static const uint32_t BINARY_VERSION = 2;
+static const uint32_t BINARY_BYTE_ORDER = 0x01020304;
+static const size_t BINARY_MAX_RANK = 64;
+static const uint64_t BINARY_DATA_OFFSET = 4096;
+static const uint64_t BINARY_CHUNK_SIZE = uint64_t(1) << 20;
+static const uint32_t BINARY_RAW = 0;
+static const uint32_t BINARY_COMPRESSED = 1;
+
+struct BinaryHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;                    // BINARY_BYTE_ORDER in the byte order of the writer
+    char dtype[8];                          // extension of the component type without dot, e.g. "f64"
+    uint64_t elem_size;                     // bytes per component
+    uint64_t rank;
+    uint64_t data_size;                     // number of components in the payload
+    uint64_t data_offset;                   // byte offset of the payload
+    uint64_t chunk_size;                    // bytes per checksum chunk, 0 if there are no checksums
+    uint64_t checksum_offset;               // byte offset of the checksums
+    uint64_t shape[BINARY_MAX_RANK];
+    uint64_t strides[BINARY_MAX_RANK];      // in components
+    uint32_t encoding;                      // BINARY_RAW or BINARY_COMPRESSED
+    uint32_t symmetric;                     // 1 if the payload is the upper triangle of a symmetric matrix
+    uint32_t header_crc;                    // CRC-32 of all preceding bytes
+    uint32_t reserved;
+};
+static_assert(sizeof(BinaryHeader) <= BINARY_DATA_OFFSET, "TensorUtils::BinaryHeader:: Header does not fit in front of the payload!");
+
+// CRC-32 AS IN ZLIB, SLICING BY 8 BYTES
+static uint32_t crc32_update(uint32_t crc, const char* data, size_t num_bytes)
+{
+    static const auto table = []()
+    {
+        array<array<uint32_t,256>,8> tab;
+        for(uint32_t n=0; n<256; n++)
+        {
+            uint32_t c = n;
+            for(int k=0; k<8; k++)
+            {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            tab[0][n] = c;
+        }
+        for(uint32_t n=0; n<256; n++)
+        {
+            for(int k=1; k<8; k++)
+            {
+                tab[k][n] = (tab[k-1][n] >> 8) ^ tab[0][tab[k-1][n] & 0xFF];
+            }
+        }
+        return tab;
+    }();
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    crc = ~crc;
+    for(; num_bytes>=8; num_bytes-=8, p+=8)
+    {
+        uint32_t lo = crc ^ (uint32_t(p[0]) | uint32_t(p[1])<<8 | uint32_t(p[2])<<16 | uint32_t(p[3])<<24);
+        uint32_t hi = uint32_t(p[4]) | uint32_t(p[5])<<8 | uint32_t(p[6])<<16 | uint32_t(p[7])<<24;
+        crc = table[7][lo & 0xFF] ^ table[6][(lo>>8) & 0xFF] ^ table[5][(lo>>16) & 0xFF] ^ table[4][lo>>24]
+            ^ table[3][hi & 0xFF] ^ table[2][(hi>>8) & 0xFF] ^ table[1][(hi>>16) & 0xFF] ^ table[0][hi>>24];
+    }
+    for(; num_bytes>0; num_bytes--, p++)
+    {
+        crc = table[0][(crc ^ *p) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// ACCUMULATES THE CRC-32 OF EACH CHUNK OF A BYTE STREAM
+class ChunkChecksums
+{
+    public:
+        ChunkChecksums(uint64_t chunk_size, vector<uint32_t> checksums = {}) : chunk_size(chunk_size), checksums(checksums) {}
+
+        void update(const char* data, size_t num_bytes)
+        {
+            while(num_bytes>0)
+            {
+                size_t n = min<uint64_t>(num_bytes, chunk_size-fill);
+                crc = crc32_update(crc, data, n);
+                fill += n;
+                data += n;
+                num_bytes -= n;
+                if(fill==chunk_size)
+                {
+                    checksums.push_back(crc);
+                    crc = 0;
+                    fill = 0;
+                }
+            }
+        }
+
+        const vector<uint32_t>& finish()
+        {
+            if(fill>0)
+            {
+                checksums.push_back(crc);
+                crc = 0;
+                fill = 0;
+            }
+            return checksums;
+        }
+
+    private:
+        uint64_t chunk_size;
+        uint64_t fill = 0;
+        uint32_t crc = 0;
+        vector<uint32_t> checksums;
+};
+
+// RUNS func(0), ..., func(num-1) ON ALL HARDWARE THREADS AND RETHROWS THE FIRST EXCEPTION
+static void parallel_for(size_t num, const function<void(size_t)> &func)
+{
+    size_t num_threads = min<size_t>(num, max(1u, thread::hardware_concurrency()));
+    atomic<size_t> next(0);
+    exception_ptr error;
+    mutex error_mutex;
+    auto worker = [&]()
+    {
+        for(size_t n=next++; n<num; n=next++)
+        {
+            try
+            {
+                func(n);
+            }
+            catch(...)
+            {
+                lock_guard<mutex> lock(error_mutex);
+                if(!error)
+                {
+                    error = current_exception();
+                }
+            }
+        }
+    };
+    vector<thread> threads;
+    for(size_t k=1; k<num_threads; k++)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for(auto &th : threads)
+    {
+        th.join();
+    }
+    if(error)
+    {
+        rethrow_exception(error);
+    }
+}
+
+// GROUPS THE k-TH BYTES OF ALL COMPONENTS, SUCH THAT SIGN, EXPONENT AND LEADING MANTISSA BYTES FORM LONG REPETITIVE RUNS
+static void shuffle_bytes(const char* src, char* dst, size_t elem_size, size_t num_elems)
+{
+    for(size_t n=0; n<num_elems; n++)
+    {
+        for(size_t k=0; k<elem_size; k++)
+        {
+            dst[k*num_elems+n] = src[n*elem_size+k];
+        }
+    }
+}
+
+static void unshuffle_bytes(const char* src, char* dst, size_t elem_size, size_t num_elems)
+{
+    for(size_t k=0; k<elem_size; k++)
+    {
+        for(size_t n=0; n<num_elems; n++)
+        {
+            dst[n*elem_size+k] = src[k*num_elems+n];
+        }
+    }
+}
+
+// LZ77 BLOCK CODEC IN THE SEQUENCE FORMAT OF LZ4: TOKEN, LITERALS, 16 BIT OFFSET, MATCH LENGTH
+static const size_t LZ_MIN_MATCH = 4;
+static const size_t LZ_HASH_LOG = 14;
+
+static uint32_t lz_read32(const unsigned char* p)
+{
+    uint32_t val;
+    memcpy(&val, p, sizeof(uint32_t));
+    return val;
+}
+
+static void lz_write_length(vector<unsigned char> &dst, size_t len)
+{
+    for(; len>=255; len-=255)
+    {
+        dst.push_back(255);
+    }
+    dst.push_back((unsigned char)len);
+}
+
+static void lz_compress(const char* data, size_t num_bytes, vector<unsigned char> &dst)
+{
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(data);
+    vector<size_t> table(size_t(1)<<LZ_HASH_LOG, size_t(-1));
+    dst.clear();
+    dst.reserve(num_bytes);
+    size_t anchor = 0;
+    size_t pos = 0;
+    size_t limit = num_bytes>12 ? num_bytes-12 : 0; // last literals are never part of a match
+    while(pos<limit)
+    {
+        size_t h = (lz_read32(src+pos)*2654435761u) >> (32-LZ_HASH_LOG);
+        size_t cand = table[h];
+        table[h] = pos;
+        if(cand==size_t(-1) || pos-cand>65535 || lz_read32(src+cand)!=lz_read32(src+pos))
+        {
+            pos += 1 + ((pos-anchor)>>6); // skip faster through incompressible data
+            continue;
+        }
+        size_t len = LZ_MIN_MATCH;
+        while(pos+len<num_bytes-5 && src[cand+len]==src[pos+len])
+        {
+            len++;
+        }
+        size_t num_literals = pos-anchor;
+        dst.push_back((unsigned char)((min<size_t>(num_literals,15)<<4) | min<size_t>(len-LZ_MIN_MATCH,15)));
+        if(num_literals>=15)
+        {
+            lz_write_length(dst, num_literals-15);
+        }
+        dst.insert(dst.end(), src+anchor, src+pos);
+        dst.push_back((unsigned char)((pos-cand) & 0xFF));
+        dst.push_back((unsigned char)((pos-cand) >> 8));
+        if(len-LZ_MIN_MATCH>=15)
+        {
+            lz_write_length(dst, len-LZ_MIN_MATCH-15);
+        }
+        pos += len;
+        anchor = pos;
+        if(dst.size()>=num_bytes)
+        {
+            return; // incompressible, caller stores the chunk as is
+        }
+    }
+    size_t num_literals = num_bytes-anchor;
+    dst.push_back((unsigned char)(min<size_t>(num_literals,15)<<4));
+    if(num_literals>=15)
+    {
+        lz_write_length(dst, num_literals-15);
+    }
+    dst.insert(dst.end(), src+anchor, src+num_bytes);
+}
+
+static bool lz_decompress(const char* data, size_t num_bytes, char* out, size_t out_size)
+{
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char* end = src+num_bytes;
+    unsigned char* dst = reinterpret_cast<unsigned char*>(out);
+    unsigned char* dst_begin = dst;
+    unsigned char* dst_end = dst+out_size;
+    auto read_length = [&](size_t len) -> size_t
+    {
+        if(len==15)
+        {
+            unsigned char byte;
+            do
+            {
+                if(src==end)
+                {
+                    return size_t(-1);
+                }
+                byte = *src++;
+                len += byte;
+            }
+            while(byte==255);
+        }
+        return len;
+    };
+    while(src<end)
+    {
+        unsigned char token = *src++;
+        size_t num_literals = read_length(token>>4);
+        if(num_literals>size_t(end-src) || num_literals>size_t(dst_end-dst))
+        {
+            return false;
+        }
+        memcpy(dst, src, num_literals);
+        src += num_literals;
+        dst += num_literals;
+        if(src==end)
+        {
+            break;
+        }
+        if(end-src<2)
+        {
+            return false;
+        }
+        size_t offset = src[0] | size_t(src[1])<<8;
+        src += 2;
+        size_t len = read_length(token & 0xF);
+        if(len==size_t(-1) || offset==0 || offset>size_t(dst-dst_begin) || len+LZ_MIN_MATCH>size_t(dst_end-dst))
+        {
+            return false;
+        }
+        len += LZ_MIN_MATCH;
+        const unsigned char* match = dst-offset;
+        for(size_t k=0; k<len; k++)
+        {
+            dst[k] = match[k]; // front to back, matches may overlap
+        }
+        dst += len;
+    }
+    return dst==dst_end;
+}
+
+template<class BUFFER_TYPE>
+static const char* binary_dtype()
+{
+    if constexpr(is_same<BUFFER_TYPE,float>::value)                     {return "f32";}
+    else if constexpr(is_same<BUFFER_TYPE,double>::value)               {return "f64";}
+    else if constexpr(is_same<BUFFER_TYPE,long double>::value)          {return "f80";}
+    else if constexpr(is_same<BUFFER_TYPE,unsigned char>::value)        {return "uc";}
+    else if constexpr(is_same<BUFFER_TYPE,signed char>::value)          {return "sc";}
+    else if constexpr(is_same<BUFFER_TYPE,unsigned short>::value)       {return "us";}
+    else if constexpr(is_same<BUFFER_TYPE,short>::value)                {return "s";}
+    else if constexpr(is_same<BUFFER_TYPE,unsigned>::value)             {return "u";}
+    else if constexpr(is_same<BUFFER_TYPE,int>::value)                  {return "int";}
+    else if constexpr(is_same<BUFFER_TYPE,unsigned long>::value)        {return "ul";}
+    else if constexpr(is_same<BUFFER_TYPE,long>::value)                 {return "l";}
+    else if constexpr(is_same<BUFFER_TYPE,unsigned long long>::value)   {return "ull";}
+    else                                                                {return "ll";}
+}
+
+static void swap_bytes(char* data, size_t elem_size, size_t num_elems)
+{
+    for(size_t n=0; n<num_elems; n++, data+=elem_size)
+    {
+        reverse(data, data+elem_size);
+    }
+}
+
+// SWAPS THE BYTES OF A SINGLE HEADER FIELD, NEVER CROSSING INTO THE NEXT MEMBER
+template<class U>
+static void swap_field(U &field)
+{
+    swap_bytes((char*)&field, sizeof(U), 1);
+}
+
+static void seal_binary_header(BinaryHeader &header)
+{
+    header.header_crc = crc32_update(0, (const char*)&header, offsetof(BinaryHeader, header_crc));
+}
+
+static BinaryHeader make_binary_header(const char* dtype, size_t elem_size, const vector<size_t> &shape, const vector<size_t> &incr, size_t data_size)
+{
+    if(shape.size()>BINARY_MAX_RANK)
+    {
+        throw ShapeMismatch("TensorUtils::TensorBase<T>::write:: Rank too large for binary files!");
+    }
+    BinaryHeader header;
+    memset(&header, 0, sizeof(BinaryHeader));
+    memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.byte_order = BINARY_BYTE_ORDER;
+    strncpy(header.dtype, dtype, sizeof(header.dtype)-1);
+    header.elem_size = elem_size;
+    header.rank = shape.size();
+    header.data_size = data_size;
+    header.data_offset = BINARY_DATA_OFFSET;
+    header.chunk_size = BINARY_CHUNK_SIZE;
+    header.checksum_offset = BINARY_DATA_OFFSET + data_size*elem_size;
+    copy(shape.begin(), shape.end(), header.shape);
+    copy(incr.begin(), incr.end(), header.strides);
+    seal_binary_header(header);
+    return header;
+}
+
+// READS THE HEADER OF A VERSION 2 FILE IN NATIVE BYTE ORDER, OR REWINDS AND RETURNS FALSE FOR LEGACY FILES
+static bool read_binary_header(istream &in, const string &path, BinaryHeader &header, bool &swapped)
+{
+    char magic[8] = {};
+    in.read(magic, sizeof(magic));
+    if(!in || memcmp(magic, BINARY_MAGIC, sizeof(BINARY_MAGIC))!=0)
+    {
+        in.clear();
+        in.seekg(0);
+        return false;
+    }
+    in.seekg(0);
+    in.read((char*)&header, sizeof(BinaryHeader));
+    string err_str = "TensorUtils::TensorBase<T>::read_binary:: Corrupted header in file \"";
+    err_str.append(path);
+    err_str.append("\".");
+    if(!in)
+    {
+        throw CorruptFile(err_str);
+    }
+    uint32_t header_crc = crc32_update(0, (const char*)&header, offsetof(BinaryHeader, header_crc));
+    swapped = header.byte_order != BINARY_BYTE_ORDER;
+    if(swapped)
+    {
+        swap_field(header.version);
+        swap_field(header.byte_order);
+        swap_field(header.elem_size);
+        swap_field(header.rank);
+        swap_field(header.data_size);
+        swap_field(header.data_offset);
+        swap_field(header.chunk_size);
+        swap_field(header.checksum_offset);
+        for(size_t n=0; n<BINARY_MAX_RANK; n++)
+        {
+            swap_field(header.shape[n]);
+            swap_field(header.strides[n]);
+        }
+        swap_field(header.encoding);
+        swap_field(header.symmetric);
+        swap_field(header.header_crc);
+    }
+    if(header.byte_order != BINARY_BYTE_ORDER || header.header_crc != header_crc || header.rank > BINARY_MAX_RANK)
+    {
+        throw CorruptFile(err_str);
+    }
+    if(header.version != BINARY_VERSION)
+    {
+        err_str = "TensorUtils::TensorBase<T>::read_binary:: Unsupported version of file \"";
+        err_str.append(path);
+        err_str.append("\".");
+        throw CorruptFile(err_str);
+    }
+    return true;
+}
+
+// FILE EXTENSION THAT DETERMINES THE FORMAT: THE TYPE IN THE HEADER OF VERSION 2 FILES, ELSE THE EXTENSION OF THE PATH
+static string binary_extension(const string &path)
+{
+    string extension = filesystem::path(path).extension();
+    ifstream in(path, ios::in | ios::binary);
+    BinaryHeader header;
+    bool swapped;
+    if(in && read_binary_header(in, path, header, swapped))
+    {
+        extension = ".";
+        extension.append(header.dtype, strnlen(header.dtype, sizeof(header.dtype)));
+    }
+    return extension;
+}
+
+// CONVERTS DATA TO BUFFER_TYPE IN BLOCKS AND WRITES IT
+template<class BUFFER_TYPE, class T>
+static void write_payload(ostream &out, const T* data, size_t num_elems, ChunkChecksums &checksums)
+{
+    if constexpr(is_same<BUFFER_TYPE,T>::value)
+    {
+        out.write((const char*)data, num_elems*sizeof(T));
+        checksums.update((const char*)data, num_elems*sizeof(T));
+    }
+    else
+    {
+        vector<BUFFER_TYPE> buffer(min<size_t>(num_elems, BINARY_CHUNK_SIZE/sizeof(BUFFER_TYPE)));
+        for(size_t n=0; n<num_elems; n+=buffer.size())
+        {
+            size_t num = min(buffer.size(), num_elems-n);
+            for(size_t k=0; k<num; k++)
+            {
+                buffer[k] = data[n+k];
+            }
+            out.write((const char*)&buffer[0], num*sizeof(BUFFER_TYPE));
+            checksums.update((const char*)&buffer[0], num*sizeof(BUFFER_TYPE));
+        }
+    }
+}
+
+// DIMENSION M, IF THE TENSOR IS A SYMMETRIC M x M MATRIX WITH RESPECT TO THE FIRST AND SECOND HALF OF ITS INDICES, ELSE ZERO
+template<class T>
+static size_t symmetric_dimension(const TensorBase<T> &tensor)
+{
+    size_t rank = tensor.shape.size();
+    if(rank<2 || rank%2!=0 || !equal(tensor.shape.begin(), tensor.shape.begin()+rank/2, tensor.shape.begin()+rank/2))
+    {
+        return 0;
+    }
+    size_t dim = tensor.incr[rank/2-1]; // product of the second half of the shape
+    const T* data = tensor.data();
+    const size_t tile = 64;
+    for(size_t a0=0; a0<dim; a0+=tile)
+    {
+        for(size_t b0=a0; b0<dim; b0+=tile)
+        {
+            for(size_t a=a0; a<min(a0+tile,dim); a++)
+            {
+                for(size_t b=max(b0,a+1); b<min(b0+tile,dim); b++)
+                {
+                    if(!(data[a*dim+b]==data[b*dim+a]))
+                    {
+                        return 0;
+                    }
+                }
+            }
+        }
+    }
+    return dim;
+}
+
+// COPIES THE UPPER TRIANGLE OF A DIM x DIM MATRIX TO ITS LOWER TRIANGLE TILE BY TILE
+template<class T>
+static void mirror_upper_triangle(T* data, size_t dim)
+{
+    const size_t tile = 64;
+    for(size_t a0=0; a0<dim; a0+=tile)
+    {
+        for(size_t b0=a0; b0<dim; b0+=tile)
+        {
+            for(size_t b=b0; b<min(b0+tile,dim); b++)
+            {
+                for(size_t a=a0; a<min(a0+tile,b); a++)
+                {
+                    data[b*dim+a] = data[a*dim+b];
+                }
+            }
+        }
+    }
+}
+
+// WRITES THE CHUNK TABLE, THE COMPRESSED CHUNKS AND THEIR CHECKSUMS, CHUNKS ARE CONVERTED AND COMPRESSED IN PARALLEL
+template<class BUFFER_TYPE, class T>
+static void write_compressed_payload(ostream &out, const T* data, size_t num_elems, BinaryHeader &header)
+{
+    size_t elems_per_chunk = header.chunk_size/sizeof(BUFFER_TYPE);
+    size_t num_chunks = (num_elems+elems_per_chunk-1)/elems_per_chunk;
+    vector<uint64_t> offsets(num_chunks+1, 0);
+    vector<uint32_t> crc(num_chunks);
+    out.seekp(header.data_offset);
+    out.write((const char*)offsets.data(), offsets.size()*sizeof(uint64_t)); // placeholder
+    offsets[0] = offsets.size()*sizeof(uint64_t);
+
+    size_t batch_size = 4*max(1u, thread::hardware_concurrency());
+    vector<vector<char>> stored(min(batch_size, num_chunks));
+    for(size_t first=0; first<num_chunks; first+=batch_size)
+    {
+        size_t num = min(batch_size, num_chunks-first);
+        parallel_for(num, [&](size_t k)
+        {
+            size_t begin = (first+k)*elems_per_chunk;
+            size_t num_chunk_elems = min(elems_per_chunk, num_elems-begin);
+            size_t num_bytes = num_chunk_elems*sizeof(BUFFER_TYPE);
+            // ONLY A TYPE CONVERSION REQUIRES A COPY OF THE CHUNK
+            const char* raw = (const char*)(data+begin);
+            vector<BUFFER_TYPE> converted;
+            if constexpr(!is_same<BUFFER_TYPE,T>::value)
+            {
+                converted.assign(data+begin, data+begin+num_chunk_elems);
+                raw = (const char*)converted.data();
+            }
+            crc[first+k] = crc32_update(0, raw, num_bytes);
+            vector<char> shuffled(num_bytes);
+            shuffle_bytes(raw, shuffled.data(), sizeof(BUFFER_TYPE), num_chunk_elems);
+            vector<unsigned char> packed;
+            lz_compress(shuffled.data(), num_bytes, packed);
+            if(packed.size()<num_bytes)
+            {
+                stored[k].assign(packed.begin(), packed.end());
+            }
+            else
+            {
+                stored[k].assign(raw, raw+num_bytes);
+            }
+        });
+        for(size_t k=0; k<num; k++)
+        {
+            out.write(stored[k].data(), stored[k].size());
+            offsets[first+k+1] = offsets[first+k]+stored[k].size();
+        }
+    }
+    header.checksum_offset = header.data_offset+offsets.back();
+    out.write((const char*)crc.data(), crc.size()*sizeof(uint32_t));
+    out.seekp(header.data_offset);
+    out.write((const char*)offsets.data(), offsets.size()*sizeof(uint64_t));
+}
+
+// HANDLES A DECODED CHUNK OF THE PAYLOAD IN NATIVE BYTE ORDER, GIVEN ITS BYTE OFFSET, DATA AND SIZE
+typedef function<void(size_t, const char*, size_t)> ChunkStore;
+
+// READS THE CHUNK TABLE AND DECOMPRESSES AND VERIFIES THE CHUNKS IN BATCHES, THE CHUNKS OF A BATCH IN PARALLEL
+// CHUNK k IS DECODED TO dst+k*chunk_size, OR TO A BUFFER OF THE BATCH IF dst IS A NULL POINTER, AND PASSED TO store
+static void read_compressed_payload(istream &in, const string &path, const BinaryHeader &header, bool swapped, char* dst, size_t num_bytes, const ChunkStore &store)
+{
+    string err_str = "TensorUtils::TensorBase<T>::read_binary:: Corrupted compressed data in file \"";
+    err_str.append(path);
+    err_str.append("\".");
+    uint64_t chunk_size = header.chunk_size;
+    if(chunk_size==0 || chunk_size%header.elem_size!=0)
+    {
+        throw CorruptFile(err_str);
+    }
+    size_t num_chunks = (num_bytes+chunk_size-1)/chunk_size;
+    vector<uint64_t> offsets(num_chunks+1);
+    vector<uint32_t> crc(num_chunks);
+    in.seekg(header.data_offset);
+    in.read((char*)offsets.data(), offsets.size()*sizeof(uint64_t));
+    in.seekg(header.checksum_offset);
+    in.read((char*)crc.data(), crc.size()*sizeof(uint32_t));
+    if(swapped)
+    {
+        swap_bytes((char*)offsets.data(), sizeof(uint64_t), offsets.size());
+        swap_bytes((char*)crc.data(), sizeof(uint32_t), crc.size());
+    }
+    if(!in || offsets[0]!=offsets.size()*sizeof(uint64_t) || !is_sorted(offsets.begin(), offsets.end()))
+    {
+        throw CorruptFile(err_str);
+    }
+
+    size_t batch_size = 4*max(1u, thread::hardware_concurrency());
+    vector<char> stored;
+    vector<vector<char>> decoded(dst==nullptr ? min(batch_size, num_chunks) : 0);
+    for(size_t first=0; first<num_chunks; first+=batch_size)
+    {
+        size_t num = min(batch_size, num_chunks-first);
+        stored.resize(offsets[first+num]-offsets[first]);
+        in.seekg(header.data_offset+offsets[first]);
+        in.read(stored.data(), stored.size());
+        if(!in)
+        {
+            throw CorruptFile(err_str);
+        }
+        parallel_for(num, [&](size_t k)
+        {
+            size_t c = first+k;
+            size_t num_chunk_bytes = min<uint64_t>(chunk_size, num_bytes-c*chunk_size);
+            size_t num_stored = offsets[c+1]-offsets[c];
+            const char* src = stored.data()+offsets[c]-offsets[first];
+            char* chunk = dst+c*chunk_size;
+            if(dst==nullptr)
+            {
+                decoded[k].resize(num_chunk_bytes);
+                chunk = decoded[k].data();
+            }
+            if(num_stored==num_chunk_bytes)
+            {
+                memcpy(chunk, src, num_stored);
+            }
+            else
+            {
+                vector<char> shuffled(num_chunk_bytes);
+                if(num_stored>num_chunk_bytes || !lz_decompress(src, num_stored, shuffled.data(), num_chunk_bytes))
+                {
+                    throw CorruptFile(err_str);
+                }
+                unshuffle_bytes(shuffled.data(), chunk, header.elem_size, num_chunk_bytes/header.elem_size);
+            }
+            if(crc32_update(0, chunk, num_chunk_bytes)!=crc[c])
+            {
+                string crc_err = "TensorUtils::TensorBase<T>::read_binary:: Checksum mismatch in file \"";
+                crc_err.append(path);
+                crc_err.append("\".");
+                throw CorruptFile(crc_err);
+            }
+            if(swapped)
+            {
+                swap_bytes(chunk, header.elem_size, num_chunk_bytes/header.elem_size);
+            }
+            store(c*chunk_size, chunk, num_chunk_bytes);
+        });
+    }
+}
+
+// READS THE PAYLOAD IN CHUNKS AND VERIFIES THEIR CHECKSUMS, SEE read_compressed_payload
+static void read_raw_payload(istream &in, const string &path, const BinaryHeader &header, bool swapped, char* dst, size_t num_bytes, const ChunkStore &store)
+{
+    string err_str = "TensorUtils::TensorBase<T>::read_binary:: ";
+    size_t block_size = max<uint64_t>(1, (header.chunk_size>0 ? header.chunk_size : BINARY_CHUNK_SIZE)/header.elem_size)*header.elem_size;
+    vector<char> buffer(dst==nullptr ? min(block_size, num_bytes) : 0);
+    ChunkChecksums checksums(header.chunk_size);
+    in.seekg(header.data_offset);
+    for(size_t begin=0; begin<num_bytes; begin+=block_size)
+    {
+        size_t num = min(block_size, num_bytes-begin);
+        char* block = dst==nullptr ? buffer.data() : dst+begin;
+        in.read(block, num);
+        if(size_t(in.gcount()) != num)
+        {
+            err_str.append("Less data than expected from header in file \"");
+            err_str.append(path);
+            err_str.append("\".");
+            throw CorruptFile(err_str);
+        }
+        if(header.chunk_size>0)
+        {
+            checksums.update(block, num);
+        }
+        if(swapped)
+        {
+            swap_bytes(block, header.elem_size, num/header.elem_size);
+        }
+        store(begin, block, num);
+    }
+    if(header.chunk_size>0)
+    {
+        vector<uint32_t> expected(checksums.finish().size());
+        in.seekg(header.checksum_offset);
+        in.read((char*)expected.data(), expected.size()*sizeof(uint32_t));
+        if(swapped)
+        {
+            swap_bytes((char*)expected.data(), sizeof(uint32_t), expected.size());
+        }
+        if(!in || expected != checksums.finish())
+        {
+            err_str.append("Checksum mismatch in file \"");
+            err_str.append(path);
+            err_str.append("\".");
+            throw CorruptFile(err_str);
+        }
+    }
+}
+
+// READS THE PAYLOAD OF A VERSION 2 FILE AND STORES IT ROW-MAJOR USING IMPLICIT TYPE CONVERSIONS
+template<class BUFFER_TYPE, class T>
+static void read_binary_payload(istream &in, const string &path, const BinaryHeader &header, bool swapped, TensorBase<T> &tensor)
+{
+    string err_str = "TensorUtils::TensorBase<T>::read_binary:: ";
+    if(header.elem_size != sizeof(BUFFER_TYPE))
+    {
+        err_str.append("Component size does not match the type in file \"");
+        err_str.append(path);
+        err_str.append("\".");
+        throw CorruptFile(err_str);
+    }
+    vector<size_t> shape(header.shape, header.shape+header.rank);
+    vector<size_t> strides(header.strides, header.strides+header.rank);
+    size_t num_elems = 1;
+    size_t max_offset = 0;
+    for(size_t d=0; d<shape.size(); d++)
+    {
+        num_elems *= shape[d];
+        max_offset += shape[d]>0 ? (shape[d]-1)*strides[d] : 0;
+    }
+    size_t dim = 1;
+    for(size_t d=0; d<shape.size()/2; d++)
+    {
+        dim *= shape[d];
+    }
+    if(header.symmetric ? header.data_size!=dim*(dim+1)/2 || dim*dim!=num_elems : num_elems>0 && max_offset>=header.data_size)
+    {
+        err_str.append("Less data than expected from shape in file \"");
+        err_str.append(path);
+        err_str.append("\".");
+        throw ShapeMismatch(err_str);
+    }
+    if(header.encoding!=BINARY_RAW && header.encoding!=BINARY_COMPRESSED)
+    {
+        err_str.append("Unsupported encoding of file \"");
+        err_str.append(path);
+        err_str.append("\".");
+        throw CorruptFile(err_str);
+    }
+
+    // A ROW-MAJOR PAYLOAD OF THE SAME TYPE IS READ STRAIGHT INTO THE TENSOR, A STRIDED PAYLOAD IS GATHERED FROM A BUFFER
+    // AND ALL OTHERS ARE CONVERTED CHUNK BY CHUNK, SUCH THAT THE WHOLE PAYLOAD IS NEVER HELD TWICE
+    tensor.alloc_uninitialized(shape);
+    bool strided = !header.symmetric && num_elems>0 && strides!=tensor.incr;
+    bool direct = is_same<BUFFER_TYPE,T>::value && !header.symmetric && !strided && header.data_size==num_elems;
+    vector<BUFFER_TYPE> buffer(strided ? header.data_size : 0);
+    char* dst = direct ? (char*)tensor.data() : strided ? (char*)buffer.data() : nullptr;
+    T* data = tensor.data();
+    ChunkStore store = [](size_t, const char*, size_t){};
+    if(header.symmetric)
+    {
+        // UNPACK UPPER TRIANGLE, ROW a STARTS AT a*(2*dim-a+1)/2
+        store = [&](size_t begin, const char* chunk, size_t num_bytes)
+        {
+            const BUFFER_TYPE* src = (const BUFFER_TYPE*)chunk;
+            size_t pos = begin/sizeof(BUFFER_TYPE);
+            size_t num = num_bytes/sizeof(BUFFER_TYPE);
+            size_t a = 0;
+            size_t a_end = dim;
+            while(a_end-a>1)
+            {
+                size_t mid = (a+a_end)/2;
+                if(mid*(2*dim-mid+1)/2<=pos)
+                {
+                    a = mid;
+                }
+                else
+                {
+                    a_end = mid;
+                }
+            }
+            size_t b = a+pos-a*(2*dim-a+1)/2;
+            while(num>0)
+            {
+                size_t run = min(num, dim-b);
+                copy(src, src+run, data+a*dim+b);
+                src += run;
+                num -= run;
+                a++;
+                b = a;
+            }
+        };
+    }
+    else if(!direct && !strided)
+    {
+        store = [&](size_t begin, const char* chunk, size_t num_bytes)
+        {
+            size_t pos = begin/sizeof(BUFFER_TYPE);
+            size_t num = pos<num_elems ? min(num_bytes/sizeof(BUFFER_TYPE), num_elems-pos) : 0;
+            copy((const BUFFER_TYPE*)chunk, (const BUFFER_TYPE*)chunk+num, data+pos);
+        };
+    }
+    size_t num_bytes = header.data_size*sizeof(BUFFER_TYPE);
+    if(header.encoding==BINARY_COMPRESSED)
+    {
+        read_compressed_payload(in, path, header, swapped, dst, num_bytes, store);
+    }
+    else
+    {
+        read_raw_payload(in, path, header, swapped, dst, num_bytes, store);
+    }
+    if(header.symmetric)
+    {
+        mirror_upper_triangle(data, dim);
+    }
+    if(!strided)
+    {
+        return;
+    }
+
+    // GATHER STRIDED PAYLOAD
+    vector<size_t> index(shape.size(), 0);
+    size_t offset = 0;
+    for(size_t n=0; n<num_elems; n++)
+    {
+        tensor[n] = buffer[offset];
+        for(size_t d=shape.size(); d>0; d--)
+        {
+            index[d-1]++;
+            offset += strides[d-1];
+            if(index[d-1]<shape[d-1])
+            {
+                break;
+            }
+            offset -= shape[d-1]*strides[d-1];
+            index[d-1] = 0;
+        }
+    }
+}
+
+// DESCRIBES A LEGACY FILE BY A VERSION 2 HEADER WITHOUT CHECKSUMS
+static void read_legacy_header(istream &in, const string &path, size_t elem_size, BinaryHeader &header)
+{
+    memset(&header, 0, sizeof(BinaryHeader));
+    in.read((char*)&header.rank, sizeof(size_t));
+    if(!in || header.rank > BINARY_MAX_RANK)
+    {
+        string err_str = "TensorUtils::TensorBase<T>::read_binary:: Corrupted header in file \"";
+        err_str.append(path);
+        err_str.append("\".");
+        throw CorruptFile(err_str);
+    }
+    in.read((char*)header.shape, header.rank*sizeof(size_t));
+    in.read((char*)&header.data_size, sizeof(size_t));
+    header.elem_size = elem_size;
+    header.data_offset = (header.rank+2)*sizeof(size_t);
+    for(size_t d=header.rank, stride=1; d>0; d--)
+    {
+        header.strides[d-1] = stride;
+        stride *= header.shape[d-1];
+    }
+}
+
+// COMPLETES AND CLIPS THE BOUNDS OF A SUB-BLOCK OF A TENSOR OF THE GIVEN SHAPE
+static void clip_block(const vector<size_t> &shape, vector<size_t> &begin, vector<size_t> &end)
+{
+    if(begin.size()!=end.size() || begin.size()>shape.size())
+    {
+        throw ShapeMismatch("TensorUtils::TensorBase<T>::read:: Invalid number of indices!");
+    }
+    begin.resize(shape.size(), 0);
+    end.resize(shape.size(), size_t(-1));
+    for(size_t d=0; d<shape.size(); d++)
+    {
+        end[d] = min(end[d], shape[d]);
+        if(begin[d]>end[d])
+        {
+            throw out_of_range("TensorUtils::TensorBase<T>::read:: Index out of range!");
+        }
+    }
+}
+
+// REDUCES A TENSOR TO A SUB-BLOCK
+template<class T>
+static void slice_block(TensorBase<T> &tensor, vector<size_t> begin, vector<size_t> end)
+{
+    clip_block(tensor.shape, begin, end);
+    TensorView<T> view(tensor);
+    for(unsigned d=0; d<tensor.shape.size(); d++)
+    {
+        view = view.range(d, begin[d], end[d]);
+    }
+    tensor = view.copy();
+}
+
+// READS A SUB-BLOCK OF THE PAYLOAD BY ONE POSITIONED READ PER CONTIGUOUS RUN
+template<class BUFFER_TYPE, class T>
+static void read_binary_block(istream &in, const string &path, const BinaryHeader &header, bool swapped, vector<size_t> begin, vector<size_t> end, TensorBase<T> &tensor)
+{
+    string err_str = "TensorUtils::TensorBase<T>::read_binary:: ";
+    if(header.elem_size != sizeof(BUFFER_TYPE))
+    {
+        err_str.append("Component size does not match the type in file \"");
+        err_str.append(path);
+        err_str.append("\".");
+        throw CorruptFile(err_str);
+    }
+    size_t rank = header.rank;
+    vector<size_t> shape(header.shape, header.shape+rank);
+    const uint64_t* strides = header.strides;
+    clip_block(shape, begin, end);
+    vector<size_t> block_shape(rank);
+    size_t num_elems = 1;
+    size_t max_offset = 0;
+    for(size_t d=0; d<rank; d++)
+    {
+        block_shape[d] = end[d]-begin[d];
+        num_elems *= shape[d];
+        max_offset += shape[d]>0 ? (shape[d]-1)*strides[d] : 0;
+    }
+    if(num_elems>0 && max_offset>=header.data_size)
+    {
+        err_str.append("Less data than expected from shape in file \"");
+        err_str.append(path);
+        err_str.append("\".");
+        throw ShapeMismatch(err_str);
+    }
+
+    tensor.alloc_uninitialized(block_shape);
+    if(tensor.empty())
+    {
+        return;
+    }
+
+    // MERGE TRAILING AXES THAT ARE CONTIGUOUS IN THE FILE INTO ONE RUN
+    size_t run = 1;
+    size_t outer = rank;
+    while(outer>0 && strides[outer-1]==run)
+    {
+        run *= block_shape[outer-1];
+        outer--;
+        if(block_shape[outer]!=shape[outer])
+        {
+            break;
+        }
+    }
+
+    vector<BUFFER_TYPE> buffer(run);
+    vector<size_t> index(begin.begin(), begin.begin()+outer);
+    for(size_t n=0; n<tensor.size(); n+=run)
+    {
+        uint64_t offset = 0;
+        for(size_t d=0; d<rank; d++)
+        {
+            offset += (d<outer ? index[d] : begin[d])*strides[d];
+        }
+        in.seekg(header.data_offset + offset*sizeof(BUFFER_TYPE));
+        in.read((char*)buffer.data(), run*sizeof(BUFFER_TYPE));
+        if(!in)
+        {
+            err_str.append("Less data than expected from header in file \"");
+            err_str.append(path);
+            err_str.append("\".");
+            throw CorruptFile(err_str);
+        }
+        if(swapped)
+        {
+            swap_bytes((char*)buffer.data(), sizeof(BUFFER_TYPE), run);
+        }
+        copy(buffer.begin(), buffer.end(), tensor.begin()+n);
+        for(size_t d=outer; d>0; d--)
+        {
+            index[d-1]++;
+            if(index[d-1]<end[d-1])
+            {
+                break;
+            }
+            index[d-1] = begin[d-1];
+        }
+    }
+}
+
 /**
     READ
 **/
@@ -184,7 +1192,7 @@ void TensorBase<signed char>::print()
 template<class T>
 void TensorBase<T>::read(string path)
 {
-    string extension = filesystem::path(path).extension();
+    string extension = binary_extension(path);
     if(extension == ".f32")    {read_bin<float>(path);}
     else if(extension == ".f64")    {read_bin<double>(path);}
     else if(extension == ".f80")    {read_bin<long double>(path);}
@@ -244,7 +1252,7 @@ void TensorBase<T>::read_txt(string path)
         {
             while (ss >> tmp)
             {
-                if(idx < vector<T>::size())
+                if(idx < storage_type::size())
                 {
                     (*this)[idx] = tmp;
                     idx++;
@@ -268,7 +1276,7 @@ void TensorBase<T>::read_txt(string path)
         err_str.append("\".");
         throw ShapeMismatch(err_str);
     }
-    if(idx<vector<T>::size())
+    if(idx<storage_type::size())
     {
         string err_str = "TensorUtils::TensorBase<T>::read_txt:: Less data than expected from shape in file \"";
         err_str.append(path);
@@ -308,6 +1316,15 @@ void TensorBase<T>::read_bin(string path)
         throw UnableToOpenFile(err_str);
     }
 
+    BinaryHeader header;
+    bool swapped;
+    if(read_binary_header(in, path, header, swapped))
+    {
+        read_binary_payload<BUFFER_TYPE>(in, path, header, swapped, *this);
+        return;
+    }
+
+    // legacy format
     size_t header_size;
     size_t data_size;
 
@@ -322,21 +1339,21 @@ void TensorBase<T>::read_bin(string path)
     // read data
     bool data_too_large = false;
     bool data_too_small = false;
-    if(vector<T>::size() < data_size)
+    if(storage_type::size() < data_size)
     {
         data_too_large = true;
     }
-    else if(vector<T>::size() > data_size)
+    else if(storage_type::size() > data_size)
     {
         data_too_small = true;
     }
-    size_t num_expected = vector<T>::size();
+    size_t num_expected = storage_type::size();
 
-    vector<T>::resize(data_size);
+    storage_type::resize(data_size);
 
     vector<BUFFER_TYPE> buffer(data_size);
     in.read((char*)&buffer[0], data_size*sizeof(BUFFER_TYPE));
-    auto it2 = vector<T>::begin();
+    auto it2 = storage_type::begin();
     for(auto it=buffer.begin(); it!= buffer.end(); it++)
     {
         *it2 = *it;
@@ -347,7 +1364,7 @@ void TensorBase<T>::read_bin(string path)
 
     if(data_too_large)
     {
-        vector<T>::resize(num_expected);
+        storage_type::resize(num_expected);
         string err_str = "TensorUtils::TensorBase<T>::read_binary:: More data than expected from shape in file \"";
         err_str.append(path);
         err_str.append("\".");
@@ -355,7 +1372,7 @@ void TensorBase<T>::read_bin(string path)
     }
     if(data_too_small)
     {
-        while(vector<T>::size()<num_expected)
+        while(storage_type::size()<num_expected)
         {
             this->push_back(0);
         }
@@ -366,6 +1383,71 @@ void TensorBase<T>::read_bin(string path)
     }
 }
 
+// MAIN FUNCTION TO READ A SUB-BLOCK
+template<class T>
+void TensorBase<T>::read(string path, const vector<size_t> &begin, const vector<size_t> &end)
+{
+    string extension = binary_extension(path);
+    if(extension == ".f32")    {read_bin_block<float>(path, begin, end);}
+    else if(extension == ".f64")    {read_bin_block<double>(path, begin, end);}
+    else if(extension == ".f80")    {read_bin_block<long double>(path, begin, end);}
+    else if(extension == ".uc")     {read_bin_block<unsigned char>(path, begin, end);}
+    else if(extension == ".sc")     {read_bin_block<signed char>(path, begin, end);}
+    else if(extension == ".us")     {read_bin_block<unsigned short>(path, begin, end);}
+    else if(extension == ".s")      {read_bin_block<short>(path, begin, end);}
+    else if(extension == ".u")      {read_bin_block<unsigned>(path, begin, end);}
+    else if(extension == ".int")    {read_bin_block<int>(path, begin, end);}
+    else if(extension == ".ul")     {read_bin_block<unsigned long>(path, begin, end);}
+    else if(extension == ".l")      {read_bin_block<long>(path, begin, end);}
+    else if(extension == ".ull")    {read_bin_block<unsigned long long>(path, begin, end);}
+    else if(extension == ".ll")     {read_bin_block<long long>(path, begin, end);}
+    else
+    {
+        read_txt_helper(path);
+        slice_block(*this, begin, end);
+    }
+}
+
+template<class T>
+void TensorBase<T>::read(string path, unsigned axis, size_t begin, size_t end)
+{
+    vector<size_t> first(axis+1, 0);
+    vector<size_t> last(axis+1, size_t(-1));
+    first[axis] = begin;
+    last[axis] = end;
+    read(path, first, last);
+}
+
+// READ A SUB-BLOCK OF BINARY DATA TO A BUFFER OF TYPE BUFFER_TYPE AND STORE DATA USING IMPLICIT TYPE CONVERSIONS
+template<class T>
+template<class BUFFER_TYPE>
+void TensorBase<T>::read_bin_block(string path, const vector<size_t> &begin, const vector<size_t> &end)
+{
+    ifstream in(path, ios::in | ios::binary);
+    if(in.fail())
+    {
+        string err_str = "TensorUtils::TensorBase<T>::read_binary:: Unable to open file \"";
+        err_str.append(path);
+        err_str.append("\".");
+        throw UnableToOpenFile(err_str);
+    }
+
+    BinaryHeader header;
+    bool swapped = false;
+    if(!read_binary_header(in, path, header, swapped))
+    {
+        read_legacy_header(in, path, sizeof(BUFFER_TYPE), header);
+    }
+    if(header.encoding != BINARY_RAW || header.symmetric)
+    {
+        // COMPRESSED CHUNKS ARE DECODED ENTIRELY
+        read_binary_payload<BUFFER_TYPE>(in, path, header, swapped, *this);
+        slice_block(*this, begin, end);
+        return;
+    }
+    read_binary_block<BUFFER_TYPE>(in, path, header, swapped, begin, end, *this);
+}
+
 /**
     WRITE
 **/
@@ -373,25 +1455,36 @@ void TensorBase<T>::read_bin(string path)
 // MAIN FUNCTION TO WRITE ANY DATA
 template<class T>
 void TensorBase<T>::write(string oname, string folder)
+{
+    write(oname, folder, Encoding::raw);
+}
+
+// MAIN FUNCTION TO WRITE ANY DATA WITH SPECIFIED ENCODING OF BINARY FILES
+template<class T>
+void TensorBase<T>::write(string oname, string folder, Encoding encoding)
 {
     string extension = filesystem::path(oname).extension();
-    if(extension == ".f32")    {write_bin<float>(oname, folder);}
-    else if(extension == ".f64")    {write_bin<double>(oname, folder);}
-    else if(extension == ".f80")    {write_bin<long double>(oname, folder);}
-    else if(extension == ".uc")     {write_bin<unsigned char>(oname, folder);}
-    else if(extension == ".sc")     {write_bin<signed char>(oname, folder);}
-    else if(extension == ".us")     {write_bin<unsigned short>(oname, folder);}
-    else if(extension == ".s")      {write_bin<short>(oname, folder);}
-    else if(extension == ".u")      {write_bin<unsigned>(oname, folder);}
-    else if(extension == ".int")    {write_bin<int>(oname, folder);}
-    else if(extension == ".ul")     {write_bin<unsigned long>(oname, folder);}
-    else if(extension == ".l")      {write_bin<long>(oname, folder);}
-    else if(extension == ".ull")    {write_bin<unsigned long long>(oname, folder);}
-    else if(extension == ".ll")     {write_bin<long long>(oname, folder);}
-    else
+    if(extension == ".f32")    {write_bin<float>(oname, folder, encoding);}
+    else if(extension == ".f64")    {write_bin<double>(oname, folder, encoding);}
+    else if(extension == ".f80")    {write_bin<long double>(oname, folder, encoding);}
+    else if(extension == ".uc")     {write_bin<unsigned char>(oname, folder, encoding);}
+    else if(extension == ".sc")     {write_bin<signed char>(oname, folder, encoding);}
+    else if(extension == ".us")     {write_bin<unsigned short>(oname, folder, encoding);}
+    else if(extension == ".s")      {write_bin<short>(oname, folder, encoding);}
+    else if(extension == ".u")      {write_bin<unsigned>(oname, folder, encoding);}
+    else if(extension == ".int")    {write_bin<int>(oname, folder, encoding);}
+    else if(extension == ".ul")     {write_bin<unsigned long>(oname, folder, encoding);}
+    else if(extension == ".l")      {write_bin<long>(oname, folder, encoding);}
+    else if(extension == ".ull")    {write_bin<unsigned long long>(oname, folder, encoding);}
+    else if(extension == ".ll")     {write_bin<long long>(oname, folder, encoding);}
+    else if(encoding == Encoding::raw)
     {
         write_txt(oname, folder);
     }
+    else
+    {
+        throw std::runtime_error("Invalid file extension: extension for text file format, but packed or compressed binary file requested!");
+    }
 }
 
 template<class T>
@@ -493,7 +1586,7 @@ void TensorBase<T>::write_txt(
         out << *it << '\t';
     }
     out << '\n' << '\n';
-    for(size_t n=0;n<vector<T>::size();n++)
+    for(size_t n=0;n<storage_type::size();n++)
     {
         out << (BUFFER_TYPE)(*this)[n] << '\t';
         if(incr.empty())
@@ -514,7 +1607,7 @@ void TensorBase<T>::write_txt(
 // CONVERT DATA TO BUFFER_TYPE, THEN WRITE TO BINARY
 template<class T>
 template<class BUFFER_TYPE>
-void TensorBase<T>::write_bin(string oname, string folder)
+void TensorBase<T>::write_bin(string oname, string folder, Encoding encoding)
 {
     filesystem::create_directories(folder);
     string path = folder;
@@ -524,26 +1617,240 @@ void TensorBase<T>::write_bin(string oname, string folder)
     path.append(oname);
 
     ofstream out(path, ios::out | ios::binary);
+    if(out.fail())
+    {
+        string err_str = "TensorUtils::TensorBase<T>::write:: Unable to open file \"";
+        err_str.append(path);
+        err_str.append("\".");
+        throw UnableToOpenFile(err_str);
+    }
+
+    BinaryHeader header = make_binary_header(binary_dtype<BUFFER_TYPE>(), sizeof(BUFFER_TYPE), shape, incr, storage_type::size());
+
+    // store the upper triangle of symmetric matrices only
+    const T* data = storage_type::data();
+    size_t num_elems = storage_type::size();
+    size_t dim = encoding == Encoding::raw ? 0 : symmetric_dimension(*this);
+    if(dim>0)
+    {
+        header.symmetric = 1;
+        header.data_size = dim*(dim+1)/2;
+        header.checksum_offset = header.data_offset + header.data_size*sizeof(BUFFER_TYPE);
+    }
+
+    if(encoding == Encoding::compressed)
+    {
+        vector<T> packed;
+        if(dim>0)
+        {
+            packed.reserve(dim*(dim+1)/2);
+            for(size_t a=0; a<dim; a++)
+            {
+                packed.insert(packed.end(), data+a*dim+a, data+(a+1)*dim);
+            }
+            data = packed.data();
+            num_elems = packed.size();
+        }
+        header.encoding = BINARY_COMPRESSED;
+
+        // write data first and the header last
+        vector<char> padding(header.data_offset, 0);
+        out.write(padding.data(), padding.size());
+        write_compressed_payload<BUFFER_TYPE>(out, data, num_elems, header);
+        seal_binary_header(header);
+        out.seekp(0);
+        out.write((const char*)&header, sizeof(BinaryHeader));
+        out.close();
+        return;
+    }
+
+    // write header and pad to the page-aligned payload
+    seal_binary_header(header);
+    vector<char> padding(header.data_offset-sizeof(BinaryHeader), 0);
+    out.write((const char*)&header, sizeof(BinaryHeader));
+    out.write(padding.data(), padding.size());
+
+    // write data row by row of the upper triangle, followed by the checksum of each chunk
+    ChunkChecksums checksums(header.chunk_size);
+    if(dim>0)
+    {
+        for(size_t a=0; a<dim; a++)
+        {
+            write_payload<BUFFER_TYPE>(out, data+a*dim+a, dim-a, checksums);
+        }
+    }
+    else
+    {
+        write_payload<BUFFER_TYPE>(out, data, num_elems, checksums);
+    }
+    const vector<uint32_t> &crc = checksums.finish();
+    out.write((const char*)crc.data(), crc.size()*sizeof(uint32_t));
+
+    out.close();
+}
+
+// MAIN FUNCTION TO APPEND DATA ALONG THE FIRST AXIS
+template<class T>
+void TensorBase<T>::append(string oname, string folder)
+{
+    string extension = filesystem::path(oname).extension();
+    if(extension == ".f32")    {append_bin<float>(oname, folder);}
+    else if(extension == ".f64")    {append_bin<double>(oname, folder);}
+    else if(extension == ".f80")    {append_bin<long double>(oname, folder);}
+    else if(extension == ".uc")     {append_bin<unsigned char>(oname, folder);}
+    else if(extension == ".sc")     {append_bin<signed char>(oname, folder);}
+    else if(extension == ".us")     {append_bin<unsigned short>(oname, folder);}
+    else if(extension == ".s")      {append_bin<short>(oname, folder);}
+    else if(extension == ".u")      {append_bin<unsigned>(oname, folder);}
+    else if(extension == ".int")    {append_bin<int>(oname, folder);}
+    else if(extension == ".ul")     {append_bin<unsigned long>(oname, folder);}
+    else if(extension == ".l")      {append_bin<long>(oname, folder);}
+    else if(extension == ".ull")    {append_bin<unsigned long long>(oname, folder);}
+    else if(extension == ".ll")     {append_bin<long long>(oname, folder);}
+    else
+    {
+        throw std::runtime_error("Invalid file extension: append is only available for binary file formats!");
+    }
+}
+
+// CONVERT DATA TO BUFFER_TYPE, THEN APPEND TO BINARY
+template<class T>
+template<class BUFFER_TYPE>
+void TensorBase<T>::append_bin(string oname, string folder)
+{
+    if(shape.empty())
+    {
+        throw ShapeMismatch("TensorUtils::TensorBase<T>::append:: Scalars cannot be appended!");
+    }
+
+    string path = folder;
+    if(path.back() != '/' ){
+        path.append("/");
+    }
+    path.append(oname);
+
+    if(!filesystem::exists(path))
+    {
+        write_bin<BUFFER_TYPE>(oname, folder, Encoding::raw);
+        return;
+    }
+
+    fstream io(path, ios::in | ios::out | ios::binary);
+    if(io.fail())
+    {
+        string err_str = "TensorUtils::TensorBase<T>::append:: Unable to open file \"";
+        err_str.append(path);
+        err_str.append("\".");
+        throw UnableToOpenFile(err_str);
+    }
+
+    BinaryHeader header;
+    bool swapped;
+    if(read_binary_header(io, path, header, swapped))
+    {
+        vector<size_t> file_shape(header.shape, header.shape+header.rank);
+        vector<size_t> file_strides(header.strides, header.strides+header.rank);
+        if(header.rank != shape.size() || !equal(shape.begin()+1, shape.end(), file_shape.begin()+1))
+        {
+            string err_str = "TensorUtils::TensorBase<T>::append:: Shape does not match the shape in file \"";
+            err_str.append(path);
+            err_str.append("\".");
+            throw ShapeMismatch(err_str);
+        }
+        if(swapped || header.elem_size != sizeof(BUFFER_TYPE) || header.encoding != BINARY_RAW || header.symmetric
+           || file_strides != incr || header.data_size != file_shape[0]*incr[0])
+        {
+            string err_str = "TensorUtils::TensorBase<T>::append:: Byte order, type or layout does not match the file \"";
+            err_str.append(path);
+            err_str.append("\".");
+            throw ShapeMismatch(err_str);
+        }
+
+        // checksums of complete chunks remain valid, the remainder is read back
+        uint64_t num_bytes = header.data_size*sizeof(BUFFER_TYPE);
+        uint64_t chunk_size = header.chunk_size>0 ? header.chunk_size : BINARY_CHUNK_SIZE;
+        vector<uint32_t> crc(header.chunk_size>0 ? num_bytes/chunk_size : 0);
+        io.seekg(header.checksum_offset);
+        io.read((char*)crc.data(), crc.size()*sizeof(uint32_t));
+        ChunkChecksums checksums(chunk_size, crc);
+        vector<char> tail(min(chunk_size, num_bytes));
+        for(uint64_t pos=crc.size()*chunk_size; pos<num_bytes; pos+=tail.size())
+        {
+            size_t num = min<uint64_t>(tail.size(), num_bytes-pos);
+            io.seekg(header.data_offset+pos);
+            io.read(tail.data(), num);
+            checksums.update(tail.data(), num);
+        }
+        if(!io)
+        {
+            string err_str = "TensorUtils::TensorBase<T>::append:: Unable to read back data of file \"";
+            err_str.append(path);
+            err_str.append("\".");
+            throw CorruptFile(err_str);
+        }
+
+        // disable checksums until the data is complete, such that the file remains readable if interrupted
+        header.chunk_size = 0;
+        seal_binary_header(header);
+        io.seekp(0);
+        io.write((const char*)&header, sizeof(BinaryHeader));
+        io.flush();
+
+        // write data behind the last valid element, followed by the checksums
+        io.seekp(header.data_offset + num_bytes);
+        write_payload<BUFFER_TYPE>(io, storage_type::data(), storage_type::size(), checksums);
+        io.write((const char*)checksums.finish().data(), checksums.finish().size()*sizeof(uint32_t));
+        io.flush();
+
+        // update header
+        header.shape[0] += shape[0];
+        header.data_size += storage_type::size();
+        header.chunk_size = chunk_size;
+        header.checksum_offset = header.data_offset + header.data_size*sizeof(BUFFER_TYPE);
+        seal_binary_header(header);
+        io.seekp(0);
+        io.write((const char*)&header, sizeof(BinaryHeader));
+        io.close();
+        return;
+    }
 
-    size_t header_size = shape.size();
-    size_t data_size = vector<T>::size();
+    // legacy format
+    size_t header_size;
+    size_t data_size;
+    io.read((char*)&header_size, sizeof(size_t));
+    vector<size_t> file_shape(header_size);
+    io.read((char*)&file_shape[0], header_size*sizeof(size_t));
+    io.read((char*)&data_size, sizeof(size_t));
 
-    // write header
-    out.write((char*)&header_size, sizeof(size_t));
-    out.write((char*)&shape[0], header_size*sizeof(size_t));
-    out.write((char*)&data_size, sizeof(size_t));
+    if(header_size != shape.size() || !equal(shape.begin()+1, shape.end(), file_shape.begin()+1))
+    {
+        string err_str = "TensorUtils::TensorBase<T>::append:: Shape does not match the shape in file \"";
+        err_str.append(path);
+        err_str.append("\".");
+        throw ShapeMismatch(err_str);
+    }
 
-    // write data
-    vector<BUFFER_TYPE> buffer(vector<T>::size());
-    auto it2 = vector<T>::begin();
+    // write data behind the last valid element
+    vector<BUFFER_TYPE> buffer(storage_type::size());
+    auto it2 = storage_type::begin();
     for(auto it=buffer.begin();it!=buffer.end();it++)
     {
         *it = *it2;
         it2++;
     }
-    out.write((char*)&buffer[0], data_size*sizeof(BUFFER_TYPE));
+    streamoff data_begin = (header_size+2)*sizeof(size_t);
+    io.seekp(data_begin + data_size*sizeof(BUFFER_TYPE));
+    io.write((char*)&buffer[0], buffer.size()*sizeof(BUFFER_TYPE));
+    io.flush();
 
-    out.close();
+    // update header
+    file_shape[0] += shape[0];
+    data_size += storage_type::size();
+    io.seekp(sizeof(size_t));
+    io.write((char*)&file_shape[0], header_size*sizeof(size_t));
+    io.write((char*)&data_size, sizeof(size_t));
+
+    io.close();
 }
 
 template<class T>
@@ -573,30 +1880,139 @@ TensorBase<T> TensorBase<T>::transpose(const vector<unsigned> &axes)
         shape2.push_back(shape[*it]);
     }
 
-    TensorBase<T> result(shape2);
+    TensorBase<T> result;
+    result.alloc_uninitialized(shape2);
+    if(result.empty())
+    {
+        return result;
+    }
+    if(shape.empty())
+    {
+        result[0] = (*this)[0];
+        return result;
+    }
+
+    // REDUCE THE PERMUTATION: DROP AXES OF LENGTH ONE AND MERGE AXES THAT ARE CONTIGUOUS IN BOTH TENSORS
+    vector<size_t> n;           // extents
+    vector<size_t> src_incr;    // increments in *this
+    for(size_t d=0; d<axes.size(); d++)
+    {
+        if(shape2[d]==1)
+        {
+            continue;
+        }
+        if(!n.empty() && src_incr.back() == incr[axes[d]]*shape2[d])
+        {
+            n.back() *= shape2[d];
+            src_incr.back() = incr[axes[d]];
+        }
+        else
+        {
+            n.push_back(shape2[d]);
+            src_incr.push_back(incr[axes[d]]);
+        }
+    }
+    size_t rank = n.size();
+    if(rank<=1) // identity
+    {
+        copy(storage_type::begin(), storage_type::end(), result.begin());
+        return result;
+    }
+    vector<size_t> dst_incr(rank);
+    dst_incr.back() = 1;
+    for(size_t d=rank-1; d>0; d--)
+    {
+        dst_incr[d-1] = dst_incr[d]*n[d];
+    }
+
+    // THE LAST AXIS OF THE RESULT IS EITHER CONTIGUOUS IN *this (COPY ROWS)
+    // OR IT IS SWAPPED WITH THE AXIS p THAT IS CONTIGUOUS IN *this (COPY TILES)
+    size_t q = rank-1;
+    size_t p = rank;
+    if(src_incr[q] != 1)
+    {
+        for(size_t d=0; d<q; d++)
+        {
+            if(src_incr[d]==1)
+            {
+                p = d;
+            }
+        }
+    }
 
-    vector<size_t> index(shape.size());
-    vector<size_t> index2(shape2.size());
-    
-    function<void(unsigned)> iterate = [&](unsigned dim2)
+    // ITERATE OVER ALL REMAINING AXES WITHOUT RECURSION
+    vector<size_t> outer;
+    for(size_t d=0; d<q; d++)
+    {
+        if(d!=p)
+        {
+            outer.push_back(d);
+        }
+    }
+    vector<size_t> index(outer.size(), 0);
+    const T* src = &(*this)[0];
+    T* dst = &result[0];
+    size_t src_pos = 0;
+    size_t dst_pos = 0;
+    const size_t block = 32;
+    while(true)
     {
-        index[axes[dim2]]=0;
-        index2[dim2]=0;
-        while(index2[dim2]<shape2[dim2])
+        if(src_incr[q] == 1)
+        {
+            copy(src+src_pos, src+src_pos+n[q], dst+dst_pos);
+        }
+        else if(p == rank)
         {
-            if( dim2 == shape2.size()-1 )
+            for(size_t j=0; j<n[q]; j++)
             {
-                result(index2) = (*this)(index);
+                dst[dst_pos+j] = src[src_pos+j*src_incr[q]];
             }
-            else
+        }
+        else
+        {
+            for(size_t i0=0; i0<n[p]; i0+=block)
             {
-                iterate(dim2+1);
+                size_t i1 = min(i0+block, n[p]);
+                for(size_t j0=0; j0<n[q]; j0+=block)
+                {
+                    size_t j1 = min(j0+block, n[q]);
+                    for(size_t i=i0; i<i1; i++)
+                    {
+                        const T* src_row = src+src_pos+i;
+                        T* dst_row = dst+dst_pos+i*dst_incr[p];
+                        for(size_t j=j0; j<j1; j++)
+                        {
+                            dst_row[j] = src_row[j*src_incr[q]];
+                        }
+                    }
+                }
             }
-            index[axes[dim2]]++;
-            index2[dim2]++;
         }
-    };
-    iterate(0);
+        size_t k = outer.size();
+        while(k>0)
+        {
+            k--;
+            size_t d = outer[k];
+            index[k]++;
+            src_pos += src_incr[d];
+            dst_pos += dst_incr[d];
+            if(index[k]<n[d])
+            {
+                break;
+            }
+            src_pos -= n[d]*src_incr[d];
+            dst_pos -= n[d]*dst_incr[d];
+            index[k] = 0;
+            if(k==0)
+            {
+                return result;
+            }
+        }
+        if(outer.empty())
+        {
+            return result;
+        }
+    }
 
     return result;
 }
@@ -610,7 +2026,8 @@ TensorBase<T> TensorBase<T>::slice(const std::vector<size_t> &idx_at)
     }
     vector<size_t> final_shape(shape);
     final_shape.erase(final_shape.begin(),final_shape.begin()+idx_at.size());
-    TensorBase<T> result(final_shape);
+    TensorBase<T> result;
+    result.alloc_uninitialized(final_shape);
     result.assign((*this), {}, idx_at);
     return result;
 }
@@ -620,7 +2037,7 @@ TensorBase<T>& TensorBase<T>::reshape(const std::vector<size_t> &shape)
 {
     if(shape.empty())
     {
-        if(THROW_BASIC_EXCEPTIONS && 1 != vector<T>::size())
+        if(THROW_BASIC_EXCEPTIONS && 1 != storage_type::size())
         {
             throw ShapeMismatch("TensorBase<T>::reshape(const std::vector<size_t> &shape):: Shape does not match the number of components!");
         }
@@ -642,7 +2059,7 @@ TensorBase<T>& TensorBase<T>::reshape(const std::vector<size_t> &shape)
             num_elems *= shape[dim+1];
         }
         num_elems *= shape.front();
-        if(THROW_BASIC_EXCEPTIONS && num_elems != vector<T>::size())
+        if(THROW_BASIC_EXCEPTIONS && num_elems != storage_type::size())
         {
             throw ShapeMismatch("TensorBase<T>::reshape(const std::vector<size_t> &shape):: Shape does not match the number of components!");
         }
@@ -650,6 +2067,62 @@ TensorBase<T>& TensorBase<T>::reshape(const std::vector<size_t> &shape)
     return *this;
 }
 
+// TRUE IF THE PERMUTATION axes IS THE IDENTITY
+static bool is_identity(const vector<unsigned> &axes)
+{
+    for(unsigned d=0; d<axes.size(); d++)
+    {
+        if(axes[d]!=d)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// MATRIX PRODUCT C = A*B OF ROW-MAJOR MATRICES A (M x K) AND B (K x N), BLOCKED FOR CACHE REUSE OF B
+template<class T>
+static void matrix_product(size_t M, size_t N, size_t K, const T* A, const T* B, T* C)
+{
+    if(N==1) // matrix-vector product
+    {
+        for(size_t i=0; i<M; i++)
+        {
+            T buff = 0;
+            for(size_t k=0; k<K; k++)
+            {
+                buff += A[i*K+k]*B[k];
+            }
+            C[i] = buff;
+        }
+        return;
+    }
+    const size_t block_k = 128;
+    const size_t block_n = 256;
+    fill(C, C+M*N, T(0));
+    for(size_t k0=0; k0<K; k0+=block_k)
+    {
+        const size_t k1 = min(K, k0+block_k);
+        for(size_t j0=0; j0<N; j0+=block_n)
+        {
+            const size_t j1 = min(N, j0+block_n);
+            for(size_t i=0; i<M; i++)
+            {
+                T* c = C+i*N;
+                for(size_t k=k0; k<k1; k++)
+                {
+                    const T a = A[i*K+k];
+                    const T* b = B+k*N;
+                    for(size_t j=j0; j<j1; j++)
+                    {
+                        c[j] += a*b[j];
+                    }
+                }
+            }
+        }
+    }
+}
+
 template<class T>
 template<class T2>
 TensorBase<T> TensorBase<T>::dot(TensorBase<T2>& B, const vector<int> &idx_lhs, const vector<int> &idx_rhs, const vector<size_t> &idx_at)
@@ -797,6 +2270,76 @@ TensorBase<T> TensorBase<T>::dot(TensorBase<T2>& B, const vector<int> &idx_lhs,
         throw ShapeMismatch("TensorUtils::TensorBase<T>::dot:: Shape mismatch!");
     }
 
+    // FAST PATH: MAP THE CONTRACTION TO A MATRIX PRODUCT, IF EACH INDEX OCCURS ONCE PER OPERAND AND NO INDEX IS SHARED WITHOUT SUMMATION
+    if constexpr(is_same<T,T2>::value && is_floating_point<T>::value)
+    {
+        bool is_matrix_product = idx_at.empty() && !shape.empty() && !B.shape.empty();
+        for(size_t c=0; is_matrix_product && c<contr_pos.size(); c++)
+        {
+            is_matrix_product = contr_posA[c].size()==1 && contr_posB[c].size()==1;
+        }
+        for(size_t f=0; is_matrix_product && f<final_pos.size(); f++)
+        {
+            is_matrix_product = final_posA[f].size()+final_posB[f].size()==1;
+        }
+        if(is_matrix_product)
+        {
+            // permute A to (final indices of A, contraction indices) and B to (contraction indices, final indices of B)
+            vector<unsigned> axesA, axesB, final_A, final_B;
+            vector<size_t> shape_C;
+            size_t M = 1, N = 1, K = 1;
+            for(size_t f=0; f<final_pos.size(); f++)
+            {
+                if(!final_posA[f].empty())
+                {
+                    axesA.push_back(final_posA[f][0]);
+                    final_A.push_back(f);
+                    shape_C.push_back(shape_final[f]);
+                    M *= shape_final[f];
+                }
+            }
+            for(size_t c=0; c<contr_pos.size(); c++)
+            {
+                axesA.push_back(contr_posA[c][0]);
+                axesB.push_back(contr_posB[c][0]);
+                K *= shape_contr[c];
+            }
+            for(size_t f=0; f<final_pos.size(); f++)
+            {
+                if(!final_posB[f].empty())
+                {
+                    axesB.push_back(final_posB[f][0]);
+                    final_B.push_back(f);
+                    shape_C.push_back(shape_final[f]);
+                    N *= shape_final[f];
+                }
+            }
+            TensorBase<T> A_perm = is_identity(axesA) ? TensorBase<T>() : transpose(axesA);
+            TensorBase<T> B_perm = is_identity(axesB) ? TensorBase<T>() : B.transpose(axesB);
+            TensorBase<T> C;
+            C.alloc_uninitialized(shape_C);
+            if(!C.empty())
+            {
+                matrix_product( M, N, K,
+                                A_perm.empty() ? storage_type::data() : A_perm.data(),
+                                B_perm.empty() ? B.data() : B_perm.data(),
+                                C.data());
+            }
+            // the final indices of C are (final_A, final_B), but the result is ordered by the final indices
+            final_A.insert(final_A.end(), final_B.begin(), final_B.end());
+            vector<unsigned> axesC(final_A.size());
+            for(unsigned d=0; d<final_A.size(); d++)
+            {
+                axesC[final_A[d]] = d;
+            }
+            if(is_identity(axesC))
+            {
+                return C;
+            }
+            return C.transpose(axesC);
+        }
+    }
+
     // result, indices and pointer to be captured by lambda functions
     vector<size_t> index_final(shape_final.size());
     vector<size_t> index_contr(shape_contr.size());
@@ -1085,6 +2628,46 @@ TensorBase<T> TensorBase<T>::contract(const vector<int> &idx_lhs, const vector<s
         throw ShapeMismatch("TensorUtils::TensorBase<T>::contract:: Shape mismatch!");
     }
 
+    // FAST PATH: SUM THE ROWS OF A MATRIX, IF EACH INDEX OCCURS ONCE
+    bool is_row_sum = idx_at.empty() && !shape.empty();
+    for(auto it=contr_pos.begin(); is_row_sum && it!=contr_pos.end(); it++)
+    {
+        is_row_sum = it->size()==1;
+    }
+    for(auto it=final_pos.begin(); is_row_sum && it!=final_pos.end(); it++)
+    {
+        is_row_sum = it->size()==1;
+    }
+    if(is_row_sum)
+    {
+        // permute to (final indices, contraction indices)
+        vector<unsigned> axes;
+        size_t K = 1;
+        for(auto it=final_pos.begin(); it!=final_pos.end(); it++)
+        {
+            axes.push_back((*it)[0]);
+        }
+        for(size_t c=0; c<contr_pos.size(); c++)
+        {
+            axes.push_back(contr_pos[c][0]);
+            K *= shape_contr[c];
+        }
+        TensorBase<T> perm = is_identity(axes) ? TensorBase<T>() : transpose(axes);
+        const T* src = perm.empty() ? storage_type::data() : perm.data();
+        TensorBase<T> result;
+        result.alloc_uninitialized(shape_final);
+        for(size_t m=0; m<result.size(); m++)
+        {
+            T buff = 0;
+            for(size_t k=0; k<K; k++)
+            {
+                buff += src[m*K+k];
+            }
+            result[m] = buff;
+        }
+        return result;
+    }
+
     // result, indices and pointer to be captured by lambda functions
     vector<size_t> index_final(shape_final.size());
     vector<size_t> index_contr(shape_contr.size());
@@ -1274,21 +2857,21 @@ TensorBase<T> TensorBase<T>::contract(const vector<int> &idx_lhs, const vector<s
 template<class T>
 TensorBase<T>& TensorBase<T>::operator= (const std::vector<T>& rhs)
 {
-    if(vector<T>::size() != rhs.size())
+    if(storage_type::size() != rhs.size())
     {
         throw ShapeMismatch("TensorBase<T>::operator=(const std::vector<T>&):: Assigment with invalid number of elements!");
     }
-    vector<T>::operator=(rhs);
+    storage_type::assign(rhs.begin(), rhs.end());
     return *this;
 }
 
 template<class T>    // class template
 template<class T2>   // function template
-TensorBase<T>& TensorBase<T>::operator=(const TensorBase<T2>& rhs)
+TensorBase<T>& TensorBase<T>::assign_converted(const TensorBase<T2>& rhs)
 {
-    vector<T>::resize(rhs.size());
+    storage_type::resize(rhs.size());
     auto it_rhs = rhs.begin();
-    for(auto it=vector<T>::begin(); it!=vector<T>::end(); it++)
+    for(auto it=storage_type::begin(); it!=storage_type::end(); it++)
     {
         *it = *it_rhs;
         it_rhs++;
@@ -1302,12 +2885,12 @@ template<class T>    // class template
 template<class T2>   // function template
 TensorBase<T>& TensorBase<T>::operator+=(const TensorBase<T2>& rhs)
 {
-    if(THROW_EXCEPTIONS && vector<T>::size()!=rhs.size())
+    if(THROW_EXCEPTIONS && storage_type::size()!=rhs.size())
     {
         throw ShapeMismatch("TensorUtils::TensorBase<T>::operator+=:: Shape mismatch: Arguments have not the same number of elements!");
     }
     auto it_rhs = rhs.begin();
-    for(auto it=vector<T>::begin(); it!=vector<T>::end(); it++)
+    for(auto it=storage_type::begin(); it!=storage_type::end(); it++)
     {
         *it += *it_rhs;
         it_rhs++;
@@ -1315,25 +2898,16 @@ TensorBase<T>& TensorBase<T>::operator+=(const TensorBase<T2>& rhs)
     return *this;
 }
 
-template<class T>    // class template
-template<class T2>   // function template
-TensorBase<T> TensorBase<T>::operator+(const TensorBase<T2>& rhs)
-{
-    TensorBase<T> result(*this);
-    result += rhs;
-    return result;
-}
-
 template<class T>    // class template
 template<class T2>   // function template
 TensorBase<T>& TensorBase<T>::operator-=(const TensorBase<T2>& rhs)
 {
-    if(THROW_EXCEPTIONS && vector<T>::size()!=rhs.size())
+    if(THROW_EXCEPTIONS && storage_type::size()!=rhs.size())
     {
         throw ShapeMismatch("TensorUtils::TensorBase<T>::operator-=:: Shape mismatch: Arguments have not the same number of elements!");
     }
     auto it_rhs = rhs.begin();
-    for(auto it=vector<T>::begin(); it!=vector<T>::end(); it++)
+    for(auto it=storage_type::begin(); it!=storage_type::end(); it++)
     {
         *it -= *it_rhs;
         it_rhs++;
@@ -1341,51 +2915,26 @@ TensorBase<T>& TensorBase<T>::operator-=(const TensorBase<T2>& rhs)
     return *this;
 }
 
-template<class T>    // class template
-template<class T2>   // function template
-TensorBase<T> TensorBase<T>::operator-(const TensorBase<T2>& rhs)
-{
-    TensorBase<T> result(*this);
-    result -= rhs;
-    return result;
-}
-
 template<class T>
 TensorBase<T>& TensorBase<T>::operator*=(const T& rhs)
 {
-    for(auto it=vector<T>::begin(); it!=vector<T>::end(); it++)
+    for(auto it=storage_type::begin(); it!=storage_type::end(); it++)
     {
         *it*=rhs;
     }
     return *this;
 }
 
-template<class T>
-TensorBase<T> TensorBase<T>::operator*(const T& rhs)
-{
-    TensorBase<T> result(*this);
-    result *= rhs;
-    return result;
-}
-
 template<class T>
 TensorBase<T>& TensorBase<T>::operator/=(const T& rhs)
 {
-    for(auto it=vector<T>::begin(); it!=vector<T>::end(); it++)
+    for(auto it=storage_type::begin(); it!=storage_type::end(); it++)
     {
         *it/=rhs;
     }
     return *this;
 }
 
-template<class T>
-TensorBase<T> TensorBase<T>::operator/(const T& rhs)
-{
-    TensorBase<T> result(*this);
-    result /= rhs;
-    return result;
-}
-
 
 
 template<class T>
@@ -1394,12 +2943,12 @@ TensorBase<T>& TensorBase<T>::operator<<(T2& rhs)
 {
     if(is_same<T,T2>::value)
     {
-        memcpy( &((*this)[0]), &rhs, sizeof(T)*vector<T>::size() );
+        memcpy( &((*this)[0]), &rhs, sizeof(T)*storage_type::size() );
     }
     else
     {
         T2* ptr = &rhs;
-        for(auto it=vector<T>::begin(); it!=vector<T>::end(); it++)
+        for(auto it=storage_type::begin(); it!=storage_type::end(); it++)
         {
             *ptr = *it;
             ptr++;
@@ -1414,12 +2963,12 @@ T2& TensorBase<T>::operator>>(T2& rhs)
 {
     if(is_same<T,T2>::value)
     {
-        memcpy( &rhs, &((*this)[0]), sizeof(T)*vector<T>::size() );
+        memcpy( &rhs, &((*this)[0]), sizeof(T)*storage_type::size() );
     }
     else
     {
         T2* ptr = &rhs;
-        for(auto it=vector<T>::begin(); it!=vector<T>::end(); it++)
+        for(auto it=storage_type::begin(); it!=storage_type::end(); it++)
         {
             *ptr = *it;
             ptr++;
@@ -1673,7 +3222,7 @@ T& TensorBase<T>::operator()(const vector<size_t> &indices)
     {
         if(THROW_EXCEPTIONS)
         {
-            return vector<T>::at(0);
+            return storage_type::at(0);
         }
         return (*this)[0];
     }
@@ -1716,7 +3265,7 @@ T& TensorBase<T>::operator()(const vector<size_t*> &indices)
     {
         if(THROW_EXCEPTIONS)
         {
-            return vector<T>::at(0);
+            return storage_type::at(0);
         }
         return (*this)[0];
     }
@@ -1757,7 +3306,7 @@ T& TensorBase<T>::operator()()
 {
     if(THROW_EXCEPTIONS)
     {
-        return vector<T>::at(0);
+        return storage_type::at(0);
     }
     return (*this)[0];
 }
@@ -1905,11 +3454,9 @@ T& TensorBase<T>::operator()(size_t n0, size_t n1, size_t n2, size_t n3, size_t
 namespace TensorUtils
 {
     #define INSTANTIATE_FUNCTION_TEMPLATES(X,Y) \
-    template TensorBase<X>& TensorBase<X>::operator=<Y>(const TensorBase<Y>&); \
+    template TensorBase<X>& TensorBase<X>::assign_converted<Y>(const TensorBase<Y>&); \
     template TensorBase<X>& TensorBase<X>::operator+=<Y>(const TensorBase<Y>&); \
     template TensorBase<X>& TensorBase<X>::operator-=<Y>(const TensorBase<Y>&); \
-    template TensorBase<X> TensorBase<X>::operator+<Y>(const TensorBase<Y>&); \
-    template TensorBase<X> TensorBase<X>::operator-<Y>(const TensorBase<Y>&); \
     template TensorBase<X>& TensorBase<X>::operator<<<Y>(Y& rhs); \
     template Y& TensorBase<X>::operator>><Y>(Y& rhs); \
     template TensorBase<X>& TensorBase<X>::assign(TensorBase<Y> &rhs, const vector<size_t> &at_lhs, const vector<size_t> &at_rhs); \
@@ -1918,10 +3465,11 @@ namespace TensorUtils
     template TensorBase<X> TensorBase<X>::plus(TensorBase<Y> &rhs, const vector<size_t> &at_lhs, const vector<size_t> &at_rhs); \
     template TensorBase<X> TensorBase<X>::minus(TensorBase<Y> &rhs, const vector<size_t> &at_lhs, const vector<size_t> &at_rhs); \
     template TensorBase<X> TensorBase<X>::dot(TensorBase<Y>&, const vector<int>&, const vector<int>&, const vector<size_t>&); \
-    template void TensorBase<X>::write_bin<Y>(string, string); \
+    template void TensorBase<X>::write_bin<Y>(string, string, Encoding); \
     template void TensorBase<X>::print_helper<Y>(); \
     template void TensorBase<X>::read_txt<Y>(string path); \
     template void TensorBase<X>::read_bin<Y>(string path); \
+    template void TensorBase<X>::read_bin_block<Y>(string, const vector<size_t>&, const vector<size_t>&); \
     template void TensorBase<X>::write_txt<Y>(string, string, int); \
 
     #define INSTANTIATE_ALL(X) \
@@ -50,6 +50,12 @@ TensorDerived<T,N>::TensorDerived(const std::vector<size_t> shape, const T& val)
     }
 };
 
+template<class T, int N>
+TensorDerived<T,N>::TensorDerived(TensorDerived<T,N> &&rhs) : TensorBase<T>(std::move(rhs))
+{
+    rhs.clear();
+};
+
 template<class T, int N>
 void TensorDerived<T,N>::alloc(const std::vector<size_t> shape)
 {
@@ -70,6 +76,16 @@ void TensorDerived<T,N>::alloc(const std::vector<size_t> shape, const T &val)
     TensorBase<T>::alloc(shape, val);
 };
 
+template<class T, int N>
+void TensorDerived<T,N>::alloc_uninitialized(const std::vector<size_t> shape)
+{
+    if(N != shape.size())
+    {
+        throw RankMismatch("TensorUtils::TensorDerived<T,N>::alloc_uninitialized:: Rank mismatch!");
+    }
+    TensorBase<T>::alloc_uninitialized(shape);
+};
+
 template<class T, int N>
 void TensorDerived<T,N>::clear()
 {
@@ -106,6 +122,28 @@ TensorDerived<T,N>& TensorDerived<T,N>::operator=(const std::vector<T> &rhs)
     return *this;
 };
 
+template<class T, int N>
+TensorDerived<T,N>& TensorDerived<T,N>::operator=(TensorDerived<T,N> &&rhs)
+{
+    if(this != &rhs)
+    {
+        TensorBase<T>::operator=(std::move(rhs));
+        rhs.clear();
+    }
+    return *this;
+};
+
+template<class T, int N>
+TensorDerived<T,N>& TensorDerived<T,N>::operator=(TensorBase<T> &&rhs)
+{
+    if(N != rhs.shape.size())
+    {
+        throw RankMismatch("TensorUtils::TensorDerived<T,N>::operator=:: Rank mismatch!");
+    }
+    TensorBase<T>::operator=(std::move(rhs));
+    return *this;
+};
+
 template<class T>
 TensorDerived<T,-1>& TensorDerived<T,-1>::operator=(const std::vector<T> &rhs)
 {
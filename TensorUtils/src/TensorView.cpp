@@ -0,0 +1,391 @@
+/*
+TensorUtils Version 0.1
+
+Copyright 2022 Christoph Widder
+
+This file is part of TensorUtils.
+
+TensorUtils is free software: you can redistribute it and/or modify it under the terms of
+the GNU General Public License as published by the Free Software Foundation, either
+version 3 of the License, or (at your option) any later version.
+
+TensorUtils is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with TensorUtils.
+If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef THROW_EXCEPTIONS
+#define THROW_EXCEPTIONS 0
+#endif // THROW_EXCEPTIONS
+
+#ifndef THROW_BASIC_EXCEPTIONS
+#define THROW_BASIC_EXCEPTIONS 1
+#endif // THROW_BASIC_EXCEPTIONS
+
+#include "TensorView.hpp"
+#include "ErrorHandler.hpp"
+
+#include <set>
+#include <algorithm>
+
+using namespace std;
+using namespace TensorUtils;
+using namespace ErrorHandler;
+
+/**
+    CONSTRUCTOR
+**/
+
+template<class T>
+TensorView<T>::TensorView() : data(nullptr)
+{
+    //
+}
+
+template<class T>
+TensorView<T>::TensorView(TensorBase<T> &tensor) : data(tensor.data()), shape(tensor.shape), incr(tensor.incr)
+{
+    //
+}
+
+template<class T>
+TensorView<T>::TensorView(T* data, const vector<size_t> &shape, const vector<size_t> &incr) : data(data), shape(shape), incr(incr)
+{
+    if(THROW_BASIC_EXCEPTIONS && shape.size()!=incr.size())
+    {
+        throw ShapeMismatch("TensorUtils::TensorView<T>::TensorView:: Shape and increments do not match!");
+    }
+}
+
+/**
+    PROPERTIES
+**/
+
+template<class T>
+size_t TensorView<T>::size() const
+{
+    size_t num_elems = 1;
+    for(auto it=shape.begin(); it!=shape.end(); it++)
+    {
+        num_elems *= *it;
+    }
+    return num_elems;
+}
+
+template<class T>
+bool TensorView<T>::contiguous() const
+{
+    size_t expected = 1;
+    for(size_t d=shape.size(); d>0; d--)
+    {
+        if(shape[d-1]!=1 && incr[d-1]!=expected)
+        {
+            return false;
+        }
+        expected *= shape[d-1];
+    }
+    return true;
+}
+
+/**
+    SLICE, RANGE & TRANSPOSE
+**/
+
+template<class T>
+TensorView<T> TensorView<T>::slice(const vector<size_t> &idx_at) const
+{
+    if(THROW_BASIC_EXCEPTIONS && idx_at.size()>shape.size())
+    {
+        throw ShapeMismatch("TensorUtils::TensorView<T>::slice:: Too many indices!");
+    }
+    TensorView<T> result;
+    result.data = data;
+    for(size_t d=0; d<idx_at.size(); d++)
+    {
+        if(THROW_EXCEPTIONS && idx_at[d]>=shape[d])
+        {
+            throw out_of_range("TensorUtils::TensorView<T>::slice:: Index out of range!");
+        }
+        result.data += idx_at[d]*incr[d];
+    }
+    result.shape.assign(shape.begin()+idx_at.size(), shape.end());
+    result.incr.assign(incr.begin()+idx_at.size(), incr.end());
+    return result;
+}
+
+template<class T>
+TensorView<T> TensorView<T>::range(unsigned axis, size_t begin, size_t end) const
+{
+    if(THROW_BASIC_EXCEPTIONS)
+    {
+        if(axis>=shape.size())
+        {
+            throw ShapeMismatch("TensorUtils::TensorView<T>::range:: Invalid axis!");
+        }
+        if(begin>end || end>shape[axis])
+        {
+            throw out_of_range("TensorUtils::TensorView<T>::range:: Index out of range!");
+        }
+    }
+    TensorView<T> result(*this);
+    result.data += begin*incr[axis];
+    result.shape[axis] = end-begin;
+    return result;
+}
+
+template<class T>
+TensorView<T> TensorView<T>::transpose(const vector<unsigned> &axes) const
+{
+    if(THROW_BASIC_EXCEPTIONS)
+    {
+        set<unsigned> set1;
+        for(unsigned n=0; n<shape.size(); n++)
+        {
+            set1.insert(n);
+        }
+        set<unsigned> set2(axes.begin(), axes.end());
+        if( set1 != set2 || axes.size()!=shape.size() )
+        {
+            throw ShapeMismatch("TensorUtils::TensorView<T>::transpose:: Axes do not match!");
+        }
+    }
+    TensorView<T> result;
+    result.data = data;
+    for(auto it=axes.begin(); it!=axes.end(); it++)
+    {
+        result.shape.push_back(shape[*it]);
+        result.incr.push_back(incr[*it]);
+    }
+    return result;
+}
+
+/**
+    COPY
+**/
+
+template<class T>
+TensorBase<T> TensorView<T>::copy() const
+{
+    TensorBase<T> result;
+    result.alloc_uninitialized(shape);
+    if(!result.empty())
+    {
+        copy_to(&result[0]);
+    }
+    return result;
+}
+
+template<class T>
+void TensorView<T>::copy_to(T* dst) const
+{
+    size_t num_elems = size();
+    if(num_elems==0)
+    {
+        return;
+    }
+    if(shape.empty())
+    {
+        *dst = *data;
+        return;
+    }
+    size_t rank = shape.size();
+    size_t n_inner = shape.back();
+    size_t incr_inner = incr.back();
+    vector<size_t> index(rank, 0);
+    const T* src = data;
+    for(size_t n=0; n<num_elems; n+=n_inner)
+    {
+        if(incr_inner==1)
+        {
+            std::copy(src, src+n_inner, dst+n); // front to back, may alias as documented
+        }
+        else
+        {
+            for(size_t k=0; k<n_inner; k++)
+            {
+                dst[n+k] = src[k*incr_inner];
+            }
+        }
+        size_t d = rank-1;
+        while(d>0)
+        {
+            d--;
+            index[d]++;
+            src += incr[d];
+            if(index[d]<shape[d])
+            {
+                break;
+            }
+            src -= shape[d]*incr[d];
+            index[d] = 0;
+        }
+    }
+}
+
+template<class T>
+void TensorView<T>::copy_from(const T* src)
+{
+    size_t num_elems = size();
+    if(num_elems==0)
+    {
+        return;
+    }
+    if(shape.empty())
+    {
+        *data = *src;
+        return;
+    }
+    size_t rank = shape.size();
+    size_t n_inner = shape.back();
+    size_t incr_inner = incr.back();
+    vector<size_t> index(rank, 0);
+    T* dst = data;
+    for(size_t n=0; n<num_elems; n+=n_inner)
+    {
+        for(size_t k=0; k<n_inner; k++)
+        {
+            dst[k*incr_inner] = src[n+k];
+        }
+        size_t d = rank-1;
+        while(d>0)
+        {
+            d--;
+            index[d]++;
+            dst += incr[d];
+            if(index[d]<shape[d])
+            {
+                break;
+            }
+            dst -= shape[d]*incr[d];
+            index[d] = 0;
+        }
+    }
+}
+
+/**
+    ELEMENT ACCESS
+**/
+
+template<class T>
+T& TensorView<T>::operator()(const vector<size_t> &indices) const
+{
+    if(THROW_EXCEPTIONS && indices.size()>shape.size())
+    {
+        throw ShapeMismatch("TensorUtils::TensorView<T>::operator():: Too many indices!");
+    }
+    size_t idx = 0;
+    for(size_t d=0; d<indices.size(); d++)
+    {
+        if(THROW_EXCEPTIONS && indices[d]>=shape[d])
+        {
+            throw out_of_range("TensorUtils::TensorView<T>::operator():: Index out of range!");
+        }
+        idx += indices[d]*incr[d];
+    }
+    return data[idx];
+}
+
+template<class T>
+T& TensorView<T>::operator()() const
+{
+    return data[0];
+}
+
+template<class T>
+T& TensorView<T>::operator()(size_t n0) const
+{
+    if(THROW_EXCEPTIONS)
+    {
+        if(1>shape.size())
+        {
+            throw ShapeMismatch("TensorUtils::TensorView<T>::operator():: Too many indices!");
+        }
+        if(n0>=shape[0])
+        {
+            throw out_of_range("TensorUtils::TensorView<T>::operator():: Index out of range!");
+        }
+    }
+    return data[incr[0]*n0];
+}
+
+template<class T>
+T& TensorView<T>::operator()(size_t n0, size_t n1) const
+{
+    if(THROW_EXCEPTIONS)
+    {
+        if(2>shape.size())
+        {
+            throw ShapeMismatch("TensorUtils::TensorView<T>::operator():: Too many indices!");
+        }
+        if(n0>=shape[0]||n1>=shape[1])
+        {
+            throw out_of_range("TensorUtils::TensorView<T>::operator():: Index out of range!");
+        }
+    }
+    return data[incr[0]*n0+incr[1]*n1];
+}
+
+template<class T>
+T& TensorView<T>::operator()(size_t n0, size_t n1, size_t n2) const
+{
+    if(THROW_EXCEPTIONS)
+    {
+        if(3>shape.size())
+        {
+            throw ShapeMismatch("TensorUtils::TensorView<T>::operator():: Too many indices!");
+        }
+        if(n0>=shape[0]||n1>=shape[1]||n2>=shape[2])
+        {
+            throw out_of_range("TensorUtils::TensorView<T>::operator():: Index out of range!");
+        }
+    }
+    return data[incr[0]*n0+incr[1]*n1+incr[2]*n2];
+}
+
+template<class T>
+T& TensorView<T>::operator()(size_t n0, size_t n1, size_t n2, size_t n3) const
+{
+    if(THROW_EXCEPTIONS)
+    {
+        if(4>shape.size())
+        {
+            throw ShapeMismatch("TensorUtils::TensorView<T>::operator():: Too many indices!");
+        }
+        if(n0>=shape[0]||n1>=shape[1]||n2>=shape[2]||n3>=shape[3])
+        {
+            throw out_of_range("TensorUtils::TensorView<T>::operator():: Index out of range!");
+        }
+    }
+    return data[incr[0]*n0+incr[1]*n1+incr[2]*n2+incr[3]*n3];
+}
+
+/**
+    EXPLICIT INSTANTIATION
+**/
+
+namespace TensorUtils
+{
+    #ifndef ENABLE_INTEGRAL_TYPES
+    #define ENABLE_INTEGRAL_TYPES 1
+    #endif // ENABLE_INTEGRAL_TYPES
+
+    template class TensorView<double>;
+    template class TensorView<float>;
+    template class TensorView<long double>;
+    #if ENABLE_INTEGRAL_TYPES == 1
+        template class TensorView<unsigned char>;
+        template class TensorView<signed char>;
+        template class TensorView<unsigned short>;
+        template class TensorView<short>;
+        template class TensorView<unsigned>;
+        template class TensorView<int>;
+        template class TensorView<unsigned long>;
+        template class TensorView<long>;
+        template class TensorView<unsigned long long>;
+        template class TensorView<long long>;
+    #endif
+}